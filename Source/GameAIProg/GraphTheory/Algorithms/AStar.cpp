@@ -2,163 +2,533 @@
 #include <algorithm>
 #include <limits>
 
+#include "Shared/Graph/GridGraph/GridGraph.h"
+
 using namespace GameAI;
 
-AStar::AStar(Graph* const pGraph, HeuristicFunctions::Heuristic hFunction)
+AStar::AStar(Graph const* const pGraph, HeuristicFunctions::Heuristic hFunction)
 	: pGraph(pGraph)
+	, pGrid(dynamic_cast<GridGraph const*>(pGraph))
 	, HeuristicFunction(hFunction)
 {
 }
 
+AStar::AStar(Graph const* const pGraph, HeuristicFunctions::NodeHeuristic hFunction)
+	: pGraph(pGraph)
+	, pGrid(dynamic_cast<GridGraph const*>(pGraph))
+	, NodeHeuristicFunction(std::move(hFunction))
+{
+}
+
 std::vector<Node*> AStar::FindPath(Node* const pStartNode, Node* const pDestinationNode)
 {
-	std::vector<Node*> path{};
+	auto const path = FindPath(pStartNode, pDestinationNode, DefaultContext);
+	return std::vector<Node*>{path.begin(), path.end()};
+}
 
+std::span<Node* const> AStar::FindPath(Node* const pStartNode, Node* const pDestinationNode, PathSearchContext& Context) const
+{
 	// If start or destination is missing, stop
 	if (!pStartNode || !pDestinationNode)
 	{
-		return path;
+		return {};
 	}
 
-	// Lists used by A*
-	std::vector<NodeRecord> openList;   // Nodes to explore
-	std::vector<NodeRecord> closedList; // Already processed nodes
-	NodeRecord currentRecord;
-
-	// Initialize start node
-	NodeRecord startRecord;
-	startRecord.pNode = pStartNode;
-	startRecord.pConnection = nullptr;
-	startRecord.costSoFar = 0.f;
-	startRecord.estimatedTotalCost = GetHeuristicCost(pStartNode, pDestinationNode);
-	
-	openList.push_back(startRecord);
+	SearchState search{};
+	BeginSearch(pStartNode, pDestinationNode, search, Context);
 
 	// Main A* loop
-	while (!openList.empty())
+	while (!Context.GetOpenList().IsEmpty() && !ExpandNext(search, Context))
 	{
-		// Get node with lowest estimated cost
-		auto bestRecordIt = std::min_element(openList.begin(), openList.end());
-		currentRecord = *bestRecordIt;
+	}
 
-		// Stop if goal reached
-		if (currentRecord.pNode == pDestinationNode)
+	auto const path = BuildPath(search, Context);
+	Context.EndQuery();
+	return path;
+}
+
+void AStar::Begin(Node* const pStartNode, Node* const pDestinationNode, PathSearchContext& Context)
+{
+	SlicedSearch = SearchState{};
+	pSlicedContext = &Context;
+
+	// Nothing to search, done right away with an empty result
+	if (!pStartNode || !pDestinationNode)
+	{
+		SlicedSearch.bDone = true;
+		Context.GetPathBuffer().clear();
+		return;
+	}
+
+	BeginSearch(pStartNode, pDestinationNode, SlicedSearch, Context);
+}
+
+bool AStar::Step(int MaxExpansions)
+{
+	if (SlicedSearch.bDone) return true;
+
+	for (int expansion = 0; expansion < MaxExpansions; ++expansion)
+	{
+		if (pSlicedContext->GetOpenList().IsEmpty() || ExpandNext(SlicedSearch, *pSlicedContext))
 		{
-			break; 
+			SlicedSearch.bDone = true;
+			pSlicedContext->EndQuery();
+			break;
 		}
+	}
+	return SlicedSearch.bDone;
+}
 
-		// Check all neighbors
-		auto connections = pGraph->FindConnectionsFrom(currentRecord.pNode->GetId());
-		for (Connection* connection : connections)
-		{
-			// Get the neighbor node
-			Node* pNextNode = pGraph->GetNode(connection->GetToId()).get();
+std::span<Node* const> AStar::GetResult()
+{
+	if (pSlicedContext == nullptr || SlicedSearch.pStartNode == nullptr) return {};
 
-			// Calculate new G-cost
-			float totalGCost = currentRecord.costSoFar + connection->GetWeight();
+	return BuildPath(SlicedSearch, *pSlicedContext);
+}
 
-			// Check if node is already in closed list
-			auto closedIt = std::find_if(closedList.begin(), closedList.end(), 
-				[pNextNode](const NodeRecord& r) { return r.pNode == pNextNode; });
-			
-			if (closedIt != closedList.end())
-			{
-				// Skip if existing path is cheaper
-				if (closedIt->costSoFar <= totalGCost)
-				{
-					continue;
-				}
-				else
-				{
-					closedList.erase(closedIt);
-				}
-			}
+void AStar::BeginAnytime(Node* const pStartNode, Node* const pDestinationNode, PathSearchContext& Context, float InitialEpsilon,
+	AnytimePathCallback OnPath, float EpsilonStep)
+{
+	Anytime.Epsilon = std::max(InitialEpsilon, 1.f);
+	Anytime.EpsilonStep = std::max(EpsilonStep, MinEpsilonStep); // a step of 0 would never get down to 1
+	Anytime.PublishedEpsilon = 0.f;
+	Anytime.OnPath = std::move(OnPath);
+	Anytime.ClosedIds.clear();
+	Anytime.InconsistentIds.clear();
 
-			// Check if node is already in open list
-			auto openIt = std::find_if(openList.begin(), openList.end(), 
-				[pNextNode](const NodeRecord& r) { return r.pNode == pNextNode; });
-			
-			if (openIt != openList.end())
-			{
-				// Skip if existing path is cheaper
-				if (openIt->costSoFar <= totalGCost)
-				{
-					continue;
-				}
-				else
-				{
-					openList.erase(openIt);
-				}
-			}
+	Begin(pStartNode, pDestinationNode, Context);
+}
 
-			// Create a new record for this path
-			NodeRecord newRecord;
-			newRecord.pNode = pNextNode;
-			newRecord.pConnection = connection;
-			newRecord.costSoFar = totalGCost;
-			newRecord.estimatedTotalCost = totalGCost + GetHeuristicCost(pNextNode, pDestinationNode);
-			
-			openList.push_back(newRecord);
-		}
+bool AStar::StepAnytime(double BudgetMs)
+{
+	if (SlicedSearch.bDone) return true;
 
-		// Move current node from open to closed list
-		openList.erase(std::remove(openList.begin(), openList.end(), currentRecord), openList.end());
-		closedList.push_back(currentRecord);
+	// Expansions between two looks at the clock
+	int constexpr expansionsPerCheck = 64;
+	double const deadline = FPlatformTime::Seconds() + BudgetMs / 1000.0;
+	do
+	{
+		if (!ImprovePath(expansionsPerCheck)) continue;
+
+		PublishAnytimePath();
+		if (!SlicedSearch.bFoundDestination || Anytime.PublishedEpsilon <= 1.f)
+		{
+			SlicedSearch.bDone = true;
+			pSlicedContext->EndQuery();
+			break;
+		}
+		BeginNextAnytimePass();
 	}
+	while (FPlatformTime::Seconds() < deadline);
+
+	return SlicedSearch.bDone;
+}
 
-	// If destination wasn't reached, find a fallback path
-	if (currentRecord.pNode != pDestinationNode)
+bool AStar::ImprovePath(int MaxExpansions)
+{
+	IndexedHeap<4>& OpenList = pSlicedContext->GetOpenList();
+	NodeRecordTable& Records = pSlicedContext->GetRecords();
+	int const destinationId = SlicedSearch.pDestinationNode->GetId();
+	float const epsilon = Anytime.Epsilon;
+
+	for (int expansion = 0; expansion < MaxExpansions; ++expansion)
 	{
-		float closestHeuristic = std::numeric_limits<float>::max();
+		// The pass is done once no open node can lead to a cheaper path to the destination within this epsilon
+		if (OpenList.IsEmpty() || OpenList.TopKey() >= Records.Get(destinationId).CostSoFar)
+		{
+			SlicedSearch.bFoundDestination = Records.Get(destinationId).CostSoFar < std::numeric_limits<float>::max();
+			return true;
+		}
+
+		int const currentId = OpenList.Pop();
+		pSlicedContext->CountExpansion();
+
+		NodeRecord& currentRecord = Records.Get(currentId);
+		currentRecord.State = NodeRecordState::Closed;
+		Anytime.ClosedIds.push_back(currentId);
 
-		for (const auto& record : closedList)
+		// Same fallback as ExpandNext, GetResult leads there when the destination can't be reached
+		Node* const pCurrentNode = pGraph->GetNode(currentId).get();
+		if (float const heuristicToGoal = GetHeuristicCost(pCurrentNode, SlicedSearch.pDestinationNode); heuristicToGoal < SlicedSearch.ClosestHeuristic)
 		{
-			float heuristicToGoal = GetHeuristicCost(record.pNode, pDestinationNode);
+			SlicedSearch.ClosestHeuristic = heuristicToGoal;
+			SlicedSearch.ClosestNodeId = currentId;
+		}
+
+		auto const visitNeighbor = [&](int nextId, float stepCost, Connection* connection)
+		{
+			if (NodeFilter && !NodeFilter(nextId)) return;
 
-			if (heuristicToGoal < closestHeuristic)
+			// Costs carry over between passes, so the state doesn't tell whether the cost is known
+			float const totalGCost = currentRecord.CostSoFar + stepCost;
+			NodeRecord& nextRecord = Records.Get(nextId);
+			if (nextRecord.CostSoFar <= totalGCost) return;
+
+			nextRecord.pConnection = connection;
+			nextRecord.ParentId = currentId;
+			nextRecord.CostSoFar = totalGCost;
+
+			// Closed nodes aren't expanded twice in one pass, the next pass picks them up
+			if (nextRecord.State == NodeRecordState::Closed)
 			{
-				closestHeuristic = heuristicToGoal;
-				currentRecord = record; // backtrack from closest node
+				Anytime.InconsistentIds.push_back(nextId);
+				return;
 			}
+			nextRecord.EstimatedTotalCost = totalGCost + epsilon * GetHeuristicCost(pGraph->GetNode(nextId).get(), SlicedSearch.pDestinationNode);
+			nextRecord.State = NodeRecordState::Open;
+			OpenList.PushOrDecrease(nextId, nextRecord.EstimatedTotalCost);
+		};
+
+		if (pGrid != nullptr && pGrid->IsCellLayerInSync())
+		{
+			pGrid->ForEachWalkableNeighbour(currentId, [&visitNeighbor](int nextId, float stepCost)
+			{
+				visitNeighbor(nextId, stepCost, nullptr);
+			});
+			continue;
 		}
 
-		// Safety check
-		if (currentRecord.pNode == nullptr)
+		for (Connection* connection : pGraph->GetConnectionsFrom(currentId))
 		{
-			return path;
+			visitNeighbor(connection->GetToId(), connection->GetWeight(), connection);
 		}
 	}
+	return false;
+}
 
-	// Reconstruct path by walking backwards
-	while (currentRecord.pNode != pStartNode)
+void AStar::PublishAnytimePath()
+{
+	if (!SlicedSearch.bFoundDestination) return;
+
+	// The cheapest uninflated estimate left is a lower bound of the optimal cost, often tighter than epsilon
+	NodeRecordTable& Records = pSlicedContext->GetRecords();
+	float lowerBound = std::numeric_limits<float>::max();
+	auto const boundNode = [&](int nodeId)
+	{
+		float const costSoFar = Records.Get(nodeId).CostSoFar;
+		lowerBound = std::min(lowerBound, costSoFar + GetHeuristicCost(pGraph->GetNode(nodeId).get(), SlicedSearch.pDestinationNode));
+	};
+	pSlicedContext->GetOpenList().ForEach([&boundNode](int nodeId, float) { boundNode(nodeId); });
+	for (int const nodeId : Anytime.InconsistentIds)
 	{
-		path.push_back(currentRecord.pNode);
+		boundNode(nodeId);
+	}
 
-		// Find the parent node in closed list
-		int parentNodeId = currentRecord.pConnection->GetFromId();
-		auto parentIt = std::find_if(closedList.begin(), closedList.end(), 
-			[parentNodeId](const NodeRecord& r) { return r.pNode->GetId() == parentNodeId; });
+	float const pathCost = Records.Get(SlicedSearch.pDestinationNode->GetId()).CostSoFar;
+	Anytime.PublishedEpsilon = lowerBound > 0.f ? std::clamp(pathCost / lowerBound, 1.f, Anytime.Epsilon) : Anytime.Epsilon;
+	if (Anytime.OnPath)
+	{
+		Anytime.OnPath(BuildPath(SlicedSearch, *pSlicedContext), Anytime.PublishedEpsilon);
+	}
+}
 
-		// Move to the parent record
-		if (parentIt != closedList.end())
+void AStar::BeginNextAnytimePass()
+{
+	IndexedHeap<4>& OpenList = pSlicedContext->GetOpenList();
+	NodeRecordTable& Records = pSlicedContext->GetRecords();
+	Anytime.Epsilon = std::max(Anytime.Epsilon - Anytime.EpsilonStep, 1.f);
+
+	// Closed nodes are closed for one pass only, they keep their costs
+	for (int const nodeId : Anytime.ClosedIds)
+	{
+		Records.Get(nodeId).State = NodeRecordState::Unvisited;
+	}
+	for (int const nodeId : Anytime.InconsistentIds)
+	{
+		Records.Get(nodeId).State = NodeRecordState::Open;
+		if (!OpenList.Contains(nodeId))
 		{
-			currentRecord = *parentIt;
+			OpenList.Push(nodeId, 0.f);
 		}
 	}
+	Anytime.ClosedIds.clear();
+	Anytime.InconsistentIds.clear();
+
+	// All open nodes get the new inflation at once
+	OpenList.Rekey([&](int nodeId)
+	{
+		NodeRecord& record = Records.Get(nodeId);
+		record.EstimatedTotalCost = record.CostSoFar + Anytime.Epsilon * GetHeuristicCost(pGraph->GetNode(nodeId).get(), SlicedSearch.pDestinationNode);
+		return record.EstimatedTotalCost;
+	});
+}
+
+void AStar::BeginSearch(Node* const pStartNode, Node* const pDestinationNode, SearchState& Search, PathSearchContext& Context) const
+{
+	// Reset the open list and invalidate all records of the previous query
+	Context.BeginQuery(static_cast<int>(pGraph->GetNodes().size()));
+
+	Search.pStartNode = pStartNode;
+	Search.pDestinationNode = pDestinationNode;
+
+	// Searching for an unreachable destination floods everything the start can reach, head for the fallback instead
+	if (pComponents != nullptr && !NodeFilter && pComponents->IsUpToDate(*pGraph)
+		&& !pComponents->AreConnected(pStartNode->GetId(), pDestinationNode->GetId()))
+	{
+		Search.pDestinationNode = FindClosestReachableNode(pStartNode, pDestinationNode);
+		Search.bIsUnreachable = true;
+	}
+
+	// Initialize start node
+	NodeRecord& startRecord = Context.GetRecords().Get(pStartNode->GetId());
+	startRecord.pConnection = nullptr;
+	startRecord.CostSoFar = 0.f;
+	startRecord.EstimatedTotalCost = GetHeuristicCost(pStartNode, Search.pDestinationNode);
+	startRecord.State = NodeRecordState::Open;
+	Context.GetOpenList().Push(pStartNode->GetId(), startRecord.EstimatedTotalCost);
+}
+
+bool AStar::ExpandNext(SearchState& Search, PathSearchContext& Context) const
+{
+	IndexedHeap<4>& OpenList = Context.GetOpenList();
+	NodeRecordTable& Records = Context.GetRecords();
+
+	// Get node with lowest estimated cost
+	int const currentId = OpenList.Pop();
+	Context.CountExpansion();
+
+	// Stop if goal reached
+	if (currentId == Search.pDestinationNode->GetId())
+	{
+		Search.bFoundDestination = true;
+		return true;
+	}
+
+	// Move current node from open to closed list
+	NodeRecord& currentRecord = Records.Get(currentId);
+	currentRecord.State = NodeRecordState::Closed;
+
+	Node* const pCurrentNode = pGraph->GetNode(currentId).get();
+	if (float const heuristicToGoal = GetHeuristicCost(pCurrentNode, Search.pDestinationNode); heuristicToGoal < Search.ClosestHeuristic)
+	{
+		Search.ClosestHeuristic = heuristicToGoal;
+		Search.ClosestNodeId = currentId;
+	}
+
+	auto const visitNeighbor = [&](int nextId, float stepCost, Connection* connection)
+	{
+		if (NodeFilter && !NodeFilter(nextId)) return;
+
+		// Calculate new G-cost
+		float const totalGCost = currentRecord.CostSoFar + stepCost;
+
+		// Skip if existing path (open or closed) is cheaper, otherwise (re)open the node
+		NodeRecord& nextRecord = Records.Get(nextId);
+		if (nextRecord.State != NodeRecordState::Unvisited && nextRecord.CostSoFar <= totalGCost)
+		{
+			return;
+		}
+
+		nextRecord.pConnection = connection;
+		nextRecord.ParentId = currentId;
+		nextRecord.CostSoFar = totalGCost;
+		nextRecord.EstimatedTotalCost = totalGCost + GetHeuristicCost(pGraph->GetNode(nextId).get(), Search.pDestinationNode);
+		nextRecord.State = NodeRecordState::Open;
+		OpenList.PushOrDecrease(nextId, nextRecord.EstimatedTotalCost);
+	};
+
+	// Check all neighbors, on a grid by index arithmetic over its cell layer (no connection to follow then)
+	if (pGrid != nullptr && pGrid->IsCellLayerInSync())
+	{
+		pGrid->ForEachWalkableNeighbour(currentId, [&visitNeighbor](int nextId, float stepCost)
+		{
+			visitNeighbor(nextId, stepCost, nullptr);
+		});
+		return false;
+	}
+
+	auto const connections = pGraph->GetConnectionsFrom(currentId);
+	for (Connection* connection : connections)
+	{
+		visitNeighbor(connection->GetToId(), connection->GetWeight(), connection);
+	}
+	return false;
+}
+
+std::span<Node* const> AStar::BuildPath(SearchState const& Search, PathSearchContext& Context) const
+{
+	std::vector<Node*>& path = Context.GetPathBuffer();
+	path.clear();
+
+	// If destination wasn't reached, backtrack from the closest node instead
+	int currentId = Search.bFoundDestination ? Search.pDestinationNode->GetId() : Search.ClosestNodeId;
+
+	// Safety check
+	if (currentId == Graphs::InvalidNodeId)
+	{
+		return {};
+	}
+
+	// Reconstruct path by walking backwards over the parents
+	int const startId = Search.pStartNode->GetId();
+	while (currentId != startId)
+	{
+		path.push_back(pGraph->GetNode(currentId).get());
+		currentId = Context.GetRecords().Find(currentId)->ParentId;
+	}
 
 	// Add start node
-	path.push_back(pStartNode);
+	path.push_back(Search.pStartNode);
 
 	// Reverse because path was built backwards
 	std::reverse(path.begin(), path.end());
 
-	return path;
+	return Context.GetPath();
+}
+
+std::span<Node* const> AStar::FindPath(std::span<PathSeed const> Sources, std::span<PathSeed const> Targets,
+	FVector2D const& GoalPosition, PathSearchContext& Context) const
+{
+	if (Sources.empty())
+	{
+		return {};
+	}
+
+	// The virtual goal gets the first id past the graph's nodes, its record lives in the same table
+	int const nrNodes = static_cast<int>(pGraph->GetNodes().size());
+	int const goalId = nrNodes;
+
+	Context.BeginQuery(nrNodes + 1);
+	IndexedHeap<4>& OpenList = Context.GetOpenList();
+	NodeRecordTable& Records = Context.GetRecords();
+	std::vector<Node*>& path = Context.GetPathBuffer();
+
+	auto const getHeuristicCost = [this, &GoalPosition](int nodeId)
+	{
+		if (!HeuristicFunction) return 0.f;
+
+		FVector2D const toGoal = GoalPosition - pGraph->GetNode(nodeId)->GetPosition();
+		return HeuristicFunction(abs(toGoal.X), abs(toGoal.Y));
+	};
+
+	// Open every source as if the virtual start node had just been expanded
+	for (PathSeed const& source : Sources)
+	{
+		NodeRecord& sourceRecord = Records.Get(source.NodeId);
+		if (sourceRecord.State != NodeRecordState::Unvisited && sourceRecord.CostSoFar <= source.Cost) continue;
+
+		sourceRecord.pConnection = nullptr;
+		sourceRecord.CostSoFar = source.Cost;
+		sourceRecord.EstimatedTotalCost = source.Cost + getHeuristicCost(source.NodeId);
+		sourceRecord.State = NodeRecordState::Open;
+		OpenList.PushOrDecrease(source.NodeId, sourceRecord.EstimatedTotalCost);
+	}
+
+	// Closest expanded node to the goal, used as fallback when the goal can't be reached
+	int closestNodeId = Graphs::InvalidNodeId;
+	float closestHeuristic = std::numeric_limits<float>::max();
+	bool bFoundDestination = false;
+
+	while (!OpenList.IsEmpty())
+	{
+		int const currentId = OpenList.Pop();
+		Context.CountExpansion();
+
+		if (currentId == goalId)
+		{
+			bFoundDestination = true;
+			break;
+		}
+
+		NodeRecord& currentRecord = Records.Get(currentId);
+		currentRecord.State = NodeRecordState::Closed;
+
+		if (float const heuristicToGoal = getHeuristicCost(currentId); heuristicToGoal < closestHeuristic)
+		{
+			closestHeuristic = heuristicToGoal;
+			closestNodeId = currentId;
+		}
+
+		// Virtual connection into the goal, there are only a handful of targets
+		for (PathSeed const& target : Targets)
+		{
+			if (target.NodeId != currentId) continue;
+
+			float const totalGCost = currentRecord.CostSoFar + target.Cost;
+			NodeRecord& goalRecord = Records.Get(goalId);
+			if (goalRecord.State != NodeRecordState::Unvisited && goalRecord.CostSoFar <= totalGCost) continue;
+
+			goalRecord.ParentId = currentId;
+			goalRecord.CostSoFar = totalGCost;
+			goalRecord.EstimatedTotalCost = totalGCost;
+			goalRecord.State = NodeRecordState::Open;
+			OpenList.PushOrDecrease(goalId, totalGCost);
+		}
+
+		auto const connections = pGraph->GetConnectionsFrom(currentId);
+		for (Connection* connection : connections)
+		{
+			int const nextId = connection->GetToId();
+			if (NodeFilter && !NodeFilter(nextId)) continue;
+
+			float const totalGCost = currentRecord.CostSoFar + connection->GetWeight();
+
+			NodeRecord& nextRecord = Records.Get(nextId);
+			if (nextRecord.State != NodeRecordState::Unvisited && nextRecord.CostSoFar <= totalGCost)
+			{
+				continue;
+			}
+
+			nextRecord.pConnection = connection;
+			nextRecord.CostSoFar = totalGCost;
+			nextRecord.EstimatedTotalCost = totalGCost + getHeuristicCost(nextId);
+			nextRecord.State = NodeRecordState::Open;
+			OpenList.PushOrDecrease(nextId, nextRecord.EstimatedTotalCost);
+		}
+	}
+
+	// The virtual nodes aren't part of the path, it runs from a source to a target (or to the closest node)
+	int currentId = bFoundDestination ? Records.Find(goalId)->ParentId : closestNodeId;
+	if (currentId == Graphs::InvalidNodeId)
+	{
+		Context.EndQuery();
+		return {};
+	}
+
+	// Sources have no parent connection
+	while (true)
+	{
+		path.push_back(pGraph->GetNode(currentId).get());
+		Connection const* pConnection = Records.Find(currentId)->pConnection;
+		if (pConnection == nullptr) break;
+		currentId = pConnection->GetFromId();
+	}
+	std::reverse(path.begin(), path.end());
+
+	Context.EndQuery();
+	return Context.GetPath();
 }
 
 float AStar::GetHeuristicCost(Node* const pStartNode, Node* const pEndNode) const
 {
+	if (NodeHeuristicFunction)
+	{
+		return NodeHeuristicFunction(pStartNode->GetId(), pEndNode->GetId());
+	}
+
 	// Distance from start to destination
 	FVector2D toDestination = pGraph->GetNode(pEndNode->GetId())->GetPosition() - pGraph->GetNode(pStartNode->GetId())->GetPosition();
 	// Apply the selected heuristic
 	return HeuristicFunction(abs(toDestination.X), abs(toDestination.Y));
+}
+
+Node* AStar::FindClosestReachableNode(Node* const pStartNode, Node* const pDestinationNode) const
+{
+	// Same pick as the fallback of a search that ran dry, the start wins ties (e.g. a heuristic of 0 everywhere)
+	Node* pClosestNode = pStartNode;
+	float closestHeuristic = GetHeuristicCost(pStartNode, pDestinationNode);
+
+	auto const& nodes = pGraph->GetNodes();
+	int const startId = pStartNode->GetId();
+	for (int nodeId = 0; nodeId < static_cast<int>(nodes.size()); ++nodeId)
+	{
+		if (!pComponents->AreConnected(startId, nodeId)) continue;
+
+		if (float const heuristicToGoal = GetHeuristicCost(nodes[nodeId].get(), pDestinationNode); heuristicToGoal < closestHeuristic)
+		{
+			closestHeuristic = heuristicToGoal;
+			pClosestNode = nodes[nodeId].get();
+		}
+	}
+	return pClosestNode;
 }
\ No newline at end of file
@@ -1,44 +1,119 @@
 ﻿#pragma once
 
+#include <functional>
+#include <limits>
 #include <vector>
+#include "Shared/Graph/ConnectedComponents.h"
 #include "Shared/Graph/Graph.h"
 #include "Heuristics.h"
+#include "PathSearchContext.h"
 
 namespace GameAI
 {
+	class GridGraph;
+
+	// On a GridGraph node to node searches read the neighbours from its cell layer while it's in sync with the connections
 	class AStar
 	{
 	public:
-		AStar(Graph* const pGraph, HeuristicFunctions::Heuristic hFunction);
+		AStar(Graph const* const pGraph, HeuristicFunctions::Heuristic hFunction);
+		AStar(Graph const* const pGraph, HeuristicFunctions::NodeHeuristic hFunction);
+
+		std::vector<Node*> FindPath(Node* const pStartNode, Node* const pDestinationNode);
+		
+		// Allocation free once Context is warmed up, the returned view lives in Context until its next query
+		std::span<Node* const> FindPath(Node* const pStartNode, Node* const pDestinationNode, PathSearchContext& Context) const;
+
+		// Search between two points that aren't nodes of the graph. The start and goal only exist in this query:
+		// the path starts at any of the Sources and ends at any of the Targets, seed costs included.
+		// GoalPosition feeds the distance heuristic (a NodeHeuristic can't rate the virtual goal, so it isn't used).
+		// Without Targets (e.g. the goal lies in a part of the graph that isn't loaded) the path leads to the node closest to GoalPosition.
+		// The graph is only read, threads can share it as long as each one has its own Context
+		std::span<Node* const> FindPath(std::span<PathSeed const> Sources, std::span<PathSeed const> Targets,
+			FVector2D const& GoalPosition, PathSearchContext& Context) const;
+
+		// Time sliced version of the Context FindPath, for searches too long for one frame.
+		// Begin sets it up, every Step expands at most MaxExpansions nodes and returns true once the search is done.
+		// Until then GetResult is the best path so far: from the start to the expanded node closest to the destination.
+		// One search at a time per AStar, Context must stay alive until it's done
+		void Begin(Node* const pStartNode, Node* const pDestinationNode, PathSearchContext& Context);
+		bool Step(int MaxExpansions);
+		bool IsDone() const { return SlicedSearch.bDone; }
+		bool HasFoundDestination() const { return SlicedSearch.bFoundDestination && !SlicedSearch.bIsUnreachable; }
+		std::span<Node* const> GetResult(); // the view lives in Context until the next GetResult or query
 
-		// stores the optimal connection to a node and its total costs related to the start and end node of the path
-		struct NodeRecord final
+		// Anytime Repairing A* (ARA*), for when a good path now beats the best path later. The first pass inflates the heuristic
+		// by InitialEpsilon, which finds a path costing at most Epsilon times the optimal one after few expansions. Every next
+		// pass lowers Epsilon by EpsilonStep (at least MinEpsilonStep) and reuses the costs found so far, only the nodes whose
+		// cost improved are expanded again. Each pass hands its path to OnPath with the proven bound, the search is done once
+		// that bound reaches 1. The bound only holds for an admissible heuristic, one that never rates a node above its real
+		// cost to the destination. With any other heuristic the bound means nothing and the last path may not be optimal.
+		// StepAnytime runs passes until BudgetMs is used up, stop calling it when the path is good enough or time is out.
+		// Shares its state with the time sliced search above, one of the two at a time (IsDone and GetResult work for both,
+		// without a path GetResult leads to the expanded node closest to the destination)
+		using AnytimePathCallback = std::function<void(std::span<Node* const> Path, float Epsilon)>;
+		static float constexpr MinEpsilonStep = 0.01f;
+		void BeginAnytime(Node* const pStartNode, Node* const pDestinationNode, PathSearchContext& Context, float InitialEpsilon,
+			AnytimePathCallback OnPath, float EpsilonStep = 0.5f);
+		bool StepAnytime(double BudgetMs); // true once the path is optimal or there is none
+		float GetEpsilon() const { return Anytime.PublishedEpsilon; } // bound of the last published path, 0 before the first one
+		float GetInflation() const { return Anytime.Epsilon; } // of the running pass
+
+		// Nodes the filter rejects are never entered, e.g. to keep a search inside one cluster
+		void SetNodeFilter(std::function<bool(int)> Filter) { NodeFilter = std::move(Filter); }
+
+		// Node to node searches check the components first. A destination in another component than the start isn't
+		// searched for until the graph runs dry, the path goes straight to the fallback: the node of the start's
+		// component the heuristic rates closest to the destination. Ignored while stale or with a node filter
+		void SetComponents(ConnectedComponents const* pConnectedComponents) { pComponents = pConnectedComponents; }
+
+	private:
+		// Progress of a node to node search, lives on the stack in FindPath and in this AStar when time sliced
+		struct SearchState
 		{
-			Node* pNode = nullptr;
-			Connection* pConnection = nullptr;
-			float costSoFar = 0.f; // accumulated g-costs of all the connections leading up to this one
-			float estimatedTotalCost = 0.f; // f-cost (= costSoFar + h-cost)
-
-			bool operator==(const NodeRecord& other) const
-			{
-				return pNode == other.pNode
-					&& pConnection == other.pConnection
-					&& costSoFar == other.costSoFar
-					&& estimatedTotalCost == other.estimatedTotalCost;
-			};
-
-			bool operator<(const NodeRecord& other) const
-			{
-				return estimatedTotalCost < other.estimatedTotalCost;
-			};
+			Node* pStartNode{nullptr};
+			Node* pDestinationNode{nullptr}; // the fallback when the real one can't be reached, see SetComponents
+			int ClosestNodeId{Graphs::InvalidNodeId}; // expanded node closest to the goal, the fallback when it can't be reached
+			float ClosestHeuristic{std::numeric_limits<float>::max()};
+			bool bFoundDestination{false};
+			bool bIsUnreachable{false};
+			bool bDone{false};
 		};
 
-		std::vector<Node*> FindPath(Node* const pStartNode, Node* const pDestinationNode);
+		void BeginSearch(Node* const pStartNode, Node* const pDestinationNode, SearchState& Search, PathSearchContext& Context) const;
+		bool ExpandNext(SearchState& Search, PathSearchContext& Context) const; // true when the destination was popped
+		std::span<Node* const> BuildPath(SearchState const& Search, PathSearchContext& Context) const;
+
+		// Progress of an ARA* search on top of SlicedSearch
+		struct AnytimeState
+		{
+			float Epsilon{1.f};
+			float EpsilonStep{0.5f};
+			float PublishedEpsilon{0.f};
+			AnytimePathCallback OnPath{};
+			std::vector<int> ClosedIds{}; // of the running pass
+			std::vector<int> InconsistentIds{}; // closed this pass and improved afterwards, may hold duplicates
+		};
+
+		bool ImprovePath(int MaxExpansions); // true when the running ARA* pass is done
+		void PublishAnytimePath();
+		void BeginNextAnytimePass();
 
-	private:
 		float GetHeuristicCost(Node* const pStartNode, Node* const pEndNode) const;
+		Node* FindClosestReachableNode(Node* const pStartNode, Node* const pDestinationNode) const;
+
+		Graph const* pGraph;
+		GridGraph const* pGrid; // pGraph when it's a grid
+		HeuristicFunctions::Heuristic HeuristicFunction{nullptr};
+		HeuristicFunctions::NodeHeuristic NodeHeuristicFunction{}; // used instead of HeuristicFunction when set
+		std::function<bool(int)> NodeFilter{};
+		ConnectedComponents const* pComponents{nullptr};
+
+		// Used by the context-less FindPath, kept between its queries
+		PathSearchContext DefaultContext{};
 
-		Graph* pGraph;
-		HeuristicFunctions::Heuristic HeuristicFunction;
+		SearchState SlicedSearch{.bDone = true};
+		PathSearchContext* pSlicedContext{nullptr};
+		AnytimeState Anytime{};
 	};
 }
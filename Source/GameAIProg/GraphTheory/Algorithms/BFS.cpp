@@ -5,11 +5,13 @@
 #include <algorithm> 
 
 #include "Shared/Graph/Graph.h"
+#include "Shared/Graph/GridGraph/GridGraph.h"
 
 using namespace GameAI;
 
 BFS::BFS(Graph* const pGraph)
 	: pGraph(pGraph)
+	, pGrid(dynamic_cast<GridGraph const*>(pGraph))
 {
 }
 
@@ -31,6 +33,7 @@ std::vector<Node*> BFS::FindPath(Node* const pStartNode, Node* const pDestinatio
 	
 	openList.push(pStartNode);
 	visited[pStartNode] = true; 
+	NrExpanded = 0;
 
 	bool bFoundDestination = false;
 
@@ -40,6 +43,7 @@ std::vector<Node*> BFS::FindPath(Node* const pStartNode, Node* const pDestinatio
 		// Get next node to process
 		Node* currentNode = openList.front();
 		openList.pop();
+		++NrExpanded;
 
 		// If reached goal then stop
 		if (currentNode == pDestinationNode)
@@ -48,12 +52,10 @@ std::vector<Node*> BFS::FindPath(Node* const pStartNode, Node* const pDestinatio
 			break;
 		}
 
-		// Check all neighbors of current node
-		auto connections = pGraph->FindConnectionsFrom(currentNode->GetId());
-		for (auto* connection : connections)
+		auto const visitNeighbor = [&](int neighborId)
 		{
 			// Get neighbor node
-			Node* neighborNode = pGraph->GetNode(connection->GetToId()).get();
+			Node* neighborNode = pGraph->GetNode(neighborId).get();
 
 			// If not visited yet
 			if (!visited[neighborNode])
@@ -62,6 +64,19 @@ std::vector<Node*> BFS::FindPath(Node* const pStartNode, Node* const pDestinatio
 				parentMap[neighborNode] = currentNode; // Remember how we got here
 				openList.push(neighborNode); // Explore it later
 			}
+		};
+
+		// Check all neighbors of current node, on a grid straight from its cell layer
+		if (pGrid != nullptr && pGrid->IsCellLayerInSync())
+		{
+			pGrid->ForEachWalkableNeighbour(currentNode->GetId(), [&visitNeighbor](int neighborId, float) { visitNeighbor(neighborId); });
+			continue;
+		}
+
+		auto const connections = pGraph->GetConnectionsFrom(currentNode->GetId());
+		for (auto* connection : connections)
+		{
+			visitNeighbor(connection->GetToId());
 		}
 	}
 
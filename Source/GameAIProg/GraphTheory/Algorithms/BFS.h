@@ -4,6 +4,7 @@
 namespace GameAI
 {
 	class Graph;
+	class GridGraph;
 	class Node;
 
 	class BFS
@@ -13,7 +14,11 @@ namespace GameAI
 
 		std::vector<Node*> FindPath(Node* const pStartNode, Node* const pDestinationNode) const;
 
+		int GetExpandedNodeCount() const { return NrExpanded; } // of the last query
+
 	private:
 		Graph* pGraph;
+		GridGraph const* pGrid; // pGraph when it's a grid, its neighbours come from the cell layer
+		mutable int NrExpanded{0};
 	};
 }
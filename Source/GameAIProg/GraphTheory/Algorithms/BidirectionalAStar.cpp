@@ -0,0 +1,155 @@
+﻿#include "BidirectionalAStar.h"
+#include <algorithm>
+#include <limits>
+
+using namespace GameAI;
+
+BidirectionalAStar::BidirectionalAStar(Graph* const pGraph, HeuristicFunctions::Heuristic hFunction)
+	: pGraph(pGraph)
+	, HeuristicFunction(hFunction)
+{
+}
+
+std::vector<Node*> BidirectionalAStar::FindPath(Node* const pStartNode, Node* const pDestinationNode)
+{
+	auto const path = FindPath(pStartNode, pDestinationNode, DefaultForwardContext, DefaultBackwardContext);
+	return std::vector<Node*>{path.begin(), path.end()};
+}
+
+std::span<Node* const> BidirectionalAStar::FindPath(Node* const pStartNode, Node* const pDestinationNode,
+	PathSearchContext& Forward, PathSearchContext& Backward) const
+{
+	// If start or destination is missing, stop
+	if (!pStartNode || !pDestinationNode)
+	{
+		return {};
+	}
+
+	int const nrNodes = static_cast<int>(pGraph->GetNodes().size());
+	Forward.BeginQuery(nrNodes);
+	Backward.BeginQuery(nrNodes);
+	std::vector<Node*>& path = Forward.GetPathBuffer();
+
+	int const startId = pStartNode->GetId();
+	int const destinationId = pDestinationNode->GetId();
+
+	// Seed both searches, the backward one estimates towards the start
+	auto const seed = [](PathSearchContext& Context, int Id, float Estimate)
+	{
+		NodeRecord& record = Context.GetRecords().Get(Id);
+		record.CostSoFar = 0.f;
+		record.EstimatedTotalCost = Estimate;
+		record.State = NodeRecordState::Open;
+		Context.GetOpenList().Push(Id, Estimate);
+	};
+	seed(Forward, startId, GetHeuristicCost(startId, destinationId));
+	seed(Backward, destinationId, GetHeuristicCost(destinationId, startId));
+
+	// Cheapest path found so far goes through meetingId
+	float bestCost = startId == destinationId ? 0.f : std::numeric_limits<float>::max();
+	int meetingId = startId == destinationId ? startId : Graphs::InvalidNodeId;
+
+	// Closest expanded node to the goal, used as fallback when the goal can't be reached (like AStar)
+	int closestNodeId = Graphs::InvalidNodeId;
+	float closestHeuristic = std::numeric_limits<float>::max();
+
+	while (!Forward.GetOpenList().IsEmpty() && !Backward.GetOpenList().IsEmpty())
+	{
+		// Neither side can improve on the best meeting anymore
+		if (std::max(Forward.GetOpenList().TopKey(), Backward.GetOpenList().TopKey()) >= bestCost) break;
+
+		bool const bExpandForward = Forward.GetOpenList().Size() <= Backward.GetOpenList().Size();
+		PathSearchContext& current = bExpandForward ? Forward : Backward;
+		NodeRecordTable& otherRecords = bExpandForward ? Backward.GetRecords() : Forward.GetRecords();
+		int const targetId = bExpandForward ? destinationId : startId;
+
+		int const currentId = current.GetOpenList().Pop();
+		current.CountExpansion();
+
+		NodeRecord& currentRecord = current.GetRecords().Get(currentId);
+		currentRecord.State = NodeRecordState::Closed;
+
+		if (bExpandForward)
+		{
+			if (float const heuristicToGoal = GetHeuristicCost(currentId, destinationId); heuristicToGoal < closestHeuristic)
+			{
+				closestHeuristic = heuristicToGoal;
+				closestNodeId = currentId;
+			}
+		}
+
+		// Forward follows the outgoing connections, backward the incoming ones
+		auto const connections = bExpandForward ? pGraph->GetConnectionsFrom(currentId) : pGraph->GetConnectionsTo(currentId);
+		for (Connection* connection : connections)
+		{
+			int const nextId = bExpandForward ? connection->GetToId() : connection->GetFromId();
+			float const totalGCost = currentRecord.CostSoFar + connection->GetWeight();
+
+			// Skip if existing path (open or closed) is cheaper, otherwise (re)open the node
+			NodeRecord& nextRecord = current.GetRecords().Get(nextId);
+			if (nextRecord.State != NodeRecordState::Unvisited && nextRecord.CostSoFar <= totalGCost)
+			{
+				continue;
+			}
+
+			nextRecord.pConnection = connection;
+			nextRecord.CostSoFar = totalGCost;
+			nextRecord.EstimatedTotalCost = totalGCost + GetHeuristicCost(nextId, targetId);
+			nextRecord.State = NodeRecordState::Open;
+			current.GetOpenList().PushOrDecrease(nextId, nextRecord.EstimatedTotalCost);
+
+			// Reached a node the other side has seen
+			if (NodeRecord const* otherRecord = otherRecords.Find(nextId);
+				otherRecord && totalGCost + otherRecord->CostSoFar < bestCost)
+			{
+				bestCost = totalGCost + otherRecord->CostSoFar;
+				meetingId = nextId;
+			}
+		}
+	}
+
+	if (meetingId != Graphs::InvalidNodeId)
+	{
+		// Start .. meeting node over the forward records
+		int currentId = meetingId;
+		while (currentId != startId)
+		{
+			path.push_back(pGraph->GetNode(currentId).get());
+			currentId = Forward.GetRecords().Find(currentId)->pConnection->GetFromId();
+		}
+		path.push_back(pStartNode);
+		std::reverse(path.begin(), path.end());
+
+		// Meeting node .. destination over the backward records, they point towards the destination
+		currentId = meetingId;
+		while (currentId != destinationId)
+		{
+			currentId = Backward.GetRecords().Find(currentId)->pConnection->GetToId();
+			path.push_back(pGraph->GetNode(currentId).get());
+		}
+	}
+	else if (closestNodeId != Graphs::InvalidNodeId)
+	{
+		// Destination wasn't reached, backtrack from the closest node instead
+		int currentId = closestNodeId;
+		while (currentId != startId)
+		{
+			path.push_back(pGraph->GetNode(currentId).get());
+			currentId = Forward.GetRecords().Find(currentId)->pConnection->GetFromId();
+		}
+		path.push_back(pStartNode);
+		std::reverse(path.begin(), path.end());
+	}
+
+	Forward.EndQuery();
+	Backward.EndQuery();
+	return Forward.GetPath();
+}
+
+float BidirectionalAStar::GetHeuristicCost(int FromId, int ToId) const
+{
+	// Distance from start to destination
+	FVector2D const toDestination = pGraph->GetNode(ToId)->GetPosition() - pGraph->GetNode(FromId)->GetPosition();
+	// Apply the selected heuristic
+	return HeuristicFunction(abs(toDestination.X), abs(toDestination.Y));
+}
@@ -0,0 +1,37 @@
+﻿#pragma once
+
+#include <span>
+#include <vector>
+#include "Shared/Graph/Graph.h"
+#include "Heuristics.h"
+#include "PathSearchContext.h"
+
+namespace GameAI
+{
+	// A* from both ends at once, the backward search walks the incoming connections so directed graphs work too.
+	// Every step expands the side with the smaller open list. Whenever one side reaches a node the other side
+	// has seen, the combined cost is a candidate path, and the search stops once neither open list can beat
+	// the best candidate anymore. Optimal under the same (admissible heuristic) conditions as AStar
+	class BidirectionalAStar
+	{
+	public:
+		BidirectionalAStar(Graph* const pGraph, HeuristicFunctions::Heuristic hFunction);
+
+		std::vector<Node*> FindPath(Node* const pStartNode, Node* const pDestinationNode);
+
+		// The path ends up in Forward, its view lives there until Forward's next query.
+		// Expanded nodes are counted per direction, in both contexts
+		std::span<Node* const> FindPath(Node* const pStartNode, Node* const pDestinationNode,
+			PathSearchContext& Forward, PathSearchContext& Backward) const;
+
+	private:
+		float GetHeuristicCost(int FromId, int ToId) const;
+
+		Graph* pGraph;
+		HeuristicFunctions::Heuristic HeuristicFunction;
+
+		// Used by the context-less FindPath, kept between its queries
+		PathSearchContext DefaultForwardContext{};
+		PathSearchContext DefaultBackwardContext{};
+	};
+}
@@ -0,0 +1,116 @@
+﻿#include "BidirectionalBFS.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "Shared/Graph/Graph.h"
+
+using namespace GameAI;
+
+BidirectionalBFS::BidirectionalBFS(Graph* const pGraph)
+	: pGraph(pGraph)
+{
+}
+
+std::vector<Node*> BidirectionalBFS::FindPath(Node* const pStartNode, Node* const pDestinationNode)
+{
+	std::vector<Node*> path;
+
+	// If start or destination missing then no path
+	if (!pStartNode || !pDestinationNode)
+	{
+		return path;
+	}
+
+	int const nrNodes = static_cast<int>(pGraph->GetNodes().size());
+	Forward.BeginQuery(nrNodes);
+	Backward.BeginQuery(nrNodes);
+
+	int const startId = pStartNode->GetId();
+	int const destinationId = pDestinationNode->GetId();
+
+	// Records hold the depth and the parent connection, the layers the frontier of each side
+	auto const seed = [](PathSearchContext& Context, std::vector<int>& Layer, int Id)
+	{
+		NodeRecord& record = Context.GetRecords().Get(Id);
+		record.CostSoFar = 0.f;
+		record.State = NodeRecordState::Open;
+		Layer.assign(1, Id);
+	};
+	seed(Forward, ForwardLayer, startId);
+	seed(Backward, BackwardLayer, destinationId);
+
+	int meetingId = startId == destinationId ? startId : Graphs::InvalidNodeId;
+	float bestLength = meetingId != Graphs::InvalidNodeId ? 0.f : std::numeric_limits<float>::max();
+
+	// If both sides have nodes left and haven't met, expand the next layer of the smaller one
+	while (meetingId == Graphs::InvalidNodeId && !ForwardLayer.empty() && !BackwardLayer.empty())
+	{
+		bool const bExpandForward = ForwardLayer.size() <= BackwardLayer.size();
+		PathSearchContext& current = bExpandForward ? Forward : Backward;
+		NodeRecordTable const& otherRecords = bExpandForward ? Backward.GetRecords() : Forward.GetRecords();
+		std::vector<int>& currentLayer = bExpandForward ? ForwardLayer : BackwardLayer;
+
+		// The whole layer is expanded, every meeting in it has to be looked at to get the shortest one
+		for (int const currentId : currentLayer)
+		{
+			current.CountExpansion();
+			NodeRecord& currentRecord = current.GetRecords().Get(currentId);
+			currentRecord.State = NodeRecordState::Closed;
+
+			// Forward follows the outgoing connections, backward the incoming ones
+			auto const connections = bExpandForward ? pGraph->GetConnectionsFrom(currentId) : pGraph->GetConnectionsTo(currentId);
+			for (Connection* connection : connections)
+			{
+				int const neighborId = bExpandForward ? connection->GetToId() : connection->GetFromId();
+
+				// If not visited yet
+				NodeRecord& neighborRecord = current.GetRecords().Get(neighborId);
+				if (neighborRecord.State != NodeRecordState::Unvisited) continue;
+
+				neighborRecord.pConnection = connection; // Remember how we got here
+				neighborRecord.CostSoFar = currentRecord.CostSoFar + 1.f;
+				neighborRecord.State = NodeRecordState::Open;
+				NextLayer.push_back(neighborId);
+
+				// The other side has been here
+				if (NodeRecord const* otherRecord = otherRecords.Find(neighborId);
+					otherRecord && neighborRecord.CostSoFar + otherRecord->CostSoFar < bestLength)
+				{
+					bestLength = neighborRecord.CostSoFar + otherRecord->CostSoFar;
+					meetingId = neighborId;
+				}
+			}
+		}
+
+		// Explore the next layer later
+		currentLayer.swap(NextLayer);
+		NextLayer.clear();
+	}
+
+	// Rebuild path if the searches met
+	if (meetingId != Graphs::InvalidNodeId)
+	{
+		// Walk back to start using the forward parents
+		int currentId = meetingId;
+		while (currentId != startId)
+		{
+			path.push_back(pGraph->GetNode(currentId).get());
+			currentId = Forward.GetRecords().Find(currentId)->pConnection->GetFromId();
+		}
+		path.push_back(pStartNode);
+		std::reverse(path.begin(), path.end());
+
+		// Walk on to the destination using the backward parents
+		currentId = meetingId;
+		while (currentId != destinationId)
+		{
+			currentId = Backward.GetRecords().Find(currentId)->pConnection->GetToId();
+			path.push_back(pGraph->GetNode(currentId).get());
+		}
+	}
+
+	Forward.EndQuery();
+	Backward.EndQuery();
+	return path; // Empty if no path found
+}
@@ -0,0 +1,33 @@
+﻿#pragma once
+#include <vector>
+
+#include "PathSearchContext.h"
+
+namespace GameAI
+{
+	class Graph;
+	class Node;
+
+	// BFS from both ends, one whole layer at a time from the side with the smaller frontier.
+	// The backward side walks the incoming connections, so directed graphs work too.
+	// Shortest in number of connections, like BFS
+	class BidirectionalBFS
+	{
+	public:
+		BidirectionalBFS(Graph* const pGraph);
+
+		std::vector<Node*> FindPath(Node* const pStartNode, Node* const pDestinationNode);
+
+		int GetExpandedNodeCount() const { return Forward.GetExpandedNodeCount() + Backward.GetExpandedNodeCount(); }
+
+	private:
+		Graph* pGraph;
+
+		// Scratch memory, kept between queries
+		PathSearchContext Forward{};
+		PathSearchContext Backward{};
+		std::vector<int> ForwardLayer{};
+		std::vector<int> BackwardLayer{};
+		std::vector<int> NextLayer{};
+	};
+}
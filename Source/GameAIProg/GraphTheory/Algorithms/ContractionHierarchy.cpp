@@ -0,0 +1,351 @@
+﻿#include "ContractionHierarchy.h"
+#include <algorithm>
+#include <limits>
+
+#include "Shared/Graph/Graph.h"
+
+using namespace GameAI;
+
+namespace
+{
+	float constexpr Unreachable = std::numeric_limits<float>::max();
+
+	// Witness searches only have to be good enough to skip most shortcuts, a missed witness just adds a spare one
+	int constexpr MaxWitnessSettledNodes = 64;
+}
+
+struct ContractionHierarchy::BuildState
+{
+	std::vector<std::vector<Edge>> Adjacency{}; // both directions, may still point at contracted nodes
+	std::vector<uint8_t> Contracted{};
+	std::vector<int> NrContractedNeighbours{};
+
+	// Witness search scratch
+	IndexedHeap<4> OpenList{};
+	std::vector<float> Costs{};
+	std::vector<int> Touched{};
+};
+
+ContractionHierarchy::ContractionHierarchy(Graph const* pGraph)
+	: pGraph(pGraph)
+{
+	Build();
+}
+
+void ContractionHierarchy::Build()
+{
+	double const StartTime = FPlatformTime::Seconds();
+
+	bIsValid = !pGraph->GetIsDirectional();
+	if (!bIsValid)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("ContractionHierarchy: only undirected graphs are supported"));
+		return;
+	}
+
+	int const NrNodes = static_cast<int>(pGraph->GetNodes().size());
+	BuildState State{};
+	State.Adjacency.assign(NrNodes, {});
+	State.Contracted.assign(NrNodes, 0);
+	State.NrContractedNeighbours.assign(NrNodes, 0);
+	State.Costs.assign(NrNodes, Unreachable);
+	State.OpenList.Reserve(NrNodes);
+	for (auto const& pConnection : pGraph->GetConnections())
+	{
+		State.Adjacency[pConnection->GetFromId()].push_back(Edge{pConnection->GetToId(), pConnection->GetWeight(), Graphs::InvalidNodeId});
+	}
+
+	// Contract the nodes in order of edge difference (shortcuts added - edges removed), plus the number of
+	// contracted neighbours to spread contractions evenly. Priorities go stale as the graph changes,
+	// so they are recomputed lazily when a node reaches the top
+	IndexedHeap<4> Queue{};
+	Queue.Reserve(NrNodes);
+	auto const GetPriority = [&](int NodeId)
+	{
+		return static_cast<float>(ContractNode(State, NodeId, true)) + State.NrContractedNeighbours[NodeId];
+	};
+	for (int NodeId = 0; NodeId < NrNodes; ++NodeId)
+	{
+		Queue.Push(NodeId, GetPriority(NodeId));
+	}
+
+	Ranks.assign(NrNodes, 0);
+	std::vector<std::vector<Edge>> UpAdjacency(NrNodes);
+	NrShortcuts = 0;
+	int NextRank = 0;
+	while (!Queue.IsEmpty())
+	{
+		int const NodeId = Queue.Top();
+		if (float const Priority = GetPriority(NodeId); Priority > Queue.TopKey())
+		{
+			Queue.Update(NodeId, Priority);
+			continue;
+		}
+		Queue.Pop();
+
+		// Every edge still leading to an uncontracted node goes up in the hierarchy
+		for (Edge const& Neighbour : State.Adjacency[NodeId])
+		{
+			if (State.Contracted[Neighbour.ToId]) continue;
+			UpAdjacency[NodeId].push_back(Neighbour);
+			++State.NrContractedNeighbours[Neighbour.ToId];
+		}
+
+		NrShortcuts += ContractNode(State, NodeId, false);
+		State.Contracted[NodeId] = 1;
+		Ranks[NodeId] = NextRank++;
+	}
+
+	UpOffsets.assign(NrNodes + 1, 0);
+	UpEdges.clear();
+	for (int NodeId = 0; NodeId < NrNodes; ++NodeId)
+	{
+		UpEdges.insert(UpEdges.end(), UpAdjacency[NodeId].begin(), UpAdjacency[NodeId].end());
+		UpOffsets[NodeId + 1] = static_cast<int>(UpEdges.size());
+	}
+	UpEdges.shrink_to_fit();
+
+	BuildTimeMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+	UE_LOG(LogTemp, Log, TEXT("ContractionHierarchy: %d nodes, %d shortcuts in %.2f ms"), NrNodes, NrShortcuts, BuildTimeMs);
+}
+
+int ContractionHierarchy::ContractNode(BuildState& State, int NodeId, bool bSimulate)
+{
+	// Edge difference when simulating, the number of shortcuts added otherwise
+	int NrShortcutsNeeded = 0;
+	int NrRemovedEdges = 0;
+
+	// Shortcuts only ever go between neighbours, so this list doesn't change below
+	std::vector<Edge> const& Neighbours = State.Adjacency[NodeId];
+	for (Edge const& In : Neighbours)
+	{
+		if (State.Contracted[In.ToId]) continue;
+		++NrRemovedEdges;
+
+		// Furthest neighbour through NodeId bounds the witness search
+		float MaxCost = 0.f;
+		for (Edge const& Out : Neighbours)
+		{
+			if (Out.ToId != In.ToId && !State.Contracted[Out.ToId]) MaxCost = std::max(MaxCost, In.Cost + Out.Cost);
+		}
+		if (MaxCost == 0.f) continue;
+		FindWitnesses(State, In.ToId, NodeId, MaxCost);
+
+		// Undirected, so every pair is handled once from the side with the lower id
+		for (Edge const& Out : Neighbours)
+		{
+			if (Out.ToId <= In.ToId || State.Contracted[Out.ToId]) continue;
+
+			float const ViaCost = In.Cost + Out.Cost;
+			if (State.Costs[Out.ToId] <= ViaCost) continue; // a path around NodeId is as good
+
+			++NrShortcutsNeeded;
+			if (bSimulate) continue;
+
+			// Add both directions, or make an existing edge cheaper
+			auto const AddShortcut = [&](int FromId, int ToId)
+			{
+				auto& Edges = State.Adjacency[FromId];
+				auto const Existing = std::ranges::find_if(Edges, [ToId](Edge const& E) { return E.ToId == ToId; });
+				if (Existing == Edges.end())
+				{
+					Edges.push_back(Edge{ToId, ViaCost, NodeId});
+				}
+				else if (Existing->Cost > ViaCost)
+				{
+					*Existing = Edge{ToId, ViaCost, NodeId};
+				}
+			};
+			AddShortcut(In.ToId, Out.ToId);
+			AddShortcut(Out.ToId, In.ToId);
+		}
+	}
+
+	return bSimulate ? NrShortcutsNeeded - NrRemovedEdges : NrShortcutsNeeded;
+}
+
+void ContractionHierarchy::FindWitnesses(BuildState& State, int SourceId, int SkippedId, float MaxCost) const
+{
+	// Local Dijkstra among the uncontracted nodes that avoids SkippedId, costs stay in State.Costs until the next call
+	for (int const NodeId : State.Touched)
+	{
+		State.Costs[NodeId] = Unreachable;
+	}
+	State.Touched.clear();
+	State.OpenList.Clear();
+
+	State.Costs[SourceId] = 0.f;
+	State.Touched.push_back(SourceId);
+	State.OpenList.Push(SourceId, 0.f);
+
+	int NrSettled = 0;
+	while (!State.OpenList.IsEmpty() && NrSettled++ < MaxWitnessSettledNodes)
+	{
+		if (State.OpenList.TopKey() > MaxCost) break;
+		int const CurrentId = State.OpenList.Pop();
+
+		for (Edge const& Neighbour : State.Adjacency[CurrentId])
+		{
+			if (Neighbour.ToId == SkippedId || State.Contracted[Neighbour.ToId]) continue;
+
+			float const NewCost = State.Costs[CurrentId] + Neighbour.Cost;
+			if (NewCost >= State.Costs[Neighbour.ToId]) continue;
+
+			if (State.Costs[Neighbour.ToId] == Unreachable) State.Touched.push_back(Neighbour.ToId);
+			State.Costs[Neighbour.ToId] = NewCost;
+			State.OpenList.PushOrDecrease(Neighbour.ToId, NewCost);
+		}
+	}
+}
+
+std::span<Node* const> ContractionHierarchy::FindPath(Node* const pStartNode, Node* const pDestinationNode,
+	PathSearchContext& Forward, PathSearchContext& Backward) const
+{
+	if (!pStartNode || !pDestinationNode) return {};
+
+	PathSeed const Source{pStartNode->GetId(), 0.f};
+	PathSeed const Target{pDestinationNode->GetId(), 0.f};
+	return FindPath(std::span{&Source, 1}, std::span{&Target, 1}, Forward, Backward);
+}
+
+std::span<Node* const> ContractionHierarchy::FindPath(std::span<PathSeed const> Sources, std::span<PathSeed const> Targets,
+	PathSearchContext& Forward, PathSearchContext& Backward) const
+{
+	int const NrNodes = static_cast<int>(Ranks.size());
+	Forward.BeginQuery(NrNodes);
+	Backward.BeginQuery(NrNodes);
+	if (!bIsValid)
+	{
+		Forward.EndQuery();
+		Backward.EndQuery();
+		return {};
+	}
+
+	auto const Seed = [](PathSearchContext& Context, std::span<PathSeed const> Seeds)
+	{
+		for (PathSeed const& Seed : Seeds)
+		{
+			NodeRecord& Record = Context.GetRecords().Get(Seed.NodeId);
+			if (Record.State != NodeRecordState::Unvisited && Record.CostSoFar <= Seed.Cost) continue;
+
+			Record.CostSoFar = Seed.Cost;
+			Record.ParentId = Graphs::InvalidNodeId;
+			Record.State = NodeRecordState::Open;
+			Context.GetOpenList().PushOrDecrease(Seed.NodeId, Seed.Cost);
+		}
+	};
+	Seed(Forward, Sources);
+	Seed(Backward, Targets);
+
+	// Both searches only go up, they meet at the highest node of the path.
+	// A side is done once its cheapest open node can't beat the best meeting anymore
+	float BestCost = Unreachable;
+	int MeetingId = Graphs::InvalidNodeId;
+	auto const IsDone = [&BestCost](IndexedHeap<4> const& OpenList)
+	{
+		return OpenList.IsEmpty() || OpenList.TopKey() >= BestCost;
+	};
+	while (!IsDone(Forward.GetOpenList()) || !IsDone(Backward.GetOpenList()))
+	{
+		bool const bExpandForward = IsDone(Backward.GetOpenList())
+			|| (!IsDone(Forward.GetOpenList()) && Forward.GetOpenList().TopKey() <= Backward.GetOpenList().TopKey());
+		PathSearchContext& Current = bExpandForward ? Forward : Backward;
+		NodeRecordTable const& OtherRecords = bExpandForward ? Backward.GetRecords() : Forward.GetRecords();
+
+		int const CurrentId = Current.GetOpenList().Pop();
+		Current.CountExpansion();
+		NodeRecord& CurrentRecord = Current.GetRecords().Get(CurrentId);
+		CurrentRecord.State = NodeRecordState::Closed;
+
+		if (NodeRecord const* OtherRecord = OtherRecords.Find(CurrentId);
+			OtherRecord && CurrentRecord.CostSoFar + OtherRecord->CostSoFar < BestCost)
+		{
+			BestCost = CurrentRecord.CostSoFar + OtherRecord->CostSoFar;
+			MeetingId = CurrentId;
+		}
+
+		for (int EdgeIdx = UpOffsets[CurrentId]; EdgeIdx < UpOffsets[CurrentId + 1]; ++EdgeIdx)
+		{
+			Edge const& Up = UpEdges[EdgeIdx];
+			float const NewCost = CurrentRecord.CostSoFar + Up.Cost;
+
+			NodeRecord& NextRecord = Current.GetRecords().Get(Up.ToId);
+			if (NextRecord.State != NodeRecordState::Unvisited && NextRecord.CostSoFar <= NewCost) continue;
+
+			NextRecord.CostSoFar = NewCost;
+			NextRecord.ParentId = CurrentId;
+			NextRecord.State = NodeRecordState::Open;
+			Current.GetOpenList().PushOrDecrease(Up.ToId, NewCost);
+		}
+	}
+
+	std::vector<Node*>& Path = Forward.GetPathBuffer();
+	if (MeetingId != Graphs::InvalidNodeId)
+	{
+		// Forward half: walk back from the meeting node to the source, unpacking every edge.
+		// Segments are reversed as they're added and the whole half is flipped once at the end
+		int SourceId = MeetingId;
+		for (int ParentId = Forward.GetRecords().Find(SourceId)->ParentId; ParentId != Graphs::InvalidNodeId;
+			ParentId = Forward.GetRecords().Find(SourceId)->ParentId)
+		{
+			size_t const SegmentStart = Path.size();
+			UnpackEdge(ParentId, SourceId, Path);
+			std::reverse(Path.begin() + SegmentStart, Path.end());
+			SourceId = ParentId;
+		}
+		Path.push_back(pGraph->GetNode(SourceId).get());
+		std::reverse(Path.begin(), Path.end());
+
+		// Backward half: parents point towards the target
+		for (int ChildId = MeetingId; Backward.GetRecords().Find(ChildId)->ParentId != Graphs::InvalidNodeId;)
+		{
+			int const ParentId = Backward.GetRecords().Find(ChildId)->ParentId;
+			UnpackEdge(ChildId, ParentId, Path);
+			ChildId = ParentId;
+		}
+	}
+
+	Forward.EndQuery();
+	Backward.EndQuery();
+	return Forward.GetPath();
+}
+
+ContractionHierarchy::Edge const* ContractionHierarchy::FindUpEdge(int FromId, int ToId) const
+{
+	// Stored at the lower ranked end only
+	int const LowId = Ranks[FromId] < Ranks[ToId] ? FromId : ToId;
+	int const HighId = LowId == FromId ? ToId : FromId;
+	for (int EdgeIdx = UpOffsets[LowId]; EdgeIdx < UpOffsets[LowId + 1]; ++EdgeIdx)
+	{
+		if (UpEdges[EdgeIdx].ToId == HighId) return &UpEdges[EdgeIdx];
+	}
+	return nullptr;
+}
+
+void ContractionHierarchy::UnpackEdge(int FromId, int ToId, std::vector<Node*>& OutPath) const
+{
+	// Appends the original nodes after FromId up to and including ToId.
+	// Iterative, shortcuts of shortcuts nest as deep as the hierarchy
+	std::vector<std::pair<int, int>> Pending{{FromId, ToId}};
+	while (!Pending.empty())
+	{
+		auto const [SegmentFrom, SegmentTo] = Pending.back();
+		Pending.pop_back();
+
+		Edge const* pEdge = FindUpEdge(SegmentFrom, SegmentTo);
+		if (pEdge == nullptr || pEdge->MiddleId == Graphs::InvalidNodeId)
+		{
+			OutPath.push_back(pGraph->GetNode(SegmentTo).get());
+			continue;
+		}
+
+		// Second half goes on the stack first so the first half is unpacked first
+		Pending.emplace_back(pEdge->MiddleId, SegmentTo);
+		Pending.emplace_back(SegmentFrom, pEdge->MiddleId);
+	}
+}
+
+size_t ContractionHierarchy::GetAllocatedBytes() const
+{
+	return Ranks.capacity() * sizeof(int) + UpOffsets.capacity() * sizeof(int) + UpEdges.capacity() * sizeof(Edge);
+}
@@ -0,0 +1,66 @@
+﻿#pragma once
+
+#include <span>
+#include <vector>
+#include "PathSearchContext.h"
+#include "SearchContainers.h"
+
+namespace GameAI
+{
+	class Graph;
+	class Node;
+
+	// Contraction Hierarchies for static undirected graphs (NavGraph).
+	// Building contracts the nodes one by one, cheapest first by edge difference, and adds a shortcut wherever
+	// removing a node would break a shortest path. Queries then run a bidirectional Dijkstra that only moves up
+	// the hierarchy and settles a few dozen nodes even on large graphs. Shortcuts are unpacked again,
+	// so the result is the same node sequence a search on the original graph gives (SSFA can use it as is).
+	// The graph must not change after Build
+	class ContractionHierarchy final
+	{
+	public:
+		explicit ContractionHierarchy(Graph const* pGraph);
+
+		void Build();
+		bool IsValid() const { return bIsValid; }
+
+		// Paths end up in Forward, the view lives there until Forward's next query
+		std::span<Node* const> FindPath(Node* const pStartNode, Node* const pDestinationNode,
+			PathSearchContext& Forward, PathSearchContext& Backward) const;
+		// Cheapest path from any source to any target, seed costs included
+		std::span<Node* const> FindPath(std::span<PathSeed const> Sources, std::span<PathSeed const> Targets,
+			PathSearchContext& Forward, PathSearchContext& Backward) const;
+
+		// Stats
+		double GetBuildTimeMs() const { return BuildTimeMs; }
+		int GetShortcutCount() const { return NrShortcuts; }
+		size_t GetAllocatedBytes() const;
+
+	private:
+		struct Edge final
+		{
+			int ToId;
+			float Cost;
+			int MiddleId; // contracted node a shortcut bypasses, InvalidNodeId for original connections
+		};
+
+		Graph const* pGraph;
+		bool bIsValid{false};
+
+		std::vector<int> Ranks{}; // contraction order per node
+		// Edges towards higher ranked nodes in compressed rows, node N owns UpEdges[UpOffsets[N] .. UpOffsets[N + 1])
+		std::vector<int> UpOffsets{};
+		std::vector<Edge> UpEdges{};
+
+		double BuildTimeMs{0.0};
+		int NrShortcuts{0};
+
+		// Build scratch, released afterwards
+		struct BuildState;
+		int ContractNode(BuildState& State, int NodeId, bool bSimulate);
+		void FindWitnesses(BuildState& State, int SourceId, int SkippedId, float MaxCost) const;
+
+		Edge const* FindUpEdge(int FromId, int ToId) const;
+		void UnpackEdge(int FromId, int ToId, std::vector<Node*>& OutPath) const;
+	};
+}
@@ -0,0 +1,210 @@
+﻿#include "DStarLite.h"
+#include <algorithm>
+#include <limits>
+
+using namespace GameAI;
+
+namespace
+{
+	float constexpr Infinity = std::numeric_limits<float>::infinity();
+}
+
+DStarLite::DStarLite(Graph* const pGraph, HeuristicFunctions::Heuristic hFunction)
+	: pGraph(pGraph)
+	, HeuristicFunction(hFunction)
+{
+}
+
+void DStarLite::Initialize(int StartNodeId, int GoalNodeId)
+{
+	StartId = StartNodeId;
+	LastStartId = StartNodeId;
+	GoalId = GoalNodeId;
+	KeyModifier = 0.f;
+
+	OpenList.Clear();
+	CostSoFar.assign(pGraph->GetNodes().size(), Infinity);
+	LookAheadCost.assign(pGraph->GetNodes().size(), Infinity);
+	Reserve(static_cast<int>(pGraph->GetNodes().size()));
+
+	// The search runs from the goal back to the start
+	LookAheadCost[GoalId] = 0.f;
+	OpenList.Push(GoalId, CalculateKey(GoalId));
+}
+
+void DStarLite::SetHeuristic(HeuristicFunctions::Heuristic hFunction)
+{
+	HeuristicFunction = hFunction;
+	if (IsInitialized())
+	{
+		Initialize(StartId, GoalId);
+	}
+}
+
+void DStarLite::SetStart(int StartNodeId)
+{
+	if (StartNodeId == StartId) return;
+
+	// Keys in the open list were computed with the old start, raising km keeps them lower bounds
+	KeyModifier += GetHeuristicCost(LastStartId, StartNodeId);
+	LastStartId = StartNodeId;
+	StartId = StartNodeId;
+}
+
+void DStarLite::UpdateNode(int NodeId)
+{
+	if (!IsInitialized() || NodeId < 0) return;
+
+	Reserve(static_cast<int>(pGraph->GetNodes().size()));
+	if (NodeId != GoalId)
+	{
+		LookAheadCost[NodeId] = GetBestSuccessorCost(NodeId);
+	}
+	UpdateVertex(NodeId);
+}
+
+std::span<Node* const> DStarLite::Replan()
+{
+	Path.clear();
+	NrExpanded = 0;
+	if (!IsInitialized() || StartId == Graphs::InvalidNodeId) return {};
+
+	// The search may stop with the start itself still open, its rhs is already exact then
+	ComputeShortestPath();
+	if (LookAheadCost[StartId] == Infinity) return {};
+
+	// Walk downhill over g, each step takes the cheapest connection + remaining cost
+	int currentId = StartId;
+	Path.push_back(pGraph->GetNode(currentId).get());
+	int const maxSteps = static_cast<int>(CostSoFar.size());
+	while (currentId != GoalId && static_cast<int>(Path.size()) <= maxSteps)
+	{
+		int bestId = Graphs::InvalidNodeId;
+		float bestCost = Infinity;
+		for (Connection const* connection : pGraph->GetConnectionsFrom(currentId))
+		{
+			float const cost = connection->GetWeight() + CostSoFar[connection->GetToId()];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestId = connection->GetToId();
+			}
+		}
+
+		// Safety check, can't happen while g is consistent
+		if (bestId == Graphs::InvalidNodeId)
+		{
+			Path.clear();
+			return {};
+		}
+
+		currentId = bestId;
+		Path.push_back(pGraph->GetNode(currentId).get());
+	}
+	return Path;
+}
+
+DStarLite::Key DStarLite::CalculateKey(int NodeId) const
+{
+	float const cost = std::min(CostSoFar[NodeId], LookAheadCost[NodeId]);
+	return Key{cost + GetHeuristicCost(StartId, NodeId) + KeyModifier, cost};
+}
+
+float DStarLite::GetHeuristicCost(int FromId, int ToId) const
+{
+	FVector2D const toDestination = pGraph->GetNode(ToId)->GetPosition() - pGraph->GetNode(FromId)->GetPosition();
+	return HeuristicFunction(abs(toDestination.X), abs(toDestination.Y));
+}
+
+float DStarLite::GetBestSuccessorCost(int NodeId) const
+{
+	float bestCost = Infinity;
+	for (Connection const* connection : pGraph->GetConnectionsFrom(NodeId))
+	{
+		bestCost = std::min(bestCost, connection->GetWeight() + CostSoFar[connection->GetToId()]);
+	}
+	return bestCost;
+}
+
+void DStarLite::UpdateVertex(int NodeId)
+{
+	bool const bConsistent = CostSoFar[NodeId] == LookAheadCost[NodeId];
+	bool const bOpen = OpenList.Contains(NodeId);
+
+	if (!bConsistent && bOpen)
+	{
+		OpenList.Update(NodeId, CalculateKey(NodeId));
+	}
+	else if (!bConsistent)
+	{
+		OpenList.Push(NodeId, CalculateKey(NodeId));
+	}
+	else if (bOpen)
+	{
+		OpenList.Remove(NodeId);
+	}
+}
+
+void DStarLite::ComputeShortestPath()
+{
+	while (!OpenList.IsEmpty() &&
+		(OpenList.TopKey() < CalculateKey(StartId) || LookAheadCost[StartId] > CostSoFar[StartId]))
+	{
+		int const currentId = OpenList.Top();
+		Key const oldKey = OpenList.TopKey();
+		Key const newKey = CalculateKey(currentId);
+		++NrExpanded;
+
+		if (oldKey < newKey)
+		{
+			// Stale key from before the start moved
+			OpenList.Update(currentId, newKey);
+		}
+		else if (CostSoFar[currentId] > LookAheadCost[currentId])
+		{
+			// Overconsistent: the node got cheaper, pass that on to its predecessors
+			CostSoFar[currentId] = LookAheadCost[currentId];
+			OpenList.Remove(currentId);
+			for (Connection const* connection : pGraph->GetConnectionsTo(currentId))
+			{
+				int const predecessorId = connection->GetFromId();
+				if (predecessorId != GoalId)
+				{
+					LookAheadCost[predecessorId] = std::min(LookAheadCost[predecessorId],
+						connection->GetWeight() + CostSoFar[currentId]);
+				}
+				UpdateVertex(predecessorId);
+			}
+		}
+		else
+		{
+			// Underconsistent: the node got more expensive, predecessors that relied on it look again
+			float const oldCost = CostSoFar[currentId];
+			CostSoFar[currentId] = Infinity;
+			for (Connection const* connection : pGraph->GetConnectionsTo(currentId))
+			{
+				int const predecessorId = connection->GetFromId();
+				if (predecessorId != GoalId && LookAheadCost[predecessorId] == connection->GetWeight() + oldCost)
+				{
+					LookAheadCost[predecessorId] = GetBestSuccessorCost(predecessorId);
+				}
+				UpdateVertex(predecessorId);
+			}
+			if (currentId != GoalId)
+			{
+				LookAheadCost[currentId] = GetBestSuccessorCost(currentId);
+			}
+			UpdateVertex(currentId);
+		}
+	}
+}
+
+void DStarLite::Reserve(int NrNodes)
+{
+	if (static_cast<int>(CostSoFar.size()) < NrNodes)
+	{
+		CostSoFar.resize(NrNodes, Infinity);
+		LookAheadCost.resize(NrNodes, Infinity);
+	}
+	OpenList.Reserve(NrNodes);
+}
@@ -0,0 +1,74 @@
+﻿#pragma once
+
+#include <compare>
+#include <span>
+#include <vector>
+#include "Heuristics.h"
+#include "SearchContainers.h"
+#include "Shared/Graph/Graph.h"
+
+namespace GameAI
+{
+	// D* Lite (Koenig & Likhachev): incremental A* that keeps its search state for a start/goal pair.
+	// It searches backwards from the goal, so after connections change only the affected part of the
+	// search is repaired, and the start may move along the path without starting over.
+	// Works on any Graph, but needs to be told which nodes had their connections changed
+	class DStarLite
+	{
+	public:
+		DStarLite(Graph* const pGraph, HeuristicFunctions::Heuristic hFunction);
+
+		// Throws away the search state and starts over for a new start/goal pair
+		void Initialize(int StartNodeId, int GoalNodeId);
+
+		// Keys depend on the heuristic, so a running search starts over
+		void SetHeuristic(HeuristicFunctions::Heuristic hFunction);
+
+		// The agent moved, the search state stays valid
+		void SetStart(int StartNodeId);
+
+		// Call for every node whose outgoing connections were added, removed or reweighted
+		void UpdateNode(int NodeId);
+
+		// Repairs the search and returns the path from start to goal, empty when the goal can't be reached.
+		// The view lives until the next Replan
+		std::span<Node* const> Replan();
+
+		bool IsInitialized() const { return GoalId != Graphs::InvalidNodeId; }
+		int GetStartId() const { return StartId; }
+		int GetGoalId() const { return GoalId; }
+
+		// Stats
+		int GetExpandedNodeCount() const { return NrExpanded; } // by the last Replan
+
+	private:
+		struct Key
+		{
+			float Primary; // min(g, rhs) + h + km
+			float Secondary; // min(g, rhs)
+
+			auto operator<=>(Key const&) const = default;
+		};
+
+		Graph* pGraph;
+		HeuristicFunctions::Heuristic HeuristicFunction;
+
+		int StartId{Graphs::InvalidNodeId};
+		int GoalId{Graphs::InvalidNodeId};
+		int LastStartId{Graphs::InvalidNodeId};
+		float KeyModifier{0.f}; // km, grows instead of re-keying the open list when the start moves
+
+		IndexedHeap<4, Key> OpenList{};
+		std::vector<float> CostSoFar{}; // g, cost from the node to the goal
+		std::vector<float> LookAheadCost{}; // rhs, one step lookahead of g
+		std::vector<Node*> Path{};
+		int NrExpanded{0};
+
+		Key CalculateKey(int NodeId) const;
+		float GetHeuristicCost(int FromId, int ToId) const;
+		float GetBestSuccessorCost(int NodeId) const;
+		void UpdateVertex(int NodeId);
+		void ComputeShortestPath();
+		void Reserve(int NrNodes);
+	};
+}
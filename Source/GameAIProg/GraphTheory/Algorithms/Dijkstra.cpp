@@ -0,0 +1,161 @@
+﻿#include "Dijkstra.h"
+#include <algorithm>
+
+#include "Shared/Graph/GridGraph/GridGraph.h"
+
+using namespace GameAI;
+
+Dijkstra::Dijkstra(Graph const* const pGraph)
+	: pGraph(pGraph)
+	, pGrid(dynamic_cast<GridGraph const*>(pGraph))
+{
+}
+
+Dijkstra::NearestGoal Dijkstra::FindNearestGoal(std::span<PathSeed const> Sources, std::span<int const> GoalIds,
+	PathSearchContext& Context, float MaxCost) const
+{
+	NearestGoal Result{};
+	if (Sources.empty() || GoalIds.empty())
+	{
+		return Result;
+	}
+
+	Context.BeginQuery(static_cast<int>(pGraph->GetNodes().size()));
+	NodeRecordTable& Records = Context.GetRecords();
+
+	// The goal marks live in the records of this query, nothing to clear afterwards
+	for (int const GoalId : GoalIds)
+	{
+		Records.Get(GoalId).bIsGoal = true;
+	}
+	OpenSources(Sources, Context);
+
+	if (int const GoalId = Settle(MaxCost, true, Context); GoalId != Graphs::InvalidNodeId)
+	{
+		Result.GoalId = GoalId;
+		Result.Cost = Records.Find(GoalId)->CostSoFar;
+		Result.Path = BuildPath(GoalId, Context);
+	}
+
+	Context.EndQuery();
+	return Result;
+}
+
+Dijkstra::NearestGoal Dijkstra::FindNearestGoal(Node* const pStartNode, std::span<int const> GoalIds, PathSearchContext& Context,
+	float MaxCost) const
+{
+	if (!pStartNode)
+	{
+		return NearestGoal{};
+	}
+
+	PathSeed const Source{pStartNode->GetId(), 0.f};
+	return FindNearestGoal(std::span<PathSeed const>{&Source, 1}, GoalIds, Context, MaxCost);
+}
+
+int Dijkstra::BuildDistanceField(std::span<PathSeed const> Sources, float MaxCost, PathSearchContext& Context) const
+{
+	Context.BeginQuery(static_cast<int>(pGraph->GetNodes().size()));
+	OpenSources(Sources, Context);
+	Settle(MaxCost, false, Context);
+	Context.EndQuery();
+
+	return Context.GetExpandedNodeCount();
+}
+
+float Dijkstra::GetCost(PathSearchContext const& Context, int NodeId)
+{
+	// Open records past the radius only hold an upper bound
+	NodeRecord const* pRecord = Context.GetRecords().Find(NodeId);
+	return pRecord && pRecord->State == NodeRecordState::Closed ? pRecord->CostSoFar : Unreachable;
+}
+
+std::span<Node* const> Dijkstra::GetPathTo(int NodeId, PathSearchContext& Context) const
+{
+	if (GetCost(Context, NodeId) == Unreachable)
+	{
+		Context.GetPathBuffer().clear();
+		return {};
+	}
+	return BuildPath(NodeId, Context);
+}
+
+void Dijkstra::OpenSources(std::span<PathSeed const> Sources, PathSearchContext& Context) const
+{
+	NodeRecordTable& Records = Context.GetRecords();
+	for (PathSeed const& Source : Sources)
+	{
+		NodeRecord& SourceRecord = Records.Get(Source.NodeId);
+		if (SourceRecord.State != NodeRecordState::Unvisited && SourceRecord.CostSoFar <= Source.Cost) continue;
+
+		SourceRecord.CostSoFar = Source.Cost;
+		SourceRecord.EstimatedTotalCost = Source.Cost;
+		SourceRecord.State = NodeRecordState::Open;
+		Context.GetOpenList().PushOrDecrease(Source.NodeId, Source.Cost);
+	}
+}
+
+int Dijkstra::Settle(float MaxCost, bool bStopAtGoal, PathSearchContext& Context) const
+{
+	IndexedHeap<4>& OpenList = Context.GetOpenList();
+	NodeRecordTable& Records = Context.GetRecords();
+
+	// Non-negative weights, so a popped node has its final cost and the first goal popped is the nearest one
+	while (!OpenList.IsEmpty() && OpenList.TopKey() <= MaxCost)
+	{
+		int const CurrentId = OpenList.Pop();
+		Context.CountExpansion();
+
+		NodeRecord& CurrentRecord = Records.Get(CurrentId);
+		CurrentRecord.State = NodeRecordState::Closed;
+		if (bStopAtGoal && CurrentRecord.bIsGoal)
+		{
+			return CurrentId;
+		}
+
+		auto const VisitNeighbour = [&](int NextId, float StepCost, Connection* pConnection)
+		{
+			float const NewCost = CurrentRecord.CostSoFar + StepCost;
+
+			NodeRecord& NextRecord = Records.Get(NextId);
+			if (NextRecord.State != NodeRecordState::Unvisited && NextRecord.CostSoFar <= NewCost) return;
+
+			NextRecord.pConnection = pConnection;
+			NextRecord.ParentId = CurrentId;
+			NextRecord.CostSoFar = NewCost;
+			NextRecord.EstimatedTotalCost = NewCost;
+			NextRecord.State = NodeRecordState::Open;
+			OpenList.PushOrDecrease(NextId, NewCost);
+		};
+
+		if (pGrid != nullptr && pGrid->IsCellLayerInSync())
+		{
+			pGrid->ForEachWalkableNeighbour(CurrentId, [&VisitNeighbour](int NextId, float StepCost)
+			{
+				VisitNeighbour(NextId, StepCost, nullptr);
+			});
+			continue;
+		}
+
+		for (Connection* const pConnection : pGraph->GetConnectionsFrom(CurrentId))
+		{
+			VisitNeighbour(pConnection->GetToId(), pConnection->GetWeight(), pConnection);
+		}
+	}
+	return Graphs::InvalidNodeId;
+}
+
+std::span<Node* const> Dijkstra::BuildPath(int NodeId, PathSearchContext& Context) const
+{
+	std::vector<Node*>& Path = Context.GetPathBuffer();
+	Path.clear();
+
+	// Sources have no parent
+	for (int CurrentId = NodeId; CurrentId != Graphs::InvalidNodeId; CurrentId = Context.GetRecords().Find(CurrentId)->ParentId)
+	{
+		Path.push_back(pGraph->GetNode(CurrentId).get());
+	}
+	std::reverse(Path.begin(), Path.end());
+
+	return Context.GetPath();
+}
@@ -0,0 +1,53 @@
+﻿#pragma once
+#include <limits>
+#include <span>
+
+#include "Shared/Graph/Graph.h"
+#include "PathSearchContext.h"
+
+namespace GameAI
+{
+	class GridGraph;
+
+	// Dijkstra from any number of sources at once, on the same record table and heap as A* (see PathSearchContext).
+	// FindNearestGoal answers "which of these goals is closest by path" with one search instead of one A* per goal:
+	// the first goal it settles is the nearest one. BuildDistanceField settles everything within a cost radius instead,
+	// the costs and parents stay in the Context's records until its next query.
+	// Searches follow the outgoing connections. On a GridGraph the neighbours come from its cell layer while it's in sync.
+	// The graph is only read, threads can share it as long as each one has its own Context
+	class Dijkstra final
+	{
+	public:
+		explicit Dijkstra(Graph const* const pGraph);
+
+		static float constexpr Unreachable = std::numeric_limits<float>::infinity();
+
+		struct NearestGoal
+		{
+			int GoalId{Graphs::InvalidNodeId}; // invalid when no goal lies within MaxCost
+			float Cost{Unreachable}; // source seed cost included
+			std::span<Node* const> Path{}; // from a source to the goal, lives in Context until its next query
+		};
+
+		NearestGoal FindNearestGoal(std::span<PathSeed const> Sources, std::span<int const> GoalIds, PathSearchContext& Context,
+			float MaxCost = Unreachable) const;
+		NearestGoal FindNearestGoal(Node* const pStartNode, std::span<int const> GoalIds, PathSearchContext& Context,
+			float MaxCost = Unreachable) const;
+
+		// Settles every node up to MaxCost from the nearest source, returns how many that were
+		int BuildDistanceField(std::span<PathSeed const> Sources, float MaxCost, PathSearchContext& Context) const;
+		// After BuildDistanceField, Unreachable for nodes outside the radius
+		static float GetCost(PathSearchContext const& Context, int NodeId);
+		// After BuildDistanceField, from the nearest source to NodeId. Empty outside the radius
+		std::span<Node* const> GetPathTo(int NodeId, PathSearchContext& Context) const;
+
+	private:
+		void OpenSources(std::span<PathSeed const> Sources, PathSearchContext& Context) const;
+		// Settles nodes in cost order up to MaxCost, returns the first marked goal it settles (if bStopAtGoal)
+		int Settle(float MaxCost, bool bStopAtGoal, PathSearchContext& Context) const;
+		std::span<Node* const> BuildPath(int NodeId, PathSearchContext& Context) const;
+
+		Graph const* pGraph;
+		GridGraph const* pGrid; // pGraph when it's a grid
+	};
+}
@@ -46,7 +46,7 @@ namespace GameAI
 		for (const Node* node : Nodes)
 		{
 			// Get connections from this node to find its degree
-			int degree = m_pGraph->FindConnectionsFrom(node->GetId()).size();
+			int degree = m_pGraph->GetConnectionsFrom(node->GetId()).size();
 			
 			if (degree % 2 != 0)
 			{
@@ -96,7 +96,7 @@ inline std::vector<Node*> EulerianPath::FindPath(Eulerianity& eulerianity) const
 			// Start at node with odd degree
 			for (const Node* n : Nodes)
 			{
-				if (graphCopy.FindConnectionsFrom(n->GetId()).size() % 2 != 0)
+				if (graphCopy.GetConnectionsFrom(n->GetId()).size() % 2 != 0)
 				{
 					currentNodeId = n->GetId();
 					break;
@@ -107,9 +107,10 @@ inline std::vector<Node*> EulerianPath::FindPath(Eulerianity& eulerianity) const
 		std::stack<int> nodeStack;
 
 		// Repeat until the current node has no more connections and stack is empty 
-		while (graphCopy.FindConnectionsFrom(currentNodeId).size() > 0 || !nodeStack.empty())
+		while (graphCopy.GetConnectionsFrom(currentNodeId).size() > 0 || !nodeStack.empty())
 		{
-			auto connections = graphCopy.FindConnectionsFrom(currentNodeId);
+			// View is only valid until the connection below is removed
+			auto const connections = graphCopy.GetConnectionsFrom(currentNodeId);
 			
 			if (connections.size() > 0)
 			{
@@ -146,7 +147,7 @@ inline std::vector<Node*> EulerianPath::FindPath(Eulerianity& eulerianity) const
 		visited[startIndex] = true;
 
 		// Iterate over all connections from that node 
-		auto connections = m_pGraph->FindConnectionsFrom(Nodes[startIndex]->GetId());
+		auto const connections = m_pGraph->GetConnectionsFrom(Nodes[startIndex]->GetId());
 		
 		for (size_t i = 0; i < connections.size(); ++i)
 		{
@@ -183,7 +184,7 @@ inline std::vector<Node*> EulerianPath::FindPath(Eulerianity& eulerianity) const
 		// Choose a starting node 
 		for (size_t i = 0; i < Nodes.size(); ++i)
 		{
-			if (m_pGraph->FindConnectionsFrom(Nodes[i]->GetId()).size() > 0)
+			if (m_pGraph->GetConnectionsFrom(Nodes[i]->GetId()).size() > 0)
 			{
 				startIndex = i;
 				break;
@@ -0,0 +1,168 @@
+﻿#include "FlowField.h"
+#include <limits>
+
+#include "Shared/Graph/GridGraph/GridGraph.h"
+
+using namespace GameAI;
+
+namespace
+{
+	float constexpr Unreachable = std::numeric_limits<float>::infinity();
+
+	// Col and row offsets per direction index, see GetDirectionIndex
+	FIntVector2 const NeighbourOffsets[8]{{-1, -1}, {0, -1}, {1, -1}, {-1, 0}, {1, 0}, {-1, 1}, {0, 1}, {1, 1}};
+	float constexpr InvSqrt2 = 0.70710678f;
+	FVector2D const NeighbourDirections[8]{
+		{-InvSqrt2, -InvSqrt2}, {0.f, -1.f}, {InvSqrt2, -InvSqrt2},
+		{-1.f, 0.f}, {1.f, 0.f},
+		{-InvSqrt2, InvSqrt2}, {0.f, 1.f}, {InvSqrt2, InvSqrt2}};
+}
+
+#pragma region FlowField
+FlowField::FlowField(GridGraph const* pGrid, int GoalNodeId, IndexedHeap<4>& OpenList)
+	: pGrid(pGrid)
+	, GoalId(GoalNodeId)
+	, NrColumns(pGrid->GetColumns())
+{
+	Build(OpenList);
+}
+
+void FlowField::Build(IndexedHeap<4>& OpenList)
+{
+	double const StartTime = FPlatformTime::Seconds();
+
+	int const NrCells = pGrid->GetRows() * NrColumns;
+	Integration.assign(NrCells, Unreachable);
+	Directions.assign(NrCells, NoDirection);
+
+	OpenList.Clear();
+	OpenList.Reserve(NrCells);
+	Integration[GoalId] = 0.f;
+	OpenList.Push(GoalId, 0.f);
+
+	// Dijkstra from the goal over the incoming steps, so it also holds for directional grids.
+	// The step that settles a cell is its first step on a shortest path, that becomes its direction.
+	// The cell layer's steps go both ways, while it's in sync it's read instead of the connections
+	bool const bUseCellLayer = pGrid->IsCellLayerInSync();
+	while (!OpenList.IsEmpty())
+	{
+		int const CurrentId = OpenList.Pop();
+		float const CurrentCost = Integration[CurrentId];
+		FIntVector2 const CurrentCell = pGrid->GetColAndRow(CurrentId);
+
+		auto const VisitFrom = [&](int FromId, float StepCost)
+		{
+			float const NewCost = CurrentCost + StepCost;
+			if (NewCost >= Integration[FromId]) return;
+
+			FIntVector2 const FromCell = pGrid->GetColAndRow(FromId);
+			Integration[FromId] = NewCost;
+			Directions[FromId] = static_cast<uint8_t>(GetDirectionIndex(CurrentCell.X - FromCell.X, CurrentCell.Y - FromCell.Y));
+			OpenList.PushOrDecrease(FromId, NewCost);
+		};
+
+		if (bUseCellLayer)
+		{
+			pGrid->ForEachWalkableNeighbour(CurrentId, VisitFrom);
+			continue;
+		}
+		for (Connection* const pConnection : pGrid->GetConnectionsTo(CurrentId))
+		{
+			VisitFrom(pConnection->GetFromId(), pConnection->GetWeight());
+		}
+	}
+
+	BuildTimeMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+}
+
+bool FlowField::IsReachable(int NodeId) const
+{
+	return NodeId >= 0 && NodeId < static_cast<int>(Integration.size()) && Integration[NodeId] != Unreachable;
+}
+
+int FlowField::GetNextNodeId(int NodeId) const
+{
+	if (NodeId < 0 || NodeId >= static_cast<int>(Directions.size()) || Directions[NodeId] == NoDirection)
+	{
+		return Graphs::InvalidNodeId;
+	}
+
+	FIntVector2 const Offset = NeighbourOffsets[Directions[NodeId]];
+	return NodeId + Offset.Y * NrColumns + Offset.X;
+}
+
+FVector2D FlowField::GetDirection(int NodeId) const
+{
+	if (NodeId < 0 || NodeId >= static_cast<int>(Directions.size()) || Directions[NodeId] == NoDirection)
+	{
+		return FVector2D::ZeroVector;
+	}
+	return NeighbourDirections[Directions[NodeId]];
+}
+
+FVector2D FlowField::GetDirectionAtPosition(FVector2D const& Position) const
+{
+	return GetDirection(pGrid->GetNodeIdAtPosition(Position));
+}
+
+size_t FlowField::GetAllocatedBytes() const
+{
+	return Integration.capacity() * sizeof(float) + Directions.capacity() * sizeof(uint8_t);
+}
+#pragma endregion FlowField
+
+#pragma region FlowFieldCache
+FlowFieldCache::FlowFieldCache(GridGraph const* pGrid, size_t MemoryBudgetBytes)
+	: pGrid(pGrid)
+	, MemoryBudgetBytes(MemoryBudgetBytes)
+{
+}
+
+FlowField const* FlowFieldCache::GetField(int GoalNodeId)
+{
+	if (GoalNodeId < 0 || GoalNodeId >= pGrid->GetRows() * pGrid->GetColumns())
+	{
+		return nullptr;
+	}
+
+	if (auto const It = FieldsByGoal.find(GoalNodeId); It != FieldsByGoal.end())
+	{
+		++NrHits;
+		Fields.splice(Fields.begin(), Fields, It->second); // iterators stay valid
+		return Fields.front().get();
+	}
+
+	++NrMisses;
+	Fields.push_front(std::make_unique<FlowField>(pGrid, GoalNodeId, OpenList));
+	FieldsByGoal.emplace(GoalNodeId, Fields.begin());
+	UsedBytes += Fields.front()->GetAllocatedBytes();
+	EvictOverBudget();
+
+	return Fields.front().get();
+}
+
+void FlowFieldCache::Invalidate()
+{
+	Fields.clear();
+	FieldsByGoal.clear();
+	UsedBytes = 0;
+}
+
+void FlowFieldCache::SetMemoryBudget(size_t NewBudgetBytes)
+{
+	MemoryBudgetBytes = NewBudgetBytes;
+	EvictOverBudget();
+}
+
+void FlowFieldCache::EvictOverBudget()
+{
+	while (UsedBytes > MemoryBudgetBytes && Fields.size() > 1)
+	{
+		FlowField const& Oldest = *Fields.back();
+		UsedBytes -= Oldest.GetAllocatedBytes();
+		FieldsByGoal.erase(Oldest.GetGoalId());
+		Fields.pop_back();
+		++NrEvictions;
+	}
+}
+#pragma endregion FlowFieldCache
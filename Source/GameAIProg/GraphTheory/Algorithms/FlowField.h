@@ -0,0 +1,102 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "SearchContainers.h"
+
+namespace GameAI
+{
+	class GridGraph;
+
+	// Flow field towards a single goal cell, shared by every agent heading there.
+	// One reverse Dijkstra from the goal fills the integration field (cost to the goal for every cell),
+	// each cell then stores the neighbour it should move to. Sampling it is a grid lookup, no search per agent
+	class FlowField final
+	{
+	public:
+		// Builds the field right away, OpenList is scratch memory that can be shared between builds
+		FlowField(GridGraph const* pGrid, int GoalNodeId, IndexedHeap<4>& OpenList);
+
+		GridGraph const* GetGrid() const { return pGrid; }
+		int GetGoalId() const { return GoalId; }
+
+		bool IsReachable(int NodeId) const;
+		float GetIntegrationCost(int NodeId) const { return Integration[NodeId]; }
+
+		// Next cell towards the goal, InvalidNodeId at the goal itself or when the goal can't be reached
+		int GetNextNodeId(int NodeId) const;
+		// Unit vector towards the next cell, zero when there is none
+		FVector2D GetDirection(int NodeId) const;
+		FVector2D GetDirectionAtPosition(FVector2D const& Position) const;
+
+		// Stats
+		double GetBuildTimeMs() const { return BuildTimeMs; }
+		size_t GetAllocatedBytes() const;
+		static size_t GetBytesPerCell() { return sizeof(float) + sizeof(uint8_t); }
+
+	private:
+		static uint8_t constexpr NoDirection = 0xFF;
+
+		GridGraph const* pGrid;
+		int GoalId;
+		int NrColumns;
+
+		std::vector<float> Integration{}; // cost to the goal, infinity when unreachable
+		std::vector<uint8_t> Directions{}; // index into the neighbour offsets, NoDirection at the goal / unreachable
+		double BuildTimeMs{0.0};
+
+		static int GetDirectionIndex(int DeltaCol, int DeltaRow)
+		{
+			// (-1,-1) .. (1,1) without (0,0), same layout as the JPS+ table
+			int const Slot = (DeltaRow + 1) * 3 + (DeltaCol + 1);
+			return Slot < 4 ? Slot : Slot - 1;
+		}
+
+		void Build(IndexedHeap<4>& OpenList);
+	};
+
+	// Flow fields per goal cell, least recently used ones are dropped once the memory budget is exceeded.
+	// The field that was asked for last is always kept, even if it alone is over budget.
+	// Returned fields stay valid until the next GetField or Invalidate call
+	class FlowFieldCache final
+	{
+	public:
+		FlowFieldCache(GridGraph const* pGrid, size_t MemoryBudgetBytes);
+
+		// Builds the field on a miss, nullptr for an invalid goal
+		FlowField const* GetField(int GoalNodeId);
+
+		// Call when the graph changed, every cached field is stale then
+		void Invalidate();
+
+		void SetMemoryBudget(size_t NewBudgetBytes);
+		size_t GetMemoryBudget() const { return MemoryBudgetBytes; }
+
+		// Stats
+		int GetFieldCount() const { return static_cast<int>(Fields.size()); }
+		size_t GetAllocatedBytes() const { return UsedBytes; }
+		int GetHitCount() const { return NrHits; }
+		int GetMissCount() const { return NrMisses; }
+		int GetEvictionCount() const { return NrEvictions; }
+
+	private:
+		using FieldList = std::list<std::unique_ptr<FlowField>>;
+
+		GridGraph const* pGrid;
+		size_t MemoryBudgetBytes;
+		size_t UsedBytes{0};
+
+		FieldList Fields{}; // most recently used first
+		std::unordered_map<int, FieldList::iterator> FieldsByGoal{};
+		IndexedHeap<4> OpenList{};
+
+		int NrHits{0};
+		int NrMisses{0};
+		int NrEvictions{0};
+
+		void EvictOverBudget();
+	};
+}
@@ -20,7 +20,7 @@ namespace GameAI
 				std::set<int> usedNeighborColors;
 
 				// Collect neighbor colors
-				auto connections = pGraph->FindConnectionsFrom(nodeId);
+				auto const connections = pGraph->GetConnectionsFrom(nodeId);
 				for (auto* pConnection : connections)
 				{
 					int neighborId = pConnection->GetToId();
@@ -0,0 +1,349 @@
+﻿#include "HPAStar.h"
+#include <algorithm>
+
+#include "Shared/Graph/TerrainGraph/TerrainGridGraph.h"
+
+using namespace GameAI;
+
+void HPAStar::EntranceGraph::AddEdge(int FromId, int ToId, float Weight)
+{
+	auto NewConnection{std::make_unique<Connection>(FromId, ToId)};
+	NewConnection->SetWeight(Weight);
+	Connections.push_back(std::move(NewConnection));
+
+	auto InverseConnection{std::make_unique<Connection>(ToId, FromId)};
+	InverseConnection->SetWeight(Weight);
+	Connections.push_back(std::move(InverseConnection));
+	MarkAdjacencyDirty();
+}
+
+void HPAStar::EntranceGraph::RemoveNodes(std::span<int const> NodeIds)
+{
+	// Mark first, then drop all their connections in a single pass
+	for (int const NodeId : NodeIds)
+	{
+		Nodes[NodeId]->SetId(Graphs::InvalidNodeId);
+	}
+	std::erase_if(Connections, [this](auto const& Connection)
+	{
+		return Nodes[Connection->GetFromId()]->GetId() == Graphs::InvalidNodeId ||
+			Nodes[Connection->GetToId()]->GetId() == Graphs::InvalidNodeId;
+	});
+	MarkAdjacencyDirty();
+}
+
+HPAStar::HPAStar(TerrainGridGraph* const pGrid, int ClusterSize, HeuristicFunctions::Heuristic hFunction)
+	: pGrid(pGrid)
+	, ClusterSize(std::max(ClusterSize, 2))
+	, NrClusterColumns((pGrid->GetColumns() + this->ClusterSize - 1) / this->ClusterSize)
+	, NrClusterRows((pGrid->GetRows() + this->ClusterSize - 1) / this->ClusterSize)
+	, AbstractSearch(&AbstractGraph, hFunction)
+	, ClusterSearch(pGrid, HeuristicFunctions::Zero)
+{
+	ClusterSearch.SetNodeFilter([this](int NodeId) { return GetClusterOf(NodeId) == FilterCluster; });
+	Rebuild();
+}
+
+void HPAStar::Rebuild()
+{
+	AbstractGraph.GetConnections().clear();
+	AbstractGraph.GetNodes().clear();
+	AbstractIdOfCell.assign(pGrid->GetNodes().size(), Graphs::InvalidNodeId);
+	CellOfAbstract.clear();
+	ClusterNodes.assign(GetClusterCount(), {});
+
+	std::vector<int> AllClusters(GetClusterCount());
+	for (int Cluster = 0; Cluster < GetClusterCount(); ++Cluster)
+	{
+		AllClusters[Cluster] = Cluster;
+	}
+	RebuildClusters(AllClusters);
+}
+
+void HPAStar::UpdateNode(int NodeId)
+{
+	if (NodeId < 0 || NodeId >= static_cast<int>(AbstractIdOfCell.size())) return;
+
+	// Straight neighbours in another cluster mean the node is on that border, whose entrances may change too
+	std::vector<int> Touched{GetClusterOf(NodeId)};
+	FIntVector2 const Cell = pGrid->GetColAndRow(NodeId);
+	FIntVector2 const Neighbours[]{{Cell.X + 1, Cell.Y}, {Cell.X - 1, Cell.Y}, {Cell.X, Cell.Y + 1}, {Cell.X, Cell.Y - 1}};
+	for (FIntVector2 const& Neighbour : Neighbours)
+	{
+		if (!pGrid->IsWithinBounds(Neighbour.X, Neighbour.Y)) continue;
+
+		int const Cluster = GetClusterOf(pGrid->GetNodeId(Neighbour.X, Neighbour.Y));
+		if (std::ranges::find(Touched, Cluster) == Touched.end())
+		{
+			Touched.push_back(Cluster);
+		}
+	}
+	RebuildClusters(Touched);
+}
+
+bool HPAStar::FindPath(Node* const pStartNode, Node* const pDestinationNode, HierarchicalPath& OutPath)
+{
+	OutPath = HierarchicalPath{};
+
+	// If start or destination is missing, stop
+	if (!pStartNode || !pDestinationNode) return false;
+
+	int const startCell = pStartNode->GetId();
+	int const destinationCell = pDestinationNode->GetId();
+	FIntVector2 const start = pGrid->GetColAndRow(startCell);
+	FIntVector2 const destination = pGrid->GetColAndRow(destinationCell);
+	if (!pGrid->IsWalkable(start.X, start.Y) || !pGrid->IsWalkable(destination.X, destination.Y)) return false;
+
+	// Start and goal join the abstract graph for this query only, unless they already are an entrance
+	std::vector<int> temporaryNodes{};
+	auto const insertNode = [&](int CellId)
+	{
+		if (AbstractIdOfCell[CellId] != Graphs::InvalidNodeId) return AbstractIdOfCell[CellId];
+
+		int const abstractId = AbstractGraph.AddNode(std::make_unique<Node>(pGrid->GetNodePosition(CellId)));
+		CellOfAbstract.resize(std::max(static_cast<int>(CellOfAbstract.size()), abstractId + 1), Graphs::InvalidNodeId);
+		CellOfAbstract[abstractId] = CellId;
+		ConnectToClusterNodes(abstractId, GetClusterOf(CellId));
+		temporaryNodes.push_back(abstractId);
+		return abstractId;
+	};
+	int const startId = insertNode(startCell);
+	int const destinationId = insertNode(destinationCell);
+
+	// In the same cluster the direct route may beat going through the entrances
+	int const startCluster = GetClusterOf(startCell);
+	if (startId != destinationId && startCluster == GetClusterOf(destinationCell)
+		&& !AbstractGraph.FindConnection(startId, destinationId))
+	{
+		auto const localPath = FindClusterPath(startCell, destinationCell, startCluster);
+		if (!localPath.empty() && localPath.back()->GetId() == destinationCell)
+		{
+			AbstractGraph.AddEdge(startId, destinationId, ClusterContext.GetRecords().Find(destinationCell)->CostSoFar);
+		}
+	}
+
+	auto const abstractPath = AbstractSearch.FindPath(AbstractGraph.GetNode(startId).get(),
+		AbstractGraph.GetNode(destinationId).get(), AbstractContext);
+	for (Node* const pNode : abstractPath)
+	{
+		OutPath.Waypoints.push_back(CellOfAbstract[pNode->GetId()]);
+	}
+	OutPath.bReachesGoal = !OutPath.Waypoints.empty() && OutPath.Waypoints.back() == destinationCell;
+	OutPath.Cells.push_back(pStartNode);
+
+	AbstractGraph.RemoveNodes(temporaryNodes);
+	return OutPath.bReachesGoal;
+}
+
+bool HPAStar::RefineNextSegment(HierarchicalPath& Path)
+{
+	if (Path.IsFullyRefined()) return false;
+
+	int const fromCell = Path.Waypoints[Path.NrRefinedSegments];
+	int const toCell = Path.Waypoints[Path.NrRefinedSegments + 1];
+	int const cluster = GetClusterOf(fromCell);
+	if (cluster == GetClusterOf(toCell))
+	{
+		// Inside a cluster, skip the first node since the previous segment ended on it
+		auto const clusterPath = FindClusterPath(fromCell, toCell, cluster);
+		if (clusterPath.size() > 1)
+		{
+			Path.Cells.insert(Path.Cells.end(), clusterPath.begin() + 1, clusterPath.end());
+		}
+	}
+	else
+	{
+		// Entrance pairs are direct neighbours
+		Path.Cells.push_back(pGrid->Graph::GetNode(toCell).get());
+	}
+
+	++Path.NrRefinedSegments;
+	return true;
+}
+
+int HPAStar::GetClusterOf(int NodeId) const
+{
+	FIntVector2 const Cell = pGrid->GetColAndRow(NodeId);
+	return (Cell.Y / ClusterSize) * NrClusterColumns + Cell.X / ClusterSize;
+}
+
+void HPAStar::RebuildClusters(std::span<int const> Clusters)
+{
+	double const StartTime = FPlatformTime::Seconds();
+
+	// Drop the old entrances, together with their connections
+	std::vector<int> removedNodes{};
+	for (int const Cluster : Clusters)
+	{
+		for (int const AbstractId : ClusterNodes[Cluster])
+		{
+			AbstractIdOfCell[CellOfAbstract[AbstractId]] = Graphs::InvalidNodeId;
+			removedNodes.push_back(AbstractId);
+		}
+		ClusterNodes[Cluster].clear();
+	}
+	AbstractGraph.RemoveNodes(removedNodes);
+
+	// Entrances on every border of the rebuilt clusters. Nodes of untouched neighbours are reused,
+	// their side of the border didn't change. Borders between two rebuilt clusters are done once
+	auto const isRebuilt = [Clusters](int Cluster) { return std::ranges::find(Clusters, Cluster) != Clusters.end(); };
+	for (int const Cluster : Clusters)
+	{
+		int const clusterCol = Cluster % NrClusterColumns;
+		int const clusterRow = Cluster / NrClusterColumns;
+
+		if (clusterCol + 1 < NrClusterColumns) AddBorderEntrances(Cluster, true);
+		if (clusterRow + 1 < NrClusterRows) AddBorderEntrances(Cluster, false);
+		if (clusterCol > 0 && !isRebuilt(Cluster - 1)) AddBorderEntrances(Cluster - 1, true);
+		if (clusterRow > 0 && !isRebuilt(Cluster - NrClusterColumns)) AddBorderEntrances(Cluster - NrClusterColumns, false);
+	}
+
+	// Connect the entrances inside each cluster by their in-cluster path cost
+	for (int const Cluster : Clusters)
+	{
+		std::vector<int> const& nodes = ClusterNodes[Cluster];
+		for (int first = 0; first < static_cast<int>(nodes.size()); ++first)
+		{
+			int const fromCell = CellOfAbstract[nodes[first]];
+			for (int second = first + 1; second < static_cast<int>(nodes.size()); ++second)
+			{
+				int const toCell = CellOfAbstract[nodes[second]];
+				auto const clusterPath = FindClusterPath(fromCell, toCell, Cluster);
+				if (!clusterPath.empty() && clusterPath.back()->GetId() == toCell)
+				{
+					AbstractGraph.AddEdge(nodes[first], nodes[second], ClusterContext.GetRecords().Find(toCell)->CostSoFar);
+				}
+			}
+		}
+	}
+
+	LastRebuildTimeMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+	NrLastRebuiltClusters = static_cast<int>(Clusters.size());
+}
+
+void HPAStar::AddBorderEntrances(int Cluster, bool bRightBorder)
+{
+	int const clusterCol = Cluster % NrClusterColumns;
+	int const clusterRow = Cluster / NrClusterColumns;
+
+	// Cells on this cluster's side of the border, and the step over it
+	FIntVector2 first{}, along{}, across{};
+	int length = 0;
+	if (bRightBorder)
+	{
+		first = {(clusterCol + 1) * ClusterSize - 1, clusterRow * ClusterSize};
+		along = {0, 1};
+		across = {1, 0};
+		length = std::min(ClusterSize, pGrid->GetRows() - first.Y);
+	}
+	else
+	{
+		first = {clusterCol * ClusterSize, (clusterRow + 1) * ClusterSize - 1};
+		along = {1, 0};
+		across = {0, 1};
+		length = std::min(ClusterSize, pGrid->GetColumns() - first.X);
+	}
+
+	auto const cellAt = [&](int Step) { return first + FIntVector2{along.X * Step, along.Y * Step}; };
+	auto const isOpen = [&](int Step)
+	{
+		FIntVector2 const cell = cellAt(Step);
+		FIntVector2 const other = cell + across;
+		return pGrid->IsWalkable(cell.X, cell.Y) && pGrid->IsWalkable(other.X, other.Y);
+	};
+	auto const addEntrance = [&](FIntVector2 const& Cell, FIntVector2 const& Other)
+	{
+		AddEntrance(pGrid->GetNodeId(Cell.X, Cell.Y), pGrid->GetNodeId(Other.X, Other.Y));
+	};
+
+	// Every run of cells that are open on both sides gets one entrance, long runs get one at each end
+	int constexpr MinRunForTwoEntrances = 6;
+	int runStart = -1;
+	for (int step = 0; step <= length; ++step)
+	{
+		bool const bOpen = step < length && isOpen(step);
+		if (bOpen && runStart < 0)
+		{
+			runStart = step;
+		}
+		else if (!bOpen && runStart >= 0)
+		{
+			int const runEnd = step - 1;
+			if (runEnd - runStart + 1 >= MinRunForTwoEntrances)
+			{
+				addEntrance(cellAt(runStart), cellAt(runStart) + across);
+				addEntrance(cellAt(runEnd), cellAt(runEnd) + across);
+			}
+			else
+			{
+				int const middle = (runStart + runEnd) / 2;
+				addEntrance(cellAt(middle), cellAt(middle) + across);
+			}
+			runStart = -1;
+		}
+	}
+
+	// Diagonal moves can squeeze through where no straight crossing is open nearby
+	if (!pGrid->IsDiagonallyConnected()) return;
+
+	for (int step = 0; step < length; ++step)
+	{
+		FIntVector2 const cell = cellAt(step);
+		if (isOpen(step) || !pGrid->IsWalkable(cell.X, cell.Y)) continue;
+
+		for (int const side : {-1, 1})
+		{
+			int const otherStep = step + side;
+			if (otherStep < 0 || otherStep >= length || isOpen(otherStep)) continue;
+
+			FIntVector2 const other = cellAt(otherStep) + across;
+			if (pGrid->IsWalkable(other.X, other.Y))
+			{
+				addEntrance(cell, other);
+			}
+		}
+	}
+}
+
+void HPAStar::AddEntrance(int CellA, int CellB)
+{
+	Connection const* const pConnection = pGrid->FindConnection(CellA, CellB);
+	if (!pConnection) return;
+
+	AbstractGraph.AddEdge(GetOrAddAbstractNode(CellA), GetOrAddAbstractNode(CellB), pConnection->GetWeight());
+}
+
+int HPAStar::GetOrAddAbstractNode(int CellId)
+{
+	if (AbstractIdOfCell[CellId] != Graphs::InvalidNodeId) return AbstractIdOfCell[CellId];
+
+	int const AbstractId = AbstractGraph.AddNode(std::make_unique<Node>(pGrid->GetNodePosition(CellId)));
+	if (AbstractId >= static_cast<int>(CellOfAbstract.size()))
+	{
+		CellOfAbstract.resize(AbstractId + 1, Graphs::InvalidNodeId);
+	}
+	CellOfAbstract[AbstractId] = CellId;
+	AbstractIdOfCell[CellId] = AbstractId;
+	ClusterNodes[GetClusterOf(CellId)].push_back(AbstractId);
+	return AbstractId;
+}
+
+void HPAStar::ConnectToClusterNodes(int AbstractId, int Cluster)
+{
+	int const fromCell = CellOfAbstract[AbstractId];
+	for (int const OtherId : ClusterNodes[Cluster])
+	{
+		int const toCell = CellOfAbstract[OtherId];
+		auto const clusterPath = FindClusterPath(fromCell, toCell, Cluster);
+		if (!clusterPath.empty() && clusterPath.back()->GetId() == toCell)
+		{
+			AbstractGraph.AddEdge(AbstractId, OtherId, ClusterContext.GetRecords().Find(toCell)->CostSoFar);
+		}
+	}
+}
+
+std::span<Node* const> HPAStar::FindClusterPath(int FromCell, int ToCell, int Cluster)
+{
+	FilterCluster = Cluster;
+	return ClusterSearch.FindPath(pGrid->Graph::GetNode(FromCell).get(), pGrid->Graph::GetNode(ToCell).get(), ClusterContext);
+}
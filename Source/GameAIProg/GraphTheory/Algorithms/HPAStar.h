@@ -0,0 +1,94 @@
+﻿#pragma once
+
+#include <span>
+#include <vector>
+#include "AStar.h"
+#include "Heuristics.h"
+#include "PathSearchContext.h"
+#include "Shared/Graph/Graph.h"
+
+namespace GameAI
+{
+	class TerrainGridGraph;
+
+	// Result of an HPA* query. Only the waypoints are known up front,
+	// the cells between them are filled in lazily by HPAStar::RefineNextSegment
+	struct HierarchicalPath final
+	{
+		std::vector<int> Waypoints{}; // grid node ids: start, cluster entrances, goal
+		std::vector<Node*> Cells{}; // refined part of the path, starts with the start node
+		int NrRefinedSegments{0};
+		bool bReachesGoal{false};
+
+		bool IsFullyRefined() const { return NrRefinedSegments >= static_cast<int>(Waypoints.size()) - 1; }
+	};
+
+	// Hierarchical pathfinding A* (Botea et al.) over a TerrainGridGraph.
+	// The grid is cut into square clusters, walkable stretches along the cluster borders become entrances,
+	// and entrances of the same cluster are connected by their in-cluster path cost.
+	// Queries search that small abstract graph and refine the result one cluster at a time.
+	// Paths are near optimal rather than optimal, and a diagonal squeeze exactly on a cluster corner is not an entrance
+	class HPAStar
+	{
+	public:
+		HPAStar(TerrainGridGraph* const pGrid, int ClusterSize, HeuristicFunctions::Heuristic hFunction);
+
+		void Rebuild();
+		void SetHeuristic(HeuristicFunctions::Heuristic hFunction) { AbstractSearch = AStar{&AbstractGraph, hFunction}; }
+
+		// Call after a node was painted, rebuilds its cluster and the neighbours it shares a border with
+		void UpdateNode(int NodeId);
+
+		// Coarse search on the abstract graph, OutPath only holds the waypoints and the start node afterwards
+		bool FindPath(Node* const pStartNode, Node* const pDestinationNode, HierarchicalPath& OutPath);
+
+		// Refines the next waypoint segment into grid cells, returns false once the whole path is refined
+		bool RefineNextSegment(HierarchicalPath& Path);
+
+		Graph const& GetAbstractGraph() const { return AbstractGraph; }
+		int GetClusterSize() const { return ClusterSize; }
+		int GetClusterCount() const { return NrClusterColumns * NrClusterRows; }
+
+		// Stats
+		double GetLastRebuildTimeMs() const { return LastRebuildTimeMs; }
+		int GetLastRebuiltClusterCount() const { return NrLastRebuiltClusters; }
+
+	private:
+		// The builder never adds a connection twice, so it skips the duplicate scan of Graph::AddConnection
+		class EntranceGraph final : public Graph
+		{
+		public:
+			EntranceGraph() : Graph(false) {}
+
+			void AddEdge(int FromId, int ToId, float Weight); // both directions
+			void RemoveNodes(std::span<int const> NodeIds);
+		};
+
+		TerrainGridGraph* pGrid;
+		int ClusterSize;
+		int NrClusterColumns;
+		int NrClusterRows;
+
+		EntranceGraph AbstractGraph{};
+		std::vector<int> AbstractIdOfCell{}; // grid node id -> abstract node id, -1 when not an entrance
+		std::vector<int> CellOfAbstract{}; // abstract node id -> grid node id
+		std::vector<std::vector<int>> ClusterNodes{}; // abstract node ids per cluster
+
+		AStar AbstractSearch;
+		AStar ClusterSearch; // Dijkstra that never leaves FilterCluster
+		int FilterCluster{-1};
+		PathSearchContext AbstractContext{};
+		PathSearchContext ClusterContext{};
+
+		double LastRebuildTimeMs{0.0};
+		int NrLastRebuiltClusters{0};
+
+		int GetClusterOf(int NodeId) const;
+		void RebuildClusters(std::span<int const> Clusters);
+		void AddBorderEntrances(int Cluster, bool bRightBorder); // with the cluster to the right or above
+		void AddEntrance(int CellA, int CellB);
+		int GetOrAddAbstractNode(int CellId);
+		void ConnectToClusterNodes(int AbstractId, int Cluster);
+		std::span<Node* const> FindClusterPath(int FromCell, int ToCell, int Cluster);
+	};
+}
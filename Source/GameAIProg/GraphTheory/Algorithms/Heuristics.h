@@ -1,10 +1,14 @@
 ﻿#pragma once
+#include <functional>
 
 namespace GameAI::HeuristicFunctions
 {
 	// Common typedef
 	typedef float(*Heuristic)(float, float);
 	
+	// Estimate between two node ids, for heuristics that need more than the distance (e.g. LandmarkTable)
+	typedef std::function<float(int, int)> NodeHeuristic;
+	
 	//Manhattan distance
 	static float Manhattan(float x, float y)
 	{
@@ -35,4 +39,10 @@ namespace GameAI::HeuristicFunctions
 	{
 		return std::max(x, y);
 	}
+
+	//No estimate, turns A* into Dijkstra
+	static float Zero(float, float)
+	{
+		return 0.f;
+	}
 };
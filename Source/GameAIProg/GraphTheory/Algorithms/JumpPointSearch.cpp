@@ -0,0 +1,299 @@
+﻿#include "JumpPointSearch.h"
+#include <algorithm>
+#include <limits>
+
+#include "AStar.h"
+#include "JumpPointTable.h"
+#include "Shared/Graph/GridGraph/GridGraph.h"
+
+using namespace GameAI;
+
+namespace
+{
+	FIntVector2 SignOf(FIntVector2 const& Delta)
+	{
+		return { (Delta.X > 0) - (Delta.X < 0), (Delta.Y > 0) - (Delta.Y < 0) };
+	}
+}
+
+JumpPointSearch::JumpPointSearch(GridGraph* const pGrid, JumpPointTable const* const pJumpTable)
+	: pGrid(pGrid)
+	, pJumpTable(pJumpTable)
+{
+}
+
+bool JumpPointSearch::CanUseJumpPoints() const
+{
+	return pGrid->IsDiagonallyConnected() && pGrid->HasUniformCosts();
+}
+
+std::vector<Node*> JumpPointSearch::FindPath(Node* const pStartNode, Node* const pDestinationNode)
+{
+	auto const path = FindPath(pStartNode, pDestinationNode, DefaultContext);
+	return std::vector<Node*>{path.begin(), path.end()};
+}
+
+std::span<Node* const> JumpPointSearch::FindPath(Node* const pStartNode, Node* const pDestinationNode, PathSearchContext& Context) const
+{
+	// If start or destination is missing, stop
+	if (!pStartNode || !pDestinationNode)
+	{
+		return {};
+	}
+
+	if (!CanUseJumpPoints())
+	{
+		AStar const fallback{pGrid, HeuristicFunctions::Octile};
+		return fallback.FindPath(pStartNode, pDestinationNode, Context);
+	}
+
+	Context.BeginQuery(static_cast<int>(pGrid->GetNodes().size()));
+	IndexedHeap<4>& OpenList = Context.GetOpenList();
+	NodeRecordTable& Records = Context.GetRecords();
+
+	int const startId = pStartNode->GetId();
+	int const destinationId = pDestinationNode->GetId();
+	FIntVector2 const goalCell = pGrid->GetColAndRow(destinationId);
+
+	// Initialize start node
+	NodeRecord& startRecord = Records.Get(startId);
+	startRecord.CostSoFar = 0.f;
+	startRecord.EstimatedTotalCost = GetOctileCost(pGrid->GetColAndRow(startId), goalCell);
+	startRecord.State = NodeRecordState::Open;
+	OpenList.Push(startId, startRecord.EstimatedTotalCost);
+
+	// Closest expanded jump point, used as fallback when the goal can't be reached
+	int closestNodeId = Graphs::InvalidNodeId;
+	float closestHeuristic = std::numeric_limits<float>::max();
+	bool bFoundDestination = false;
+
+	std::array<FIntVector2, 8> directions{};
+	while (!OpenList.IsEmpty())
+	{
+		int const currentId = OpenList.Pop();
+		Context.CountExpansion();
+
+		if (currentId == destinationId)
+		{
+			bFoundDestination = true;
+			break;
+		}
+
+		NodeRecord& currentRecord = Records.Get(currentId);
+		currentRecord.State = NodeRecordState::Closed;
+
+		FIntVector2 const currentCell = pGrid->GetColAndRow(currentId);
+		if (float const heuristicToGoal = GetOctileCost(currentCell, goalCell); heuristicToGoal < closestHeuristic)
+		{
+			closestHeuristic = heuristicToGoal;
+			closestNodeId = currentId;
+		}
+
+		// Only follow the directions that aren't pruned by the move that got us here
+		int const nrDirections = GetPrunedDirections(currentCell, currentRecord.ParentId, directions);
+		for (int directionIdx = 0; directionIdx < nrDirections; ++directionIdx)
+		{
+			std::optional<FIntVector2> const jumpPoint = Jump(currentCell, directions[directionIdx], goalCell);
+			if (!jumpPoint.has_value()) continue;
+
+			int const jumpId = pGrid->GetNodeId(jumpPoint->X, jumpPoint->Y);
+			float const totalGCost = currentRecord.CostSoFar + GetOctileCost(currentCell, *jumpPoint);
+
+			NodeRecord& jumpRecord = Records.Get(jumpId);
+			if (jumpRecord.State != NodeRecordState::Unvisited && jumpRecord.CostSoFar <= totalGCost)
+			{
+				continue;
+			}
+
+			jumpRecord.ParentId = currentId;
+			jumpRecord.CostSoFar = totalGCost;
+			jumpRecord.EstimatedTotalCost = totalGCost + GetOctileCost(*jumpPoint, goalCell);
+			jumpRecord.State = NodeRecordState::Open;
+			OpenList.PushOrDecrease(jumpId, jumpRecord.EstimatedTotalCost);
+		}
+	}
+
+	int const lastId = bFoundDestination ? destinationId : closestNodeId;
+	if (lastId != Graphs::InvalidNodeId)
+	{
+		BuildCellPath(lastId, Context);
+	}
+
+	Context.EndQuery();
+	return Context.GetPath();
+}
+
+int JumpPointSearch::GetPrunedDirections(FIntVector2 const& Cell, int ParentId, std::array<FIntVector2, 8>& OutDirections) const
+{
+	int nrDirections = 0;
+
+	// The start node has no parent, it looks everywhere
+	if (ParentId == Graphs::InvalidNodeId)
+	{
+		for (int dy = -1; dy <= 1; ++dy)
+		{
+			for (int dx = -1; dx <= 1; ++dx)
+			{
+				if (dx != 0 || dy != 0) OutDirections[nrDirections++] = {dx, dy};
+			}
+		}
+		return nrDirections;
+	}
+
+	FIntVector2 const direction = SignOf(Cell - pGrid->GetColAndRow(ParentId));
+	int const dx = direction.X;
+	int const dy = direction.Y;
+	int const x = Cell.X;
+	int const y = Cell.Y;
+
+	if (dx != 0 && dy != 0)
+	{
+		// Diagonal: natural neighbors, plus forced ones behind blocked sides
+		OutDirections[nrDirections++] = {0, dy};
+		OutDirections[nrDirections++] = {dx, 0};
+		OutDirections[nrDirections++] = {dx, dy};
+		if (!IsWalkable({x - dx, y})) OutDirections[nrDirections++] = {-dx, dy};
+		if (!IsWalkable({x, y - dy})) OutDirections[nrDirections++] = {dx, -dy};
+	}
+	else if (dx != 0)
+	{
+		// Horizontal
+		OutDirections[nrDirections++] = {dx, 0};
+		if (!IsWalkable({x, y + 1})) OutDirections[nrDirections++] = {dx, 1};
+		if (!IsWalkable({x, y - 1})) OutDirections[nrDirections++] = {dx, -1};
+	}
+	else
+	{
+		// Vertical
+		OutDirections[nrDirections++] = {0, dy};
+		if (!IsWalkable({x + 1, y})) OutDirections[nrDirections++] = {1, dy};
+		if (!IsWalkable({x - 1, y})) OutDirections[nrDirections++] = {-1, dy};
+	}
+	return nrDirections;
+}
+
+std::optional<FIntVector2> JumpPointSearch::Jump(FIntVector2 const& From, FIntVector2 const& Direction, FIntVector2 const& Goal) const
+{
+	if (pJumpTable && pJumpTable->IsValid())
+	{
+		return LookupJump(From, Direction, Goal);
+	}
+
+	int const dx = Direction.X;
+	int const dy = Direction.Y;
+	FIntVector2 cell = From;
+
+	// Step in a straight line until something interesting shows up
+	while (true)
+	{
+		cell = cell + Direction;
+		int const x = cell.X;
+		int const y = cell.Y;
+
+		if (!IsWalkable(cell)) return std::nullopt;
+		if (cell == Goal) return cell;
+
+		if (dx != 0 && dy != 0)
+		{
+			// Forced neighbors
+			if ((IsWalkable({x - dx, y + dy}) && !IsWalkable({x - dx, y})) ||
+				(IsWalkable({x + dx, y - dy}) && !IsWalkable({x, y - dy})))
+			{
+				return cell;
+			}
+
+			// A diagonal step is a jump point when one of its straight scans finds one
+			if (Jump(cell, {dx, 0}, Goal).has_value() || Jump(cell, {0, dy}, Goal).has_value())
+			{
+				return cell;
+			}
+		}
+		else if (dx != 0)
+		{
+			if ((IsWalkable({x + dx, y + 1}) && !IsWalkable({x, y + 1})) ||
+				(IsWalkable({x + dx, y - 1}) && !IsWalkable({x, y - 1})))
+			{
+				return cell;
+			}
+		}
+		else
+		{
+			if ((IsWalkable({x + 1, y + dy}) && !IsWalkable({x + 1, y})) ||
+				(IsWalkable({x - 1, y + dy}) && !IsWalkable({x - 1, y})))
+			{
+				return cell;
+			}
+		}
+	}
+}
+
+std::optional<FIntVector2> JumpPointSearch::LookupJump(FIntVector2 const& From, FIntVector2 const& Direction, FIntVector2 const& Goal) const
+{
+	int const distance = pJumpTable->GetDistance(pGrid->GetNodeId(From.X, From.Y), Direction);
+	int const reach = std::abs(distance); // walkable cells we can still see in this direction
+	FIntVector2 const toGoal = Goal - From;
+	FIntVector2 const goalDirection = SignOf(toGoal);
+
+	// The table doesn't know the goal, stop on it when it's within reach
+	if (Direction.X != 0 && Direction.Y != 0)
+	{
+		if (goalDirection == Direction)
+		{
+			// Stop where the goal is straight ahead, the straight scans from there will find it
+			int const nrSteps = std::min(std::abs(toGoal.X), std::abs(toGoal.Y));
+			if (nrSteps <= reach)
+			{
+				return From + FIntVector2{Direction.X * nrSteps, Direction.Y * nrSteps};
+			}
+		}
+	}
+	else if (goalDirection == Direction && std::max(std::abs(toGoal.X), std::abs(toGoal.Y)) <= reach)
+	{
+		return Goal;
+	}
+
+	if (distance > 0)
+	{
+		return From + FIntVector2{Direction.X * distance, Direction.Y * distance};
+	}
+	return std::nullopt;
+}
+
+bool JumpPointSearch::IsWalkable(FIntVector2 const& Cell) const
+{
+	return pGrid->IsWalkable(Cell.X, Cell.Y);
+}
+
+float JumpPointSearch::GetOctileCost(FIntVector2 const& From, FIntVector2 const& To) const
+{
+	int const dx = std::abs(To.X - From.X);
+	int const dy = std::abs(To.Y - From.Y);
+	int const nrDiagonalSteps = std::min(dx, dy);
+	return nrDiagonalSteps * pGrid->GetDiagonalCost() + (std::max(dx, dy) - nrDiagonalSteps) * pGrid->GetCardinalCost();
+}
+
+void JumpPointSearch::BuildCellPath(int DestinationId, PathSearchContext& Context) const
+{
+	NodeRecordTable const& Records = Context.GetRecords();
+	std::vector<Node*>& path = Context.GetPathBuffer();
+
+	// Jump points are always on a straight or diagonal line from their parent, fill in the cells between them
+	int currentId = DestinationId;
+	int parentId = Records.Find(currentId)->ParentId;
+	while (parentId != Graphs::InvalidNodeId)
+	{
+		FIntVector2 const parentCell = pGrid->GetColAndRow(parentId);
+		FIntVector2 const step = SignOf(parentCell - pGrid->GetColAndRow(currentId));
+		for (FIntVector2 cell = pGrid->GetColAndRow(currentId); !(cell == parentCell); cell = cell + step)
+		{
+			path.push_back(pGrid->Graph::GetNode(pGrid->GetNodeId(cell.X, cell.Y)).get());
+		}
+
+		currentId = parentId;
+		parentId = Records.Find(currentId)->ParentId;
+	}
+	path.push_back(pGrid->Graph::GetNode(currentId).get());
+
+	// Reverse because path was built backwards
+	std::reverse(path.begin(), path.end());
+}
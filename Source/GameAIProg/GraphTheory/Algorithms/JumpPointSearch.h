@@ -0,0 +1,41 @@
+﻿#pragma once
+
+#include <array>
+#include <optional>
+#include <vector>
+#include "PathSearchContext.h"
+
+namespace GameAI
+{
+	class GridGraph;
+	class JumpPointTable;
+	class Node;
+
+	// Jump Point Search (Harabor & Grastien) on an 8-connected GridGraph with uniform costs.
+	// Works on the grid's col/row layout instead of its connections and only expands jump points.
+	// Diagonal moves past blocked corners are allowed, matching the connections GridGraph creates.
+	// Falls back to A* (Octile) on 4-connected grids or when terrain makes the costs non-uniform.
+	// With a JumpPointTable (JPS+) the straight and diagonal scans become table lookups
+	class JumpPointSearch
+	{
+	public:
+		explicit JumpPointSearch(GridGraph* const pGrid, JumpPointTable const* const pJumpTable = nullptr);
+
+		bool CanUseJumpPoints() const;
+
+		std::vector<Node*> FindPath(Node* const pStartNode, Node* const pDestinationNode);
+		std::span<Node* const> FindPath(Node* const pStartNode, Node* const pDestinationNode, PathSearchContext& Context) const;
+
+	private:
+		int GetPrunedDirections(FIntVector2 const& Cell, int ParentId, std::array<FIntVector2, 8>& OutDirections) const;
+		std::optional<FIntVector2> Jump(FIntVector2 const& From, FIntVector2 const& Direction, FIntVector2 const& Goal) const;
+		std::optional<FIntVector2> LookupJump(FIntVector2 const& From, FIntVector2 const& Direction, FIntVector2 const& Goal) const;
+		bool IsWalkable(FIntVector2 const& Cell) const;
+		float GetOctileCost(FIntVector2 const& From, FIntVector2 const& To) const;
+		void BuildCellPath(int DestinationId, PathSearchContext& Context) const;
+
+		GridGraph* pGrid;
+		JumpPointTable const* pJumpTable;
+		PathSearchContext DefaultContext{};
+	};
+}
@@ -0,0 +1,191 @@
+﻿#include "JumpPointTable.h"
+#include <algorithm>
+#include <limits>
+
+#include "Shared/Graph/GridGraph/GridGraph.h"
+
+using namespace GameAI;
+
+JumpPointTable::JumpPointTable(GridGraph const* pGrid)
+	: pGrid(pGrid)
+	, NrRows(pGrid->GetRows())
+	, NrColumns(pGrid->GetColumns())
+{
+	Rebuild();
+}
+
+void JumpPointTable::Rebuild()
+{
+	double const StartTime = FPlatformTime::Seconds();
+
+	// Distances are stored as int16
+	bIsValid = std::max(NrRows, NrColumns) < std::numeric_limits<int16_t>::max();
+	if (!bIsValid)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("JumpPointTable: %dx%d grid is too large, JPS+ disabled"), NrColumns, NrRows);
+		return;
+	}
+
+	Walkable.assign(static_cast<size_t>(NrRows) * NrColumns, 0);
+	for (int Row = 0; Row < NrRows; ++Row)
+	{
+		for (int Col = 0; Col < NrColumns; ++Col)
+		{
+			Walkable[pGrid->GetNodeId(Col, Row)] = pGrid->IsWalkable(Col, Row);
+		}
+	}
+	Distances.assign(Walkable.size() * NrDirections, 0);
+
+	// Diagonals look at the straight distances, so those go first
+	for (int Row = 0; Row < NrRows; ++Row) ComputeRow(Row);
+	for (int Col = 0; Col < NrColumns; ++Col) ComputeColumn(Col);
+	ComputeDiagonals(1, 1);
+	ComputeDiagonals(1, -1);
+	ComputeDiagonals(-1, 1);
+	ComputeDiagonals(-1, -1);
+
+	BuildTimeMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+	UE_LOG(LogTemp, Log, TEXT("JumpPointTable: built %dx%d in %.2f ms, %.1f bytes per cell"),
+		NrColumns, NrRows, BuildTimeMs, GetBytesPerCell());
+}
+
+bool JumpPointTable::UpdateNode(int NodeId)
+{
+	if (!bIsValid || NodeId < 0 || NodeId >= static_cast<int>(Walkable.size())) return false;
+
+	FIntVector2 const Cell = pGrid->GetColAndRow(NodeId);
+	uint8_t const bNowWalkable = pGrid->IsWalkable(Cell.X, Cell.Y);
+	if (Walkable[NodeId] == bNowWalkable) return false;
+
+	double const StartTime = FPlatformTime::Seconds();
+	Walkable[NodeId] = bNowWalkable;
+
+	// Forced neighbor checks look one row/column to the side, so the neighbouring lines change too
+	DirtyCells.clear();
+	for (int Row = Cell.Y - 1; Row <= Cell.Y + 1; ++Row)
+	{
+		if (Row < 0 || Row >= NrRows) continue;
+		ComputeRow(Row);
+		for (int Col = 0; Col < NrColumns; ++Col) DirtyCells.push_back({Col, Row});
+	}
+	for (int Col = Cell.X - 1; Col <= Cell.X + 1; ++Col)
+	{
+		if (Col < 0 || Col >= NrColumns) continue;
+		ComputeColumn(Col);
+		for (int Row = 0; Row < NrRows; ++Row) DirtyCells.push_back({Col, Row});
+	}
+
+	// A diagonal entry only depends on the cell one step further along its diagonal, so walk back from every
+	// dirty cell until the values stop changing. Cells furthest along the diagonal go first
+	for (int DeltaRow = -1; DeltaRow <= 1; DeltaRow += 2)
+	{
+		for (int DeltaCol = -1; DeltaCol <= 1; DeltaCol += 2)
+		{
+			std::ranges::sort(DirtyCells, [DeltaCol, DeltaRow](FIntVector2 const& A, FIntVector2 const& B)
+			{
+				return A.X * DeltaCol + A.Y * DeltaRow > B.X * DeltaCol + B.Y * DeltaRow;
+			});
+
+			for (FIntVector2 const& Dirty : DirtyCells)
+			{
+				int Col = Dirty.X - DeltaCol;
+				int Row = Dirty.Y - DeltaRow;
+				while (Col >= 0 && Col < NrColumns && Row >= 0 && Row < NrRows)
+				{
+					int16_t const NewDistance = Evaluate(Col, Row, DeltaCol, DeltaRow);
+					int16_t& Distance = At(Col, Row, DeltaCol, DeltaRow);
+					if (Distance == NewDistance) break;
+
+					Distance = NewDistance;
+					Col -= DeltaCol;
+					Row -= DeltaRow;
+				}
+			}
+		}
+	}
+
+	LastUpdateTimeMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+	return true;
+}
+
+size_t JumpPointTable::GetAllocatedBytes() const
+{
+	return Distances.capacity() * sizeof(int16_t) + Walkable.capacity() * sizeof(uint8_t)
+		+ DirtyCells.capacity() * sizeof(FIntVector2);
+}
+
+float JumpPointTable::GetBytesPerCell() const
+{
+	return Walkable.empty() ? 0.f : static_cast<float>(GetAllocatedBytes()) / Walkable.size();
+}
+
+bool JumpPointTable::IsWalkable(int Col, int Row) const
+{
+	return Col >= 0 && Col < NrColumns && Row >= 0 && Row < NrRows && Walkable[pGrid->GetNodeId(Col, Row)];
+}
+
+int16_t& JumpPointTable::At(int Col, int Row, int DeltaCol, int DeltaRow)
+{
+	return Distances[pGrid->GetNodeId(Col, Row) * NrDirections + GetDirectionIndex(DeltaCol, DeltaRow)];
+}
+
+int16_t JumpPointTable::At(int Col, int Row, int DeltaCol, int DeltaRow) const
+{
+	return Distances[pGrid->GetNodeId(Col, Row) * NrDirections + GetDirectionIndex(DeltaCol, DeltaRow)];
+}
+
+bool JumpPointTable::IsJumpPoint(int Col, int Row, int DeltaCol, int DeltaRow) const
+{
+	// Same forced neighbor rules as JumpPointSearch::Jump
+	if (DeltaCol != 0 && DeltaRow != 0)
+	{
+		return (IsWalkable(Col - DeltaCol, Row + DeltaRow) && !IsWalkable(Col - DeltaCol, Row))
+			|| (IsWalkable(Col + DeltaCol, Row - DeltaRow) && !IsWalkable(Col, Row - DeltaRow))
+			|| At(Col, Row, DeltaCol, 0) > 0
+			|| At(Col, Row, 0, DeltaRow) > 0;
+	}
+	if (DeltaCol != 0)
+	{
+		return (IsWalkable(Col + DeltaCol, Row + 1) && !IsWalkable(Col, Row + 1))
+			|| (IsWalkable(Col + DeltaCol, Row - 1) && !IsWalkable(Col, Row - 1));
+	}
+	return (IsWalkable(Col + 1, Row + DeltaRow) && !IsWalkable(Col + 1, Row))
+		|| (IsWalkable(Col - 1, Row + DeltaRow) && !IsWalkable(Col - 1, Row));
+}
+
+int16_t JumpPointTable::Evaluate(int Col, int Row, int DeltaCol, int DeltaRow) const
+{
+	int const NextCol = Col + DeltaCol;
+	int const NextRow = Row + DeltaRow;
+	if (!IsWalkable(NextCol, NextRow)) return 0;
+	if (IsJumpPoint(NextCol, NextRow, DeltaCol, DeltaRow)) return 1;
+
+	int16_t const NextDistance = At(NextCol, NextRow, DeltaCol, DeltaRow);
+	return NextDistance > 0 ? NextDistance + 1 : NextDistance - 1;
+}
+
+void JumpPointTable::ComputeRow(int Row)
+{
+	// Sweep against the direction so the next cell is always done already
+	for (int Col = NrColumns - 1; Col >= 0; --Col) At(Col, Row, 1, 0) = Evaluate(Col, Row, 1, 0);
+	for (int Col = 0; Col < NrColumns; ++Col) At(Col, Row, -1, 0) = Evaluate(Col, Row, -1, 0);
+}
+
+void JumpPointTable::ComputeColumn(int Col)
+{
+	for (int Row = NrRows - 1; Row >= 0; --Row) At(Col, Row, 0, 1) = Evaluate(Col, Row, 0, 1);
+	for (int Row = 0; Row < NrRows; ++Row) At(Col, Row, 0, -1) = Evaluate(Col, Row, 0, -1);
+}
+
+void JumpPointTable::ComputeDiagonals(int DeltaCol, int DeltaRow)
+{
+	for (int RowStep = 0; RowStep < NrRows; ++RowStep)
+	{
+		int const Row = DeltaRow > 0 ? NrRows - 1 - RowStep : RowStep;
+		for (int ColStep = 0; ColStep < NrColumns; ++ColStep)
+		{
+			int const Col = DeltaCol > 0 ? NrColumns - 1 - ColStep : ColStep;
+			At(Col, Row, DeltaCol, DeltaRow) = Evaluate(Col, Row, DeltaCol, DeltaRow);
+		}
+	}
+}
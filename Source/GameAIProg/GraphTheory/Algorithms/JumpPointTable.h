@@ -0,0 +1,70 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace GameAI
+{
+	class GridGraph;
+
+	// JPS+ lookup table: for every cell and each of the 8 directions, the number of steps to the next jump point.
+	// Positive: a jump point lies that many cells away. Zero or negative: no jump point, -Distance walkable cells
+	// until a wall or the grid border. Uses the same rules as JumpPointSearch (diagonals may cut corners).
+	// Walkability is snapshotted, so UpdateNode can tell whether a repaint actually changed anything
+	class JumpPointTable final
+	{
+	public:
+		explicit JumpPointTable(GridGraph const* pGrid);
+
+		void Rebuild();
+
+		// Call after a node's terrain changed. Only recomputes the straight scans of the 3 rows and columns
+		// around the node and the diagonal scans leading into them, returns false if walkability didn't change
+		bool UpdateNode(int NodeId);
+
+		bool IsValid() const { return bIsValid; }
+		int GetDistance(int NodeId, FIntVector2 const& Direction) const
+		{
+			return Distances[NodeId * NrDirections + GetDirectionIndex(Direction.X, Direction.Y)];
+		}
+
+		// Stats
+		double GetBuildTimeMs() const { return BuildTimeMs; }
+		double GetLastUpdateTimeMs() const { return LastUpdateTimeMs; }
+		size_t GetAllocatedBytes() const;
+		float GetBytesPerCell() const;
+
+	private:
+		static int constexpr NrDirections = 8;
+
+		GridGraph const* pGrid;
+		int NrRows;
+		int NrColumns;
+
+		std::vector<int16_t> Distances{}; // NrDirections entries per cell, cell major
+		std::vector<uint8_t> Walkable{};
+		std::vector<FIntVector2> DirtyCells{}; // scratch for UpdateNode
+
+		double BuildTimeMs{0.0};
+		double LastUpdateTimeMs{0.0};
+		bool bIsValid{false};
+
+		static int GetDirectionIndex(int DeltaCol, int DeltaRow)
+		{
+			// (-1,-1) .. (1,1) without (0,0)
+			int const Slot = (DeltaRow + 1) * 3 + (DeltaCol + 1);
+			return Slot < 4 ? Slot : Slot - 1;
+		}
+
+		bool IsWalkable(int Col, int Row) const;
+		int16_t& At(int Col, int Row, int DeltaCol, int DeltaRow);
+		int16_t At(int Col, int Row, int DeltaCol, int DeltaRow) const;
+
+		bool IsJumpPoint(int Col, int Row, int DeltaCol, int DeltaRow) const;
+		int16_t Evaluate(int Col, int Row, int DeltaCol, int DeltaRow) const;
+
+		void ComputeRow(int Row);
+		void ComputeColumn(int Col);
+		void ComputeDiagonals(int DeltaCol, int DeltaRow);
+	};
+}
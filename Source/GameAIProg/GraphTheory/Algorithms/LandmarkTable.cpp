@@ -0,0 +1,250 @@
+﻿#include "LandmarkTable.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "Async/ParallelFor.h"
+#include "SearchContainers.h"
+#include "Shared/Graph/Graph.h"
+
+using namespace GameAI;
+
+namespace
+{
+	float constexpr Unreachable = std::numeric_limits<float>::infinity();
+
+	// Single source Dijkstra, bReverse walks the incoming connections (costs towards the source).
+	// Writes every NrLandmarks-th entry of Costs starting at LandmarkIdx
+	void FillCosts(Graph const& SearchGraph, int SourceId, bool bReverse, int NrLandmarks, int LandmarkIdx,
+		std::vector<float>& Costs, IndexedHeap<4>& OpenList)
+	{
+		auto const CostOf = [&](int NodeId) -> float& { return Costs[static_cast<size_t>(NodeId) * NrLandmarks + LandmarkIdx]; };
+
+		OpenList.Clear();
+		CostOf(SourceId) = 0.f;
+		OpenList.Push(SourceId, 0.f);
+		while (!OpenList.IsEmpty())
+		{
+			int const CurrentId = OpenList.Pop();
+			float const CurrentCost = CostOf(CurrentId);
+
+			auto const Connections = bReverse ? SearchGraph.GetConnectionsTo(CurrentId) : SearchGraph.GetConnectionsFrom(CurrentId);
+			for (Connection* const pConnection : Connections)
+			{
+				int const NextId = bReverse ? pConnection->GetFromId() : pConnection->GetToId();
+				float const NewCost = CurrentCost + pConnection->GetWeight();
+				if (NewCost >= CostOf(NextId)) continue;
+
+				CostOf(NextId) = NewCost;
+				OpenList.PushOrDecrease(NextId, NewCost);
+			}
+		}
+	}
+}
+
+LandmarkTable::LandmarkTable(Graph const* pGraph, int NrLandmarks, bool bQuantize)
+	: pGraph(pGraph)
+	, NrRequestedLandmarks(NrLandmarks)
+	, bQuantize(bQuantize)
+{
+	Rebuild();
+}
+
+void LandmarkTable::Rebuild()
+{
+	double const StartTime = FPlatformTime::Seconds();
+
+	NrNodes = static_cast<int>(pGraph->GetNodes().size());
+	SelectLandmarks();
+
+	int const NrSelected = static_cast<int>(Landmarks.size());
+	bool const bDirectional = pGraph->GetIsDirectional();
+	size_t const TableSize = static_cast<size_t>(NrNodes) * NrSelected;
+	CostsFrom.assign(TableSize, Unreachable);
+	CostsTo.assign(bDirectional ? TableSize : 0, Unreachable);
+
+	// The lazy adjacency index is not thread safe, build it before the workers read it
+	pGraph->RebuildAdjacency();
+
+	// Every job writes its own column of the tables
+	int const NrJobs = NrSelected * (bDirectional ? 2 : 1);
+	ParallelFor(NrJobs, [this, NrSelected](int32 JobIdx)
+	{
+		IndexedHeap<4> OpenList{};
+		OpenList.Reserve(NrNodes);
+
+		int const LandmarkIdx = JobIdx % NrSelected;
+		bool const bReverse = JobIdx >= NrSelected;
+		FillCosts(*pGraph, Landmarks[LandmarkIdx], bReverse, NrSelected, LandmarkIdx, bReverse ? CostsTo : CostsFrom, OpenList);
+	});
+	NrLandmarks = NrSelected;
+
+	if (bQuantize)
+	{
+		Quantize();
+	}
+
+	BuildTimeMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+	UE_LOG(LogTemp, Log, TEXT("LandmarkTable: %d landmarks over %d nodes in %.2f ms"), NrSelected, NrNodes, BuildTimeMs);
+}
+
+void LandmarkTable::SelectLandmarks()
+{
+	// Farthest-point selection: every new landmark is the node farthest (in hops) from all landmarks so far.
+	// Hops are good enough to spread them out and avoid running a weighted search per candidate
+	Landmarks.clear();
+
+	int SeedId = Graphs::InvalidNodeId;
+	for (int NodeId = 0; NodeId < NrNodes && SeedId == Graphs::InvalidNodeId; ++NodeId)
+	{
+		if (pGraph->GetNode(NodeId)->GetId() != Graphs::InvalidNodeId && !pGraph->GetConnectionsFrom(NodeId).empty())
+		{
+			SeedId = NodeId;
+		}
+	}
+	if (SeedId == Graphs::InvalidNodeId) return;
+
+	int constexpr Unvisited = std::numeric_limits<int>::max();
+	std::vector<int> MinHops(NrNodes, Unvisited);
+	std::vector<int> Hops(NrNodes);
+	std::vector<int> Queue{};
+	Queue.reserve(NrNodes);
+
+	// The seed itself is not a landmark, the farthest node from it is the first one
+	int SourceId = SeedId;
+	while (static_cast<int>(Landmarks.size()) <= NrRequestedLandmarks)
+	{
+		std::ranges::fill(Hops, Unvisited);
+		Queue.assign(1, SourceId);
+		Hops[SourceId] = 0;
+		for (size_t Head = 0; Head < Queue.size(); ++Head)
+		{
+			int const CurrentId = Queue[Head];
+			for (Connection* const pConnection : pGraph->GetConnectionsFrom(CurrentId))
+			{
+				int const NextId = pConnection->GetToId();
+				if (Hops[NextId] != Unvisited) continue;
+
+				Hops[NextId] = Hops[CurrentId] + 1;
+				Queue.push_back(NextId);
+			}
+		}
+
+		// The seed's search only picks the first landmark, it doesn't count as one
+		if (SourceId != SeedId || !Landmarks.empty())
+		{
+			Landmarks.push_back(SourceId);
+			for (int const NodeId : Queue)
+			{
+				MinHops[NodeId] = std::min(MinHops[NodeId], Hops[NodeId]);
+			}
+		}
+		else
+		{
+			MinHops = Hops;
+		}
+		if (static_cast<int>(Landmarks.size()) == NrRequestedLandmarks) break;
+
+		// Next one is the node farthest from all landmarks, stop when everything reachable is a landmark
+		int FarthestId = Graphs::InvalidNodeId;
+		int FarthestHops = 0;
+		for (int const NodeId : Queue)
+		{
+			if (MinHops[NodeId] > FarthestHops)
+			{
+				FarthestHops = MinHops[NodeId];
+				FarthestId = NodeId;
+			}
+		}
+		if (FarthestId == Graphs::InvalidNodeId) break;
+		SourceId = FarthestId;
+	}
+}
+
+void LandmarkTable::Quantize()
+{
+	// One step size for both tables, the largest finite cost maps to the top of the range
+	float MaxCost = 0.f;
+	for (float const Cost : CostsFrom) if (Cost != Unreachable) MaxCost = std::max(MaxCost, Cost);
+	for (float const Cost : CostsTo) if (Cost != Unreachable) MaxCost = std::max(MaxCost, Cost);
+	QuantizationStep = MaxCost > 0.f ? MaxCost / (QuantizedUnreachable - 1) : 1.f;
+
+	auto const Convert = [this](std::vector<float>& Costs, std::vector<uint16_t>& Quantized)
+	{
+		Quantized.resize(Costs.size());
+		for (size_t Idx = 0; Idx < Costs.size(); ++Idx)
+		{
+			Quantized[Idx] = Costs[Idx] == Unreachable
+				? QuantizedUnreachable
+				: static_cast<uint16_t>(std::min(std::floor(Costs[Idx] / QuantizationStep), QuantizedUnreachable - 1.f));
+		}
+		// Only the quantized copy is kept
+		Costs.clear();
+		Costs.shrink_to_fit();
+	};
+	Convert(CostsFrom, QuantizedFrom);
+	Convert(CostsTo, QuantizedTo);
+}
+
+float LandmarkTable::GetLowerBound(int FromId, int ToId) const
+{
+	if (FromId == ToId || NrLandmarks == 0) return 0.f;
+
+	size_t const FromOffset = static_cast<size_t>(FromId) * NrLandmarks;
+	size_t const ToOffset = static_cast<size_t>(ToId) * NrLandmarks;
+	bool const bDirectional = pGraph->GetIsDirectional();
+
+	float Bound = 0.f;
+	if (!bQuantize)
+	{
+		for (int Landmark = 0; Landmark < NrLandmarks; ++Landmark)
+		{
+			float const FromLandmarkToFrom = CostsFrom[FromOffset + Landmark];
+			float const FromLandmarkToTo = CostsFrom[ToOffset + Landmark];
+			float const ToLandmarkFromFrom = bDirectional ? CostsTo[FromOffset + Landmark] : FromLandmarkToFrom;
+			float const ToLandmarkFromTo = bDirectional ? CostsTo[ToOffset + Landmark] : FromLandmarkToTo;
+			Bound = std::max(Bound, GetBound(FromLandmarkToFrom, FromLandmarkToTo, ToLandmarkFromFrom, ToLandmarkFromTo));
+		}
+		return Bound;
+	}
+
+	// Quantized costs are rounded down, so a difference can be short by up to one step
+	auto const Dequantize = [](uint16_t Value) { return Value == QuantizedUnreachable ? Unreachable : static_cast<float>(Value); };
+	for (int Landmark = 0; Landmark < NrLandmarks; ++Landmark)
+	{
+		float const FromLandmarkToFrom = Dequantize(QuantizedFrom[FromOffset + Landmark]);
+		float const FromLandmarkToTo = Dequantize(QuantizedFrom[ToOffset + Landmark]);
+		float const ToLandmarkFromFrom = bDirectional ? Dequantize(QuantizedTo[FromOffset + Landmark]) : FromLandmarkToFrom;
+		float const ToLandmarkFromTo = bDirectional ? Dequantize(QuantizedTo[ToOffset + Landmark]) : FromLandmarkToTo;
+		Bound = std::max(Bound, GetBound(FromLandmarkToFrom, FromLandmarkToTo, ToLandmarkFromFrom, ToLandmarkFromTo) - 1.f);
+	}
+	return Bound * QuantizationStep;
+}
+
+float LandmarkTable::GetBound(float FromLandmarkToFrom, float FromLandmarkToTo, float ToLandmarkFromFrom, float ToLandmarkFromTo) const
+{
+	// d(L, to) <= d(L, from) + d(from, to) and d(from, L) <= d(from, to) + d(to, L).
+	// A landmark that can't see one of the nodes tells nothing
+	float Bound = 0.f;
+	if (FromLandmarkToFrom != Unreachable && FromLandmarkToTo != Unreachable)
+	{
+		Bound = FromLandmarkToTo - FromLandmarkToFrom;
+	}
+	if (ToLandmarkFromFrom != Unreachable && ToLandmarkFromTo != Unreachable)
+	{
+		Bound = std::max(Bound, ToLandmarkFromFrom - ToLandmarkFromTo);
+	}
+	return Bound;
+}
+
+size_t LandmarkTable::GetAllocatedBytes() const
+{
+	return (CostsFrom.capacity() + CostsTo.capacity()) * sizeof(float)
+		+ (QuantizedFrom.capacity() + QuantizedTo.capacity()) * sizeof(uint16_t)
+		+ Landmarks.capacity() * sizeof(int);
+}
+
+float LandmarkTable::GetBytesPerNode() const
+{
+	return NrNodes > 0 ? static_cast<float>(GetAllocatedBytes() - Landmarks.capacity() * sizeof(int)) / NrNodes : 0.f;
+}
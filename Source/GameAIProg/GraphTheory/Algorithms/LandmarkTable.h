@@ -0,0 +1,60 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace GameAI
+{
+	class Graph;
+
+	// ALT (A*, Landmarks, Triangle inequality) lower bounds.
+	// Stores the shortest path cost between every node and K landmarks, for any two nodes the triangle inequality
+	// then gives a lower bound on their distance that follows the real costs (mud, winding corridors) instead of
+	// the straight line. Landmarks are spread out with farthest-point selection on hop counts, the cost tables
+	// are filled by one Dijkstra per landmark in parallel. Directed graphs need a second table towards the landmarks.
+	// The bounds only hold for the costs at build time, call Rebuild after the graph changed
+	class LandmarkTable final
+	{
+	public:
+		// bQuantize stores 16 bit fixed point costs instead of floats, the bounds are rounded down so they stay admissible
+		LandmarkTable(Graph const* pGraph, int NrLandmarks, bool bQuantize = false);
+
+		void Rebuild();
+
+		// Lower bound on the cost from FromId to ToId, 0 when no landmark knows both nodes
+		float GetLowerBound(int FromId, int ToId) const;
+
+		std::vector<int> const& GetLandmarks() const { return Landmarks; }
+		bool IsQuantized() const { return bQuantize; }
+
+		// Stats
+		double GetBuildTimeMs() const { return BuildTimeMs; }
+		size_t GetAllocatedBytes() const;
+		float GetBytesPerNode() const;
+
+	private:
+		static uint16_t constexpr QuantizedUnreachable = 0xFFFF;
+
+		Graph const* pGraph;
+		int NrRequestedLandmarks;
+		int NrLandmarks{0}; // fewer than requested when the graph is small
+		int NrNodes{0};
+		bool bQuantize;
+
+		std::vector<int> Landmarks{};
+
+		// NrLandmarks entries per node, node major. "From" holds landmark -> node, "To" node -> landmark (directed only)
+		std::vector<float> CostsFrom{};
+		std::vector<float> CostsTo{};
+		std::vector<uint16_t> QuantizedFrom{};
+		std::vector<uint16_t> QuantizedTo{};
+		float QuantizationStep{1.f};
+
+		double BuildTimeMs{0.0};
+
+		void SelectLandmarks();
+		void Quantize();
+
+		float GetBound(float FromLandmarkToFrom, float FromLandmarkToTo, float ToLandmarkFromFrom, float ToLandmarkFromTo) const;
+	};
+}
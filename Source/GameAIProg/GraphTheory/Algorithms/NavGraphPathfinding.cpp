@@ -1,103 +1,306 @@
 ﻿#include "NavGraphPathfinding.h"
 
+#include <algorithm>
+
 #include "AStar.h"
+#include "ContractionHierarchy.h"
+#include "PathCache.h"
 #include "PathSmoothing.h"
 #include "VectorTypes.h"
 #include "Shared/Graph/NavGraph/NavGraph.h"
 #include "Shared/Graph/NavGraph/NavGraphNode.h"
+#include "Shared/Graph/NavGraph/TiledNavGraph.h"
 
 using namespace GameAI;
 
-std::vector<FVector2D> NavMeshPathfinding::FindPath(const FVector2D& startPos, const FVector2D& endPos,
-    NavGraph* const pNavGraph, std::vector<FVector2D>& debugNodePositions, std::vector<NavLine>& debugPortals) 
+namespace
 {
-    // Path result
-    std::vector<FVector2D> finalPath{};
-
-    // Get start and end triangles
-    auto const* pStartTriangle = pNavGraph->GetNavPolygon()->GetTriangleAtPosition(startPos, true);
-    auto const* pEndTriangle = pNavGraph->GetNavPolygon()->GetTriangleAtPosition(endPos, true);
+    // The start and end points never become graph nodes: a search starts at every portal of the start triangle
+    // and ends at every portal of the end triangle, with the distance to the point as the seed cost
+    std::vector<PathSeed> GetPortalSeeds(NavGraph const* const pNavGraph, TriPolygon::Triangle const& triangle, FVector2D const& position)
+    {
+        TriPolygon const* pNavPoly = pNavGraph->GetNavPolygon();
+        std::vector<PathSeed> seeds{};
+        for (int edgeIdx : pNavPoly->GetTriangleEdgeIds(pNavPoly->GetTriangleIndex(triangle)))
+        {
+            int nodeId = pNavGraph->GetNodeIdFromEdgeIndex(edgeIdx);
 
-    // No valid path if outside navmesh
-    if (pStartTriangle == nullptr || pEndTriangle == nullptr)
-        return finalPath;
+            if (nodeId != Graphs::InvalidNodeId)
+                seeds.push_back(PathSeed{nodeId, static_cast<float>(FVector2D::Distance(position, pNavGraph->GetNode(nodeId)->GetPosition()))});
+        }
+        return seeds;
+    }
 
-    // Same triangle -> straight line
-    if (pStartTriangle == pEndTriangle)
+    // Nothing blocks the straight line, no search needed
+    bool HasLineOfSight(TriPolygon const& navPoly, TriPolygon::Triangle const& startTriangle, const FVector2D& startPos, const FVector2D& endPos)
     {
-        finalPath.push_back(startPos);
-        finalPath.push_back(endPos);
-        return finalPath;
+        FVector2D hitPosition;
+        return navPoly.Raycast(navPoly.GetTriangleIndex(startTriangle), startPos, endPos, hitPosition);
     }
 
-    // Clone graph to modify safely
-    auto pCloneGraph = pNavGraph->Clone();
+    // Portal path between two triangles from the cache, searched and added on a miss. pCachedPath keeps a hit alive
+    template <typename PortalSearch>
+    std::span<Node* const> FindCachedPortalPath(PathCache* pCache, NavGraph const* const pNavGraph, TriPolygon::Triangle const& startTriangle,
+        TriPolygon::Triangle const& endTriangle, PathCache::SharedPath& pCachedPath, PortalSearch const& search)
+    {
+        if (pCache == nullptr)
+            return search();
 
-    // Create start node
-    auto pStartNode = std::make_unique<NavGraphNode>(startPos, -1); 
-    auto pRawStartNode = pStartNode.get();
-    
-    pCloneGraph->AddNode(std::move(pStartNode));
-    int startNodeId = pRawStartNode->GetId();
+        TriPolygon const* pNavPoly = pNavGraph->GetNavPolygon();
+        int const startIdx = pNavPoly->GetTriangleIndex(startTriangle);
+        int const endIdx = pNavPoly->GetTriangleIndex(endTriangle);
+        pCachedPath = pCache->Find(startIdx, endIdx, pNavGraph->GetVersion());
+        if (pCachedPath == nullptr)
+            pCachedPath = pCache->Add(startIdx, endIdx, pNavGraph->GetVersion(), search());
+        return *pCachedPath;
+    }
 
-    // Connect start node to triangle portals
-    for (auto const& edge : pStartTriangle->GetEdges())
+    bool ReachesTarget(std::span<Node* const> portalPath, std::span<PathSeed const> targets)
     {
-        int edgeIdx = pNavGraph->GetNavPolygon()->FindEdgeIndex(edge).value_or(-1);
-        int nodeId = pCloneGraph->GetNodeIdFromEdgeIndex(edgeIdx);
-        
-        if (nodeId != Graphs::InvalidNodeId)
-            pCloneGraph->AddConnection(std::make_unique<Connection>(startNodeId, nodeId));
+        return std::ranges::any_of(targets, [&portalPath](PathSeed const& target)
+        {
+            return target.NodeId == portalPath.back()->GetId();
+        });
     }
 
-    // Create end node
-    auto pEndNode = std::make_unique<NavGraphNode>(endPos, -1);
-    auto pRawEndNode = pEndNode.get();
-    
-    pCloneGraph->AddNode(std::move(pEndNode));
-    int endNodeId = pRawEndNode->GetId();
-
-    // Connect triangle portals to end node
-    for (auto const& edge : pEndTriangle->GetEdges())
+    // Wraps the portal nodes in the start and end point and runs the funnel over them.
+    // A path that doesn't end at a target portal is partial and stops at its last portal.
+    // findPortals turns the node path into the portal lines, it depends on where the graph keeps its edges
+    template <typename PortalFinder>
+    std::vector<FVector2D> SmoothPortalPath(const FVector2D& startPos, const FVector2D& endPos, std::span<Node* const> portalPath,
+        bool bReachesEnd, PortalFinder const& findPortals, std::vector<FVector2D>& debugNodePositions, std::vector<NavLine>& debugPortals)
     {
-        int edgeIdx = pNavGraph->GetNavPolygon()->FindEdgeIndex(edge).value_or(-1);
-        int nodeId = pCloneGraph->GetNodeIdFromEdgeIndex(edgeIdx);
-        
-        if (nodeId != Graphs::InvalidNodeId)
-            pCloneGraph->AddConnection(std::make_unique<Connection>(nodeId, endNodeId));
+        NavGraphNode startNode{startPos, -1};
+        NavGraphNode endNode{endPos, -1};
+        std::vector<Node*> nodePath{};
+        nodePath.reserve(portalPath.size() + 2);
+        nodePath.push_back(&startNode);
+        nodePath.insert(nodePath.end(), portalPath.begin(), portalPath.end());
+        if (bReachesEnd)
+            nodePath.push_back(&endNode);
+
+        for (Node* pNode : nodePath)
+        {
+            debugNodePositions.push_back(pNode->GetPosition());
+        }
+
+        // Smooth path
+        debugPortals = findPortals(std::span<Node* const>{nodePath});
+        return SSFA::OptimizePortals(debugPortals);
     }
 
-    // Update connection costs
-    pCloneGraph->SetConnectionCostsToDistances();
+    // Everything around the portal search, shared by the pathfinders of a NavGraph: the straight line shortcut and the cache.
+    // Fills nodePath with what the funnel runs over: the virtual start node, the portal path and the virtual end node (left out
+    // when the portal path stops short of the end), only the two virtual nodes when the end is in sight.
+    // False without a path. searchPortals(sources, targets) returns the portal path
+    template <typename PortalSearch>
+    bool FindFunnelNodePath(NavGraphNode& startNode, NavGraphNode& endNode, NavGraph const* const pNavGraph, PathCache* pCache,
+        std::vector<Node*>& nodePath, PortalSearch const& searchPortals)
+    {
+        nodePath.clear();
+        FVector2D const& startPos = startNode.GetPosition();
+        FVector2D const& endPos = endNode.GetPosition();
 
-    // Run A*
-    AStar pathfinder(pCloneGraph.get(), HeuristicFunctions::Euclidean);
-    std::vector<Node*> nodePath = pathfinder.FindPath(
-        pCloneGraph->GetNode(startNodeId).get(),
-        pCloneGraph->GetNode(endNodeId).get());
+        // Get start and end triangles
+        auto const* pStartTriangle = pNavGraph->GetNavPolygon()->GetTriangleAtPosition(startPos, true);
+        auto const* pEndTriangle = pNavGraph->GetNavPolygon()->GetTriangleAtPosition(endPos, true);
 
-    // No path found
-    if (nodePath.empty())
-        return finalPath;
+        // No valid path if outside navmesh
+        if (pStartTriangle == nullptr || pEndTriangle == nullptr)
+            return false;
 
-    // Convert nodes to positions
-    for (Node* pNode : nodePath)
+        // Same triangle or in sight -> straight line
+        if (pStartTriangle == pEndTriangle || HasLineOfSight(*pNavGraph->GetNavPolygon(), *pStartTriangle, startPos, endPos))
+        {
+            nodePath.push_back(&startNode);
+            nodePath.push_back(&endNode);
+            return true;
+        }
+
+        std::vector<PathSeed> const sources = GetPortalSeeds(pNavGraph, *pStartTriangle, startPos);
+        std::vector<PathSeed> const targets = GetPortalSeeds(pNavGraph, *pEndTriangle, endPos);
+
+        PathCache::SharedPath pCachedPath{};
+        std::span<Node* const> portalPath = FindCachedPortalPath(pCache, pNavGraph, *pStartTriangle, *pEndTriangle, pCachedPath,
+            [&]() { return searchPortals(std::span<PathSeed const>{sources}, std::span<PathSeed const>{targets}); });
+
+        // No path found
+        if (portalPath.empty())
+            return false;
+
+        // A path that doesn't end at a target portal is partial and stops at its last portal
+        nodePath.reserve(portalPath.size() + 2);
+        nodePath.push_back(&startNode);
+        nodePath.insert(nodePath.end(), portalPath.begin(), portalPath.end());
+        if (ReachesTarget(portalPath, targets))
+            nodePath.push_back(&endNode);
+        return true;
+    }
+
+    template <typename PortalSearch>
+    std::vector<FVector2D> FindNavGraphPath(const FVector2D& startPos, const FVector2D& endPos, NavGraph const* const pNavGraph,
+        PathCache* pCache, std::vector<FVector2D>& debugNodePositions, std::vector<NavLine>& debugPortals, PortalSearch const& searchPortals)
     {
-        finalPath.push_back(pNode->GetPosition());
-        debugNodePositions.push_back(pNode->GetPosition());
+        NavGraphNode startNode{startPos, -1};
+        NavGraphNode endNode{endPos, -1};
+        std::vector<Node*> nodePath{};
+        if (!FindFunnelNodePath(startNode, endNode, pNavGraph, pCache, nodePath, searchPortals))
+            return {};
+
+        // Straight line, nothing to smooth
+        if (nodePath.size() == 2 && nodePath.back() == &endNode)
+            return {startPos, endPos};
+
+        for (Node* pNode : nodePath)
+        {
+            debugNodePositions.push_back(pNode->GetPosition());
+        }
+
+        // Smooth path
+        debugPortals = SSFA::FindPortals(nodePath, *pNavGraph->GetNavPolygon());
+        return SSFA::OptimizePortals(debugPortals);
     }
+}
 
-    // Smooth path
-    debugPortals = SSFA::FindPortals(nodePath, *pNavGraph->GetNavPolygon());
-    finalPath = SSFA::OptimizePortals(debugPortals, *pNavGraph->GetNavPolygon());
-    
-    return finalPath;
+std::vector<FVector2D> NavMeshPathfinding::FindPath(const FVector2D& startPos, const FVector2D& endPos,
+    NavGraph const* const pNavGraph, PathSearchContext& Context, std::vector<FVector2D>& debugNodePositions, std::vector<NavLine>& debugPortals,
+    PathCache* pCache)
+{
+    // Run A*, the shared graph stays untouched
+    AStar const pathfinder(pNavGraph, HeuristicFunctions::Euclidean);
+    return FindNavGraphPath(startPos, endPos, pNavGraph, pCache, debugNodePositions, debugPortals,
+        [&](std::span<PathSeed const> sources, std::span<PathSeed const> targets)
+        {
+            return pathfinder.FindPath(sources, targets, endPos, Context);
+        });
 }
 
-std::vector<FVector2D> NavMeshPathfinding::FindPath(const FVector2D& startPos, const FVector2D& endPos, NavGraph* const pNavGraph)
+std::vector<FVector2D> NavMeshPathfinding::FindPath(const FVector2D& startPos, const FVector2D& endPos,
+    NavGraph const* const pNavGraph, std::vector<FVector2D>& debugNodePositions, std::vector<NavLine>& debugPortals)
+{
+    PathSearchContext Context{};
+    return FindPath(startPos, endPos, pNavGraph, Context, debugNodePositions, debugPortals);
+}
+
+std::vector<FVector2D> NavMeshPathfinding::FindPath(const FVector2D& startPos, const FVector2D& endPos, NavGraph const* const pNavGraph)
 {
     std::vector<FVector2D> debugNodePositions{};
     std::vector<NavLine> debugPortals{};
 
     return FindPath(startPos, endPos, pNavGraph, debugNodePositions, debugPortals);
-}
\ No newline at end of file
+}
+
+std::vector<FVector2D> NavMeshPathfinding::FindPath(const FVector2D& startPos, const FVector2D& endPos,
+    NavGraph const* const pNavGraph, ContractionHierarchy const& Hierarchy, PathSearchContext& Forward, PathSearchContext& Backward,
+    std::vector<FVector2D>& debugNodePositions, std::vector<NavLine>& debugPortals, PathCache* pCache)
+{
+    return FindNavGraphPath(startPos, endPos, pNavGraph, pCache, debugNodePositions, debugPortals,
+        [&](std::span<PathSeed const> sources, std::span<PathSeed const> targets)
+        {
+            return Hierarchy.FindPath(sources, targets, Forward, Backward);
+        });
+}
+
+int NavMeshPathfinding::FindPaths(std::span<NavPathQuery const> Queries, NavGraph const* const pNavGraph,
+    ContractionHierarchy const* pHierarchy, PathSearchContext& Forward, PathSearchContext& Backward, FunnelBuffer& Buffer)
+{
+    AStar const pathfinder(pNavGraph, HeuristicFunctions::Euclidean);
+    int nrExpanded = 0;
+
+    // The node paths of all queries are kept back to back until the funnel runs, with the virtual nodes they start and end at
+    std::vector<NavGraphNode> virtualNodes{};
+    virtualNodes.reserve(Queries.size() * 2);
+    std::vector<Node*> nodePaths{};
+    std::vector<size_t> pathOffsets{0};
+
+    std::vector<Node*> nodePath{};
+    for (NavPathQuery const& query : Queries)
+    {
+        NavGraphNode& startNode = virtualNodes.emplace_back(query.StartPos, -1);
+        NavGraphNode& endNode = virtualNodes.emplace_back(query.EndPos, -1);
+
+        int const nrQueriesBefore = Forward.GetQueryCount();
+        FindFunnelNodePath(startNode, endNode, pNavGraph, nullptr, nodePath,
+            [&](std::span<PathSeed const> sources, std::span<PathSeed const> targets)
+            {
+                return pHierarchy != nullptr
+                    ? pHierarchy->FindPath(sources, targets, Forward, Backward)
+                    : pathfinder.FindPath(sources, targets, query.EndPos, Forward);
+            });
+
+        // A point in sight of the other one isn't searched at all
+        if (Forward.GetQueryCount() != nrQueriesBefore)
+            nrExpanded += Forward.GetExpandedNodeCount() + (pHierarchy != nullptr ? Backward.GetExpandedNodeCount() : 0);
+
+        nodePaths.insert(nodePaths.end(), nodePath.begin(), nodePath.end());
+        pathOffsets.push_back(nodePaths.size());
+    }
+
+    // Without a path the node path is empty, and so is the smoothed one
+    std::vector<std::span<Node* const>> paths{};
+    paths.reserve(Queries.size());
+    for (size_t pathIdx = 0; pathIdx < Queries.size(); ++pathIdx)
+    {
+        paths.push_back(std::span<Node* const>{nodePaths}.subspan(pathOffsets[pathIdx], pathOffsets[pathIdx + 1] - pathOffsets[pathIdx]));
+    }
+    SSFA::SmoothPaths(paths, *pNavGraph->GetNavPolygon(), Buffer);
+    return nrExpanded;
+}
+
+std::vector<FVector2D> NavMeshPathfinding::FindPath(const FVector2D& startPos, const FVector2D& endPos,
+    TiledNavGraph const* const pNavGraph, PathSearchContext& Context, bool& bIsPartial,
+    std::vector<FVector2D>& debugNodePositions, std::vector<NavLine>& debugPortals)
+{
+    // Path result
+    std::vector<FVector2D> finalPath{};
+    bIsPartial = false;
+
+    // The start has to be loaded, the end may not be. An end that isn't on its loaded tile is outside the navmesh
+    std::optional<TiledNavGraph::TileTriangle> const startTriangle = pNavGraph->FindTriangleAt(startPos);
+    std::optional<TiledNavGraph::TileTriangle> const endTriangle = pNavGraph->FindTriangleAt(endPos);
+    if (!startTriangle || (!endTriangle && pNavGraph->IsTileResident(pNavGraph->GetTileCoord(endPos))))
+        return finalPath;
+
+    // Same triangle or in sight within one tile -> straight line
+    if (startTriangle == endTriangle || (endTriangle && startTriangle->pNavPoly == endTriangle->pNavPoly
+        && HasLineOfSight(*startTriangle->pNavPoly, startTriangle->pNavPoly->GetTriangle(startTriangle->TriIdx), startPos, endPos)))
+    {
+        finalPath.push_back(startPos);
+        finalPath.push_back(endPos);
+        return finalPath;
+    }
+
+    auto const getPortalSeeds = [pNavGraph](TiledNavGraph::TileTriangle const& triangle, FVector2D const& position)
+    {
+        std::vector<PathSeed> seeds{};
+        for (int nodeId : triangle.PortalNodeIds)
+        {
+            if (nodeId != Graphs::InvalidNodeId)
+                seeds.push_back(PathSeed{nodeId, static_cast<float>(FVector2D::Distance(position, pNavGraph->GetNode(nodeId)->GetPosition()))});
+        }
+        return seeds;
+    };
+    std::vector<PathSeed> const sources = getPortalSeeds(*startTriangle, startPos);
+    std::vector<PathSeed> const targets = endTriangle ? getPortalSeeds(*endTriangle, endPos) : std::vector<PathSeed>{};
+
+    // Without targets A* heads for the loaded node closest to the end
+    AStar const pathfinder(pNavGraph, HeuristicFunctions::Euclidean);
+    std::span<Node* const> portalPath = pathfinder.FindPath(sources, targets, endPos, Context);
+
+    // No path found
+    if (portalPath.empty())
+        return finalPath;
+
+    bool const bReachesEnd = ReachesTarget(portalPath, targets);
+    bIsPartial = !bReachesEnd;
+
+    // The portals of a tiled graph span several polygons, the graph keeps them per node
+    auto const findPortals = [pNavGraph](std::span<Node* const> nodePath)
+    {
+        return SSFA::FindPortals(nodePath, [pNavGraph](Node const* pNode)
+        {
+            return std::optional<NavLine>{pNavGraph->GetPortal(pNode->GetId())};
+        });
+    };
+    return SmoothPortalPath(startPos, endPos, portalPath, bReachesEnd, findPortals, debugNodePositions, debugPortals);
+}
@@ -1,20 +1,56 @@
 ﻿#pragma once
+#include <span>
 #include <vector>
 
 namespace GameAI
 {
+	class ContractionHierarchy;
+	class FunnelBuffer;
 	class NavGraph;
+	class PathCache;
+	class PathSearchContext;
+	class TiledNavGraph;
 
 	struct NavLine
 	{
 		FVector2D P1, P2;	
 	};
 
+	struct NavPathQuery
+	{
+		FVector2D StartPos;
+		FVector2D EndPos;
+	};
+
+	// Start and end points are virtual nodes that only live in the query, the NavGraph is never modified.
+	// Concurrent queries on one graph are fine as long as each thread passes its own PathSearchContext.
+	// When nothing blocks the straight line to the end (TriPolygon::Raycast) that line is the path, without a search.
+	// With a pCache the portal path is kept per start and end triangle: queries between the same triangles only run the funnel
+	// (a cached path can be slightly longer than a new search, the seed costs differ within the triangles)
 	class NavMeshPathfinding
 	{
 	public:
-		static std::vector<FVector2D> FindPath(const FVector2D& startPos, const FVector2D& endPos, NavGraph* const pNavGraph,
+		static std::vector<FVector2D> FindPath(const FVector2D& startPos, const FVector2D& endPos, NavGraph const* const pNavGraph,
+			PathSearchContext& Context, std::vector<FVector2D>& debugNodePositions, std::vector<NavLine>& debugPortals,
+			PathCache* pCache = nullptr);
+		static std::vector<FVector2D> FindPath(const FVector2D& startPos, const FVector2D& endPos, NavGraph const* const pNavGraph,
 			std::vector<FVector2D>& debugNodePositions, std::vector<NavLine>& debugPortals);
-		static std::vector<FVector2D> FindPath(const FVector2D& startPos, const FVector2D& endPos, NavGraph* const pNavGraph);
+		static std::vector<FVector2D> FindPath(const FVector2D& startPos, const FVector2D& endPos, NavGraph const* const pNavGraph);
+
+		// Same result through a prebuilt hierarchy of pNavGraph, the graph itself isn't touched
+		static std::vector<FVector2D> FindPath(const FVector2D& startPos, const FVector2D& endPos, NavGraph const* const pNavGraph,
+			ContractionHierarchy const& Hierarchy, PathSearchContext& Forward, PathSearchContext& Backward,
+			std::vector<FVector2D>& debugNodePositions, std::vector<NavLine>& debugPortals, PathCache* pCache = nullptr);
+
+		// Searches a batch of queries (e.g. what several agents asked for this frame) one after another and smooths them together:
+		// the path of query I is Buffer.GetPath(I), empty when there is none. Through pHierarchy when set, A* otherwise.
+		// Returns the number of nodes the searches expanded
+		static int FindPaths(std::span<NavPathQuery const> Queries, NavGraph const* const pNavGraph, ContractionHierarchy const* pHierarchy,
+			PathSearchContext& Forward, PathSearchContext& Backward, FunnelBuffer& Buffer);
+
+		// Across the resident tiles of a streamed navmesh. When the goal isn't loaded, or only reachable through tiles that aren't,
+		// the path ends at the loaded portal closest to it and bIsPartial is set. Retry once TiledNavGraph::GetVersion changes
+		static std::vector<FVector2D> FindPath(const FVector2D& startPos, const FVector2D& endPos, TiledNavGraph const* const pNavGraph,
+			PathSearchContext& Context, bool& bIsPartial, std::vector<FVector2D>& debugNodePositions, std::vector<NavLine>& debugPortals);
 	};
 }
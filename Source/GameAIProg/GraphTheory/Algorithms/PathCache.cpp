@@ -0,0 +1,88 @@
+﻿#include "PathCache.h"
+
+using namespace GameAI;
+
+PathCache::PathCache(size_t MemoryBudgetBytes)
+	: MemoryBudgetBytes(MemoryBudgetBytes)
+{
+}
+
+uint64_t PathCache::MakeKey(int StartRegion, int GoalRegion)
+{
+	return (static_cast<uint64_t>(static_cast<uint32_t>(StartRegion)) << 32) | static_cast<uint32_t>(GoalRegion);
+}
+
+PathCache::SharedPath PathCache::Find(int StartRegion, int GoalRegion, uint32 GraphVersion)
+{
+	SyncVersion(GraphVersion);
+
+	if (auto const It = EntriesByKey.find(MakeKey(StartRegion, GoalRegion)); It != EntriesByKey.end())
+	{
+		++NrHits;
+		Entries.splice(Entries.begin(), Entries, It->second); // iterators stay valid
+		return Entries.front().Path;
+	}
+
+	++NrMisses;
+	return nullptr;
+}
+
+PathCache::SharedPath PathCache::Add(int StartRegion, int GoalRegion, uint32 GraphVersion, std::span<Node* const> Path)
+{
+	SyncVersion(GraphVersion);
+
+	uint64_t const Key = MakeKey(StartRegion, GoalRegion);
+	if (auto const It = EntriesByKey.find(Key); It != EntriesByKey.end())
+	{
+		UsedBytes -= It->second->Bytes;
+		Entries.erase(It->second);
+		EntriesByKey.erase(It);
+	}
+
+	// The entry and the key with the links of their list and hash map nodes, then the path itself
+	size_t constexpr EntryOverhead = sizeof(Entry) + sizeof(std::pair<uint64_t const, EntryList::iterator>) + 4 * sizeof(void*);
+	SharedPath NewPath = std::make_shared<std::vector<Node*> const>(Path.begin(), Path.end());
+	size_t const Bytes = EntryOverhead + sizeof(std::vector<Node*>) + NewPath->capacity() * sizeof(Node*);
+
+	Entries.push_front(Entry{Key, NewPath, Bytes});
+	EntriesByKey.emplace(Key, Entries.begin());
+	UsedBytes += Bytes;
+	EvictOverBudget();
+
+	return NewPath;
+}
+
+void PathCache::Invalidate()
+{
+	Entries.clear();
+	EntriesByKey.clear();
+	UsedBytes = 0;
+}
+
+void PathCache::SetMemoryBudget(size_t NewBudgetBytes)
+{
+	MemoryBudgetBytes = NewBudgetBytes;
+	EvictOverBudget();
+}
+
+void PathCache::SyncVersion(uint32 GraphVersion)
+{
+	// None of the cached paths can be trusted on a changed graph
+	if (GraphVersion != Version)
+	{
+		Invalidate();
+		Version = GraphVersion;
+	}
+}
+
+void PathCache::EvictOverBudget()
+{
+	while (UsedBytes > MemoryBudgetBytes && Entries.size() > 1)
+	{
+		Entry const& Oldest = Entries.back();
+		UsedBytes -= Oldest.Bytes;
+		EntriesByKey.erase(Oldest.Key);
+		Entries.pop_back();
+		++NrEvictions;
+	}
+}
@@ -0,0 +1,71 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace GameAI
+{
+	class Node;
+
+	// Search results by start and goal region, for agents that keep asking for the same paths.
+	// A region is whatever the caller quantises positions to: a grid cell, a navmesh triangle, a cluster...
+	// Paths are only valid for the graph version they were found on, a new version drops the whole cache.
+	// Least recently used paths are dropped once the memory budget is exceeded, the newest one is always kept
+	class PathCache final
+	{
+	public:
+		// Immutable and shared, stays valid after the cache drops it
+		using SharedPath = std::shared_ptr<std::vector<Node*> const>;
+
+		explicit PathCache(size_t MemoryBudgetBytes);
+
+		// nullptr on a miss
+		SharedPath Find(int StartRegion, int GoalRegion, uint32 GraphVersion);
+		// Stores a copy of Path (empty for no path, that's worth remembering too) and returns it
+		SharedPath Add(int StartRegion, int GoalRegion, uint32 GraphVersion, std::span<Node* const> Path);
+
+		// Call when the results change without the graph version, e.g. another heuristic
+		void Invalidate();
+
+		void SetMemoryBudget(size_t NewBudgetBytes);
+		size_t GetMemoryBudget() const { return MemoryBudgetBytes; }
+
+		// Stats
+		int GetPathCount() const { return static_cast<int>(Entries.size()); }
+		size_t GetAllocatedBytes() const { return UsedBytes; }
+		int GetHitCount() const { return NrHits; }
+		int GetMissCount() const { return NrMisses; }
+		float GetHitRate() const { return NrHits + NrMisses > 0 ? static_cast<float>(NrHits) / (NrHits + NrMisses) : 0.f; }
+		int GetEvictionCount() const { return NrEvictions; }
+		void ResetStats() { NrHits = 0; NrMisses = 0; NrEvictions = 0; }
+
+	private:
+		struct Entry
+		{
+			uint64_t Key;
+			SharedPath Path;
+			size_t Bytes;
+		};
+		using EntryList = std::list<Entry>;
+
+		size_t MemoryBudgetBytes;
+		size_t UsedBytes{0};
+		uint32 Version{0}; // of the graph the cached paths were found on
+
+		EntryList Entries{}; // most recently used first
+		std::unordered_map<uint64_t, EntryList::iterator> EntriesByKey{};
+
+		int NrHits{0};
+		int NrMisses{0};
+		int NrEvictions{0};
+
+		static uint64_t MakeKey(int StartRegion, int GoalRegion);
+
+		void SyncVersion(uint32 GraphVersion);
+		void EvictOverBudget();
+	};
+}
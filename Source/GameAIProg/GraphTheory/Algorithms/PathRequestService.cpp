@@ -0,0 +1,513 @@
+﻿#include "PathRequestService.h"
+#include <algorithm>
+
+#include "NavGraphPathfinding.h"
+#include "Shared/Graph/GridGraph/GridGraph.h"
+#include "Shared/Graph/NavGraph/NavGraph.h"
+
+using namespace GameAI;
+
+namespace
+{
+	// Searches on a grid read the neighbours from its cell layer, the connections are only needed while it's out of sync
+	std::unique_ptr<Graph> CopyGraph(Graph const& Source)
+	{
+		if (GridGraph const* pGrid = dynamic_cast<GridGraph const*>(&Source))
+		{
+			return pGrid->IsCellLayerInSync() ? pGrid->CopyCellLayer() : std::make_unique<GridGraph>(*pGrid);
+		}
+		return std::make_unique<Graph>(Source);
+	}
+}
+
+PathRequestService::PathRequestService(Graph const* pGraph, HeuristicFunctions::Heuristic HeuristicFunction, int MaxRunningSearches)
+	: pGraph(pGraph)
+	, HeuristicFunction(HeuristicFunction)
+{
+	Slots.reserve(MaxRunningSearches);
+	for (int SlotIdx = 0; SlotIdx < MaxRunningSearches; ++SlotIdx)
+	{
+		Slots.push_back(std::make_unique<SearchSlot>());
+	}
+}
+
+PathRequestService::PathRequestService(NavGraph const* pNavGraph, ContractionHierarchy const* pHierarchy, int MaxRunningSearches)
+	: PathRequestService(pNavGraph, HeuristicFunctions::Euclidean, MaxRunningSearches)
+{
+	this->pNavGraph = pNavGraph;
+	this->pHierarchy = pHierarchy;
+}
+
+PathRequestService::~PathRequestService()
+{
+	for (std::unique_ptr<SearchSlot> const& pSlot : Slots)
+	{
+		pSlot->bCancel = true;
+	}
+	for (std::unique_ptr<SearchSlot> const& pSlot : Slots)
+	{
+		if (pSlot->Task.IsValid())
+		{
+			pSlot->Task.Wait();
+		}
+	}
+}
+
+uint64_t PathRequestService::MakeRequestKey(int StartId, int GoalId)
+{
+	return (static_cast<uint64_t>(static_cast<uint32_t>(StartId)) << 32) | static_cast<uint32_t>(GoalId);
+}
+
+PathRequestHandle PathRequestService::RequestPath(int StartNodeId, int GoalNodeId, int Priority, PathCallback OnPath, bool bAcceptPartial)
+{
+	PathRequestHandle const Handle = NextHandle++;
+	uint64_t const Key = MakeRequestKey(StartNodeId, GoalNodeId);
+	RequestKeyOfHandle[Handle] = Key;
+
+	if (auto const It = Requests.find(Key); It != Requests.end())
+	{
+		// Same start and goal, ride along with the search that is already queued or running
+		It->second.Priority = std::max(It->second.Priority, Priority);
+		It->second.Subscribers.push_back(Subscriber{Handle, std::move(OnPath), {}, bAcceptPartial});
+		++NrMerged;
+		return Handle;
+	}
+
+	Request& NewRequest = Requests.emplace(Key, Request{.StartId = StartNodeId, .GoalId = GoalNodeId, .Priority = Priority,
+		.Order = NextOrder++}).first->second;
+	NewRequest.Subscribers.push_back(Subscriber{Handle, std::move(OnPath), {}, bAcceptPartial});
+	WaitingKeys.push_back(Key);
+	return Handle;
+}
+
+PathRequestHandle PathRequestService::RequestPath(FVector2D const& StartPos, FVector2D const& EndPos, int Priority, PointPathCallback OnPath)
+{
+	checkf(pNavGraph != nullptr, TEXT("Point requests need a PathRequestService made for a NavGraph"));
+
+	PathRequestHandle const Handle = NextHandle++;
+	uint64_t const Order = NextOrder++;
+	uint64_t const Key = PointRequestBit | Order;
+	RequestKeyOfHandle[Handle] = Key;
+
+	Request& NewRequest = Requests.emplace(Key, Request{.StartId = Graphs::InvalidNodeId, .GoalId = Graphs::InvalidNodeId,
+		.StartPos = StartPos, .EndPos = EndPos, .Priority = Priority, .Order = Order}).first->second;
+	NewRequest.Subscribers.push_back(Subscriber{Handle, {}, std::move(OnPath), false});
+	WaitingKeys.push_back(Key);
+	return Handle;
+}
+
+void PathRequestService::CancelRequest(PathRequestHandle Handle)
+{
+	auto const KeyIt = RequestKeyOfHandle.find(Handle);
+	if (KeyIt == RequestKeyOfHandle.end()) return;
+
+	uint64_t const Key = KeyIt->second;
+	RequestKeyOfHandle.erase(KeyIt);
+
+	Request& CanceledRequest = Requests.at(Key);
+	std::erase_if(CanceledRequest.Subscribers, [Handle](Subscriber const& Sub) { return Sub.Handle == Handle; });
+	if (!CanceledRequest.Subscribers.empty()) return;
+
+	// Nobody waits for it anymore, drop the search wherever it is
+	std::erase(WaitingKeys, Key);
+	std::erase(DoneKeys, Key);
+	std::erase(PartialKeys, Key);
+	for (std::unique_ptr<SearchSlot> const& pSlot : Slots)
+	{
+		if (pSlot->RequestKey == Key)
+		{
+			CancelSearch(*pSlot);
+		}
+		std::ranges::replace(pSlot->PointKeys, Key, NoRequest); // the rest of its batch goes on
+	}
+	Requests.erase(Key);
+}
+
+void PathRequestService::Update()
+{
+	double const StartTime = FPlatformTime::Seconds();
+
+	CollectSearches();
+	StartWaitingSearches();
+	DeliverResults();
+
+	LastUpdateTimeUs = (FPlatformTime::Seconds() - StartTime) * 1000000.0;
+}
+
+void PathRequestService::Invalidate()
+{
+	// Finished paths that aren't delivered yet as well
+	for (uint64_t const Key : DoneKeys)
+	{
+		Requests.at(Key).Path.clear();
+		WaitingKeys.push_back(Key);
+	}
+	DoneKeys.clear();
+
+	// The running searches finish on their own, their slots are taken until then
+	for (std::unique_ptr<SearchSlot> const& pSlot : Slots)
+	{
+		for (uint64_t const Key : pSlot->PointKeys)
+		{
+			if (Key != NoRequest)
+			{
+				WaitingKeys.push_back(Key);
+			}
+		}
+		pSlot->PointKeys.clear();
+
+		if (pSlot->RequestKey == NoRequest) continue;
+
+		uint64_t const Key = pSlot->RequestKey;
+		CancelSearch(*pSlot);
+		Requests.at(Key).Path.clear();
+		std::erase(PartialKeys, Key);
+		WaitingKeys.push_back(Key);
+	}
+}
+
+void PathRequestService::SetHeuristic(HeuristicFunctions::Heuristic HeuristicFunction)
+{
+	this->HeuristicFunction = HeuristicFunction;
+	NodeHeuristicFunction = nullptr;
+}
+
+void PathRequestService::SetHeuristic(HeuristicFunctions::NodeHeuristic HeuristicFunction)
+{
+	NodeHeuristicFunction = std::move(HeuristicFunction);
+}
+
+int PathRequestService::GetRunningCount() const
+{
+	return static_cast<int>(std::ranges::count_if(Slots, [](std::unique_ptr<SearchSlot> const& pSlot)
+	{
+		return pSlot->RequestKey != NoRequest || std::ranges::any_of(pSlot->PointKeys, [](uint64_t Key) { return Key != NoRequest; });
+	}));
+}
+
+void PathRequestService::CollectSearches()
+{
+	LastNrExpanded = 0;
+	for (std::unique_ptr<SearchSlot> const& pSlot : Slots)
+	{
+		SearchSlot& Slot = *pSlot;
+		if (!Slot.Task.IsValid()) continue;
+
+		if (!Slot.Task.IsCompleted())
+		{
+			// Hand the best path so far over while the search goes on
+			if (Slot.RequestKey == NoRequest) continue;
+
+			FScopeLock const Lock{&Slot.PartialLock};
+			Request& SlotRequest = Requests.at(Slot.RequestKey);
+			if (!Slot.bHasNewPartial || Slot.pSnapshot->pGraph->GetVersion() != pGraph->GetVersion()) continue;
+
+			ToLiveNodes(Slot.PartialIds, SlotRequest.Path);
+			SlotRequest.PathVersion = pGraph->GetVersion();
+			Slot.bHasNewPartial = false;
+			if (std::ranges::find(PartialKeys, Slot.RequestKey) == PartialKeys.end())
+			{
+				PartialKeys.push_back(Slot.RequestKey);
+			}
+			continue;
+		}
+
+		Slot.Task = {};
+		if (!Slot.PointKeys.empty())
+		{
+			LastNrExpanded += Slot.NrExpanded;
+			LastSearchTimeUs = Slot.SearchTimeUs;
+			for (int PathIdx = 0; PathIdx < Slot.PointPaths.GetPathCount(); ++PathIdx)
+			{
+				uint64_t const Key = Slot.PointKeys[PathIdx];
+				if (Key == NoRequest) continue;
+
+				std::span<FVector2D const> const Path = Slot.PointPaths.GetPath(PathIdx);
+				Requests.at(Key).PointPath.assign(Path.begin(), Path.end());
+				DoneKeys.push_back(Key);
+				++NrCompleted;
+			}
+			Slot.PointKeys.clear();
+			continue;
+		}
+
+		uint64_t const Key = Slot.RequestKey;
+		Slot.RequestKey = NoRequest;
+		if (Key == NoRequest) continue; // canceled, nobody waits for it
+
+		LastNrExpanded += Slot.NrExpanded;
+		LastSearchTimeUs = Slot.SearchTimeUs;
+		Request& SlotRequest = Requests.at(Key);
+		if (Slot.pSnapshot->pGraph->GetVersion() != pGraph->GetVersion())
+		{
+			// The graph changed while the search ran, the path may cross what was edited
+			SlotRequest.Path.clear();
+			std::erase(PartialKeys, Key);
+			WaitingKeys.push_back(Key);
+			++NrStale;
+			continue;
+		}
+		else
+		{
+			ToLiveNodes(Slot.ResultIds, SlotRequest.Path);
+			SlotRequest.PathVersion = pGraph->GetVersion();
+		}
+		DoneKeys.push_back(Key);
+		++NrCompleted;
+	}
+}
+
+void PathRequestService::StartWaitingSearches()
+{
+	auto const IsBefore = [this](uint64_t FirstKey, uint64_t SecondKey)
+	{
+		Request const& First = Requests.at(FirstKey);
+		Request const& Second = Requests.at(SecondKey);
+		return First.Priority != Second.Priority ? First.Priority > Second.Priority : First.Order < Second.Order;
+	};
+
+	int const NrNodes = static_cast<int>(pGraph->GetNodes().size());
+	for (std::unique_ptr<SearchSlot> const& pSlot : Slots)
+	{
+		if (WaitingKeys.empty()) break;
+		if (pSlot->Task.IsValid()) continue;
+
+		auto const NextIt = std::ranges::min_element(WaitingKeys, IsBefore);
+		uint64_t const Key = *NextIt;
+		WaitingKeys.erase(NextIt);
+
+		if (IsPointRequest(Key))
+		{
+			// A navmesh query is short, the other waiting ones join it rather than waiting for slots of their own
+			pSlot->PointKeys.push_back(Key);
+			for (auto It = WaitingKeys.begin(); It != WaitingKeys.end() && static_cast<int>(pSlot->PointKeys.size()) < MaxPointBatchSize;)
+			{
+				if (IsPointRequest(*It))
+				{
+					pSlot->PointKeys.push_back(*It);
+					It = WaitingKeys.erase(It);
+				}
+				else
+				{
+					++It;
+				}
+			}
+			std::ranges::sort(pSlot->PointKeys, IsBefore); // delivered in this order
+			LaunchPointSearches(*pSlot);
+			continue;
+		}
+
+		// An invalid request finishes right away with an empty path
+		Request& NextRequest = Requests.at(Key);
+		if (NextRequest.StartId < 0 || NextRequest.StartId >= NrNodes
+			|| NextRequest.GoalId < 0 || NextRequest.GoalId >= NrNodes)
+		{
+			NextRequest.Path.clear();
+			NextRequest.PathVersion = pGraph->GetVersion();
+			DoneKeys.push_back(Key);
+			continue;
+		}
+
+		pSlot->RequestKey = Key;
+		LaunchSearch(*pSlot, NextRequest);
+	}
+}
+
+void PathRequestService::DeliverResults()
+{
+	// Callbacks may request or cancel paths, so nothing is iterated while they run
+	int NrDeliveries = 0;
+	while (NrDeliveries < MaxDeliveriesPerUpdate && !DoneKeys.empty())
+	{
+		uint64_t const Key = DoneKeys.front();
+		DoneKeys.erase(DoneKeys.begin());
+		std::erase(PartialKeys, Key);
+
+		// Edited since it was found, e.g. while it waited for its turn
+		if (!IsPointRequest(Key) && Requests.at(Key).PathVersion != pGraph->GetVersion())
+		{
+			Requests.at(Key).Path.clear();
+			WaitingKeys.push_back(Key);
+			continue;
+		}
+
+		Request const DoneRequest = std::move(Requests.at(Key));
+		Requests.erase(Key);
+		for (Subscriber const& Sub : DoneRequest.Subscribers)
+		{
+			RequestKeyOfHandle.erase(Sub.Handle);
+		}
+		for (Subscriber const& Sub : DoneRequest.Subscribers)
+		{
+			if (Sub.OnPointPath)
+			{
+				Sub.OnPointPath(DoneRequest.PointPath);
+			}
+			else
+			{
+				Sub.OnPath(DoneRequest.Path, true);
+			}
+		}
+		++NrDeliveries;
+	}
+
+	// Best paths so far with what is left of the budget, the ones that don't fit are sent later (or replaced by the result)
+	while (NrDeliveries < MaxDeliveriesPerUpdate && !PartialKeys.empty())
+	{
+		uint64_t const Key = PartialKeys.front();
+		PartialKeys.erase(PartialKeys.begin());
+
+		Request const& PartialRequest = Requests.at(Key);
+		if (PartialRequest.PathVersion != pGraph->GetVersion()) continue;
+
+		std::vector<Node*> const Path = PartialRequest.Path;
+		std::vector<Subscriber> const Subscribers = PartialRequest.Subscribers;
+		for (Subscriber const& Sub : Subscribers)
+		{
+			if (Sub.bAcceptPartial && RequestKeyOfHandle.contains(Sub.Handle))
+			{
+				Sub.OnPath(Path, false);
+			}
+		}
+		++NrDeliveries;
+	}
+}
+
+void PathRequestService::LaunchSearch(SearchSlot& Slot, Request const& InRequest)
+{
+	Slot.bCancel = false;
+	Slot.NrExpanded = 0;
+
+	// The heuristic is copied into the search, later changes don't reach it
+	Slot.pSnapshot = GetSnapshot();
+	Graph const* pSnapshotGraph = Slot.pSnapshot->pGraph.get();
+	if (NodeHeuristicFunction)
+	{
+		Slot.Pathfinder.emplace(pSnapshotGraph, NodeHeuristicFunction);
+	}
+	else
+	{
+		Slot.Pathfinder.emplace(pSnapshotGraph, HeuristicFunction);
+	}
+	Slot.Pathfinder->SetComponents(Slot.pSnapshot->bHasComponents ? &Slot.pSnapshot->Components : nullptr);
+
+	{
+		FScopeLock const Lock{&Slot.PartialLock};
+		Slot.PartialIds.clear();
+		Slot.bHasNewPartial = false;
+	}
+
+	bool const bWantsPartial = std::ranges::any_of(InRequest.Subscribers, [](Subscriber const& Sub) { return Sub.bAcceptPartial; });
+	Slot.Task = UE::Tasks::Launch(UE_SOURCE_LOCATION,
+		[&Slot, StartId = InRequest.StartId, GoalId = InRequest.GoalId, NrExpansions = ExpansionsPerSlice, bWantsPartial]()
+		{
+			RunNodeSearch(Slot, StartId, GoalId, NrExpansions, bWantsPartial);
+		});
+}
+
+void PathRequestService::LaunchPointSearches(SearchSlot& Slot)
+{
+	Slot.bCancel = false;
+	Slot.NrExpanded = 0;
+	Slot.PointQueries.clear();
+	for (uint64_t const Key : Slot.PointKeys)
+	{
+		Request const& PointRequest = Requests.at(Key);
+		Slot.PointQueries.push_back(NavPathQuery{PointRequest.StartPos, PointRequest.EndPos});
+	}
+
+	// The lazy adjacency index is not thread safe, build it before the task reads it
+	if (pNavGraph->IsAdjacencyDirty())
+	{
+		pNavGraph->RebuildAdjacency();
+	}
+	Slot.Task = UE::Tasks::Launch(UE_SOURCE_LOCATION, [&Slot, pNavGraph = pNavGraph, pHierarchy = pHierarchy]()
+	{
+		RunPointSearches(Slot, pNavGraph, pHierarchy);
+	});
+}
+
+void PathRequestService::CancelSearch(SearchSlot& Slot)
+{
+	// The task stops at its next slice, the slot stays taken until then
+	Slot.bCancel = true;
+	Slot.RequestKey = NoRequest;
+}
+
+std::shared_ptr<PathRequestService::GraphSnapshot const> PathRequestService::GetSnapshot()
+{
+	bool const bWantsComponents = pComponents != nullptr && pComponents->IsUpToDate(*pGraph);
+	if (pLatestSnapshot != nullptr && pLatestSnapshot->pGraph->GetVersion() == pGraph->GetVersion()
+		&& pLatestSnapshot->bHasComponents == bWantsComponents)
+	{
+		return pLatestSnapshot;
+	}
+
+	// Searches that still run on the previous snapshot keep it alive
+	auto pSnapshot = std::make_shared<GraphSnapshot>();
+	pSnapshot->pGraph = CopyGraph(*pGraph);
+	pSnapshot->pGraph->RebuildAdjacency(); // the lazy index is not thread safe
+	if (bWantsComponents)
+	{
+		pSnapshot->Components = *pComponents;
+		pSnapshot->bHasComponents = true;
+	}
+	pLatestSnapshot = std::move(pSnapshot);
+	return pLatestSnapshot;
+}
+
+void PathRequestService::ToLiveNodes(std::span<int const> NodeIds, std::vector<Node*>& Path) const
+{
+	Path.clear();
+	Path.reserve(NodeIds.size());
+	for (int const NodeId : NodeIds)
+	{
+		Path.push_back(pGraph->GetNode(NodeId).get());
+	}
+}
+
+void PathRequestService::RunNodeSearch(SearchSlot& Slot, int StartId, int GoalId, int NrExpansionsPerSlice, bool bWantsPartial)
+{
+	double const StartTime = FPlatformTime::Seconds();
+	Graph const& SnapshotGraph = *Slot.pSnapshot->pGraph;
+	AStar& Pathfinder = *Slot.Pathfinder;
+	Pathfinder.Begin(SnapshotGraph.GetNode(StartId).get(), SnapshotGraph.GetNode(GoalId).get(), Slot.Context);
+
+	auto const GetResultIds = [&Pathfinder](std::vector<int>& NodeIds)
+	{
+		NodeIds.clear();
+		for (Node* const pNode : Pathfinder.GetResult())
+		{
+			NodeIds.push_back(pNode->GetId());
+		}
+	};
+
+	// The game thread takes at most one best path so far per frame, building them more often is wasted
+	double constexpr PartialIntervalSeconds = 0.002;
+	double NextPartialTime = StartTime + PartialIntervalSeconds;
+	while (!Pathfinder.Step(NrExpansionsPerSlice))
+	{
+		if (Slot.bCancel) return;
+		if (!bWantsPartial || FPlatformTime::Seconds() < NextPartialTime) continue;
+
+		NextPartialTime = FPlatformTime::Seconds() + PartialIntervalSeconds;
+		FScopeLock const Lock{&Slot.PartialLock};
+		int const LastEndId = Slot.PartialIds.empty() ? Graphs::InvalidNodeId : Slot.PartialIds.back();
+		GetResultIds(Slot.PartialIds);
+
+		// Only closer to the goal than the last one is news
+		Slot.bHasNewPartial |= !Slot.PartialIds.empty() && Slot.PartialIds.back() != LastEndId;
+	}
+
+	GetResultIds(Slot.ResultIds);
+	Slot.NrExpanded = Slot.Context.GetExpandedNodeCount();
+	Slot.SearchTimeUs = (FPlatformTime::Seconds() - StartTime) * 1000000.0;
+}
+
+void PathRequestService::RunPointSearches(SearchSlot& Slot, NavGraph const* pNavGraph, ContractionHierarchy const* pHierarchy)
+{
+	double const StartTime = FPlatformTime::Seconds();
+	Slot.NrExpanded = NavMeshPathfinding::FindPaths(Slot.PointQueries, pNavGraph, pHierarchy, Slot.Context, Slot.BackwardContext,
+		Slot.PointPaths);
+	Slot.SearchTimeUs = (FPlatformTime::Seconds() - StartTime) * 1000000.0;
+}
@@ -0,0 +1,185 @@
+﻿#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+#include "AStar.h"
+#include "Heuristics.h"
+#include "NavGraphPathfinding.h"
+#include "PathSearchContext.h"
+#include "PathSmoothing.h"
+#include "Misc/ScopeLock.h"
+#include "Tasks/Task.h"
+
+namespace GameAI
+{
+	class ContractionHierarchy;
+	class NavGraph;
+
+	using PathRequestHandle = uint32_t;
+	static PathRequestHandle constexpr InvalidPathRequest = 0;
+
+	// Runs the path searches of many agents as background tasks, the game thread only hands out requests and collects results.
+	// Node to node searches run on a snapshot of the graph taken when they start, so the game thread can keep editing the graph:
+	// a path found on an older version is searched again instead of delivered. Point to point searches on a navmesh read the
+	// NavGraph in place, it doesn't change once built. Requests for the same start and goal share one search, the point requests
+	// that wait when a slot frees up share one task and are smoothed together.
+	// Priorities only pick which waiting request gets the next free slot, a running search is never preempted by a more
+	// important one. Cancel it to free its slot sooner
+	class PathRequestService final
+	{
+	public:
+		// Gets the path on the game thread. bIsComplete is false for the best path so far of a search that is still running
+		using PathCallback = std::function<void(std::span<Node* const> Path, bool bIsComplete)>;
+		// Gets the smoothed path on the game thread, empty when there is none
+		using PointPathCallback = std::function<void(std::span<FVector2D const> Path)>;
+
+		// Node to node requests on a graph that is edited at runtime
+		PathRequestService(Graph const* pGraph, HeuristicFunctions::Heuristic HeuristicFunction, int MaxRunningSearches = 8);
+		// Point to point requests on a static navmesh (node requests work as well), searched through pHierarchy when set
+		PathRequestService(NavGraph const* pNavGraph, ContractionHierarchy const* pHierarchy, int MaxRunningSearches = 8);
+		~PathRequestService(); // cancels the running searches and waits for them
+
+		// bAcceptPartial also delivers the best path so far whenever it changes, so agents can start walking early
+		PathRequestHandle RequestPath(int StartNodeId, int GoalNodeId, int Priority, PathCallback OnPath, bool bAcceptPartial = false);
+		// See NavMeshPathfinding::FindPath, needs the navmesh constructor
+		PathRequestHandle RequestPath(FVector2D const& StartPos, FVector2D const& EndPos, int Priority, PointPathCallback OnPath);
+		void CancelRequest(PathRequestHandle Handle);
+		bool IsPending(PathRequestHandle Handle) const { return RequestKeyOfHandle.contains(Handle); }
+
+		// Once per frame on the game thread: collects the finished searches, starts waiting requests on the free slots and calls
+		// at most MaxDeliveriesPerUpdate callbacks so a burst of results doesn't spike the frame. Never waits for a search
+		void Update();
+
+		// Searches everything that isn't delivered yet again, e.g. after the heuristic's data changed.
+		// Graph edits don't need it, they're noticed through Graph::GetVersion
+		void Invalidate();
+
+		// Used by the searches that start afterwards. Heuristics run on the background tasks: a NodeHeuristic must not read
+		// anything the game thread changes while searches run, give it its own copy (e.g. of a LandmarkTable)
+		void SetHeuristic(HeuristicFunctions::Heuristic HeuristicFunction);
+		void SetHeuristic(HeuristicFunctions::NodeHeuristic HeuristicFunction);
+		// See AStar::SetComponents, every snapshot gets a copy while they are up to date
+		void SetComponents(ConnectedComponents const* pConnectedComponents) { pComponents = pConnectedComponents; }
+		void SetHierarchy(ContractionHierarchy const* pContractionHierarchy) { pHierarchy = pContractionHierarchy; }
+		void SetMaxDeliveriesPerUpdate(int NrDeliveries) { MaxDeliveriesPerUpdate = NrDeliveries; }
+		void SetExpansionsPerSlice(int NrExpansions) { ExpansionsPerSlice = NrExpansions; } // between checks for cancellation
+
+		// Stats
+		int GetWaitingCount() const { return static_cast<int>(WaitingKeys.size()); }
+		int GetRunningCount() const;
+		int GetMergedCount() const { return NrMerged; } // requests that joined a search of another one
+		int GetCompletedCount() const { return NrCompleted; }
+		int GetStaleCount() const { return NrStale; } // searches that finished on an outdated snapshot
+		int GetLastExpandedCount() const { return LastNrExpanded; } // by the searches collected in the last Update
+		double GetLastSearchTimeUs() const { return LastSearchTimeUs; } // on its task, of the last collected search or batch
+		double GetLastUpdateTimeUs() const { return LastUpdateTimeUs; }
+
+	private:
+		static uint64_t constexpr NoRequest = ~0ull;
+		static uint64_t constexpr PointRequestBit = 1ull << 63; // point requests never merge, their keys count up from here
+		static int constexpr MaxPointBatchSize = 16;
+
+		struct Subscriber
+		{
+			PathRequestHandle Handle;
+			PathCallback OnPath;
+			PointPathCallback OnPointPath;
+			bool bAcceptPartial;
+		};
+
+		struct Request
+		{
+			int StartId;
+			int GoalId;
+			FVector2D StartPos;
+			FVector2D EndPos;
+			int Priority;
+			uint64_t Order; // first come first served within a priority
+			std::vector<Subscriber> Subscribers{};
+			std::vector<Node*> Path{}; // the result once done, the best path so far before that
+			std::vector<FVector2D> PointPath{};
+			uint32 PathVersion{0}; // of the graph Path was found on
+		};
+
+		// Immutable copy of the graph the node searches read, shared by the searches that started on the same version
+		struct GraphSnapshot
+		{
+			std::unique_ptr<Graph> pGraph;
+			ConnectedComponents Components{};
+			bool bHasComponents{false};
+		};
+
+		// A search in flight, slots are reused so their contexts stop allocating. The game thread only touches a slot
+		// while its task isn't running, except for bCancel and the partial path behind PartialLock
+		struct SearchSlot
+		{
+			PathSearchContext Context{};
+			PathSearchContext BackwardContext{}; // second half of a hierarchy search
+			std::optional<AStar> Pathfinder{}; // on the snapshot of the running search
+			std::shared_ptr<GraphSnapshot const> pSnapshot{};
+			uint64_t RequestKey{NoRequest}; // of a node search, NoRequest once canceled, the task may still run
+			std::vector<uint64_t> PointKeys{}; // of a batch of point requests, a canceled one becomes NoRequest
+			std::vector<NavPathQuery> PointQueries{};
+			UE::Tasks::FTask Task{};
+			std::atomic<bool> bCancel{false};
+
+			// Written by the task
+			std::vector<int> ResultIds{};
+			FunnelBuffer PointPaths{}; // path I belongs to PointKeys[I]
+			int NrExpanded{0};
+			double SearchTimeUs{0.0};
+
+			FCriticalSection PartialLock{};
+			std::vector<int> PartialIds{}; // best path so far
+			bool bHasNewPartial{false};
+		};
+
+		Graph const* pGraph;
+		NavGraph const* pNavGraph{nullptr};
+		ContractionHierarchy const* pHierarchy{nullptr};
+		ConnectedComponents const* pComponents{nullptr};
+		HeuristicFunctions::Heuristic HeuristicFunction{nullptr};
+		HeuristicFunctions::NodeHeuristic NodeHeuristicFunction{}; // used instead of HeuristicFunction when set
+		std::shared_ptr<GraphSnapshot const> pLatestSnapshot{};
+		std::vector<std::unique_ptr<SearchSlot>> Slots{};
+
+		std::unordered_map<uint64_t, Request> Requests{}; // by start and goal
+		std::unordered_map<PathRequestHandle, uint64_t> RequestKeyOfHandle{};
+		std::vector<uint64_t> WaitingKeys{};
+		std::vector<uint64_t> DoneKeys{}; // waiting for delivery, oldest first
+		std::vector<uint64_t> PartialKeys{}; // running searches with a new best path so far to deliver
+
+		PathRequestHandle NextHandle{1};
+		uint64_t NextOrder{0};
+		int MaxDeliveriesPerUpdate{4};
+		int ExpansionsPerSlice{64};
+
+		int NrMerged{0};
+		int NrCompleted{0};
+		int NrStale{0};
+		int LastNrExpanded{0};
+		double LastSearchTimeUs{0.0};
+		double LastUpdateTimeUs{0.0};
+
+		static uint64_t MakeRequestKey(int StartId, int GoalId);
+		static bool IsPointRequest(uint64_t Key) { return (Key & PointRequestBit) != 0 && Key != NoRequest; }
+
+		void CollectSearches();
+		void StartWaitingSearches();
+		void DeliverResults();
+		void LaunchSearch(SearchSlot& Slot, Request const& InRequest);
+		void LaunchPointSearches(SearchSlot& Slot);
+		void CancelSearch(SearchSlot& Slot);
+		std::shared_ptr<GraphSnapshot const> GetSnapshot();
+		void ToLiveNodes(std::span<int const> NodeIds, std::vector<Node*>& Path) const;
+
+		static void RunNodeSearch(SearchSlot& Slot, int StartId, int GoalId, int NrExpansionsPerSlice, bool bWantsPartial);
+		static void RunPointSearches(SearchSlot& Slot, NavGraph const* pNavGraph, ContractionHierarchy const* pHierarchy);
+	};
+}
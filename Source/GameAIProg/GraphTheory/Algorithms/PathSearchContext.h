@@ -0,0 +1,77 @@
+﻿#pragma once
+#include <span>
+#include <vector>
+
+#include "SearchContainers.h"
+
+namespace GameAI
+{
+	class Node;
+
+	// Scratch memory for graph searches (open list, record table and result buffer).
+	// Owned by the caller and reused for every query, so after the first few queries on a graph
+	// a search does not touch the heap anymore. The allocation counter shows whether that holds.
+	class PathSearchContext final
+	{
+	public:
+		PathSearchContext() = default;
+		explicit PathSearchContext(int NrNodes) { Reserve(NrNodes); }
+
+		// Sizes all buffers for a graph with NrNodes node slots
+		void Reserve(int NrNodes)
+		{
+			OpenList.Reserve(NrNodes);
+			Records.Reserve(NrNodes);
+			Path.reserve(NrNodes);
+		}
+
+		// Called by the search algorithms around every query
+		void BeginQuery(int NrNodes)
+		{
+			BytesAtQueryStart = GetAllocatedBytes();
+			OpenList.Clear();
+			OpenList.Reserve(NrNodes);
+			Records.BeginQuery(NrNodes);
+			Path.clear();
+			NrExpanded = 0;
+			++NrQueries;
+		}
+
+		void EndQuery()
+		{
+			if (GetAllocatedBytes() != BytesAtQueryStart)
+			{
+				++NrAllocatingQueries;
+			}
+		}
+
+		IndexedHeap<4>& GetOpenList() { return OpenList; }
+		NodeRecordTable& GetRecords() { return Records; }
+		NodeRecordTable const& GetRecords() const { return Records; }
+		std::vector<Node*>& GetPathBuffer() { return Path; }
+		std::span<Node* const> GetPath() const { return Path; }
+		
+		void CountExpansion() { ++NrExpanded; }
+
+		// Stats
+		int GetExpandedNodeCount() const { return NrExpanded; } // of the last query
+		int GetQueryCount() const { return NrQueries; }
+		int GetAllocationCount() const { return NrAllocatingQueries; } // queries that had to grow a buffer
+		void ResetStats() { NrQueries = 0; NrAllocatingQueries = 0; }
+
+		size_t GetAllocatedBytes() const
+		{
+			return OpenList.GetAllocatedBytes() + Records.GetAllocatedBytes() + Path.capacity() * sizeof(Node*);
+		}
+
+	private:
+		IndexedHeap<4> OpenList{};
+		NodeRecordTable Records{};
+		std::vector<Node*> Path{};
+
+		size_t BytesAtQueryStart{0};
+		int NrExpanded{0};
+		int NrQueries{0};
+		int NrAllocatingQueries{0};
+	};
+}
@@ -1,4 +1,6 @@
 ﻿#pragma once
+#include <optional>
+#include <span>
 #include <vector>
 
 #include "NavGraphPathfinding.h"
@@ -8,6 +10,32 @@
 
 namespace GameAI
 {
+	// Output and scratch memory of SSFA::SmoothPaths, reused for every batch so smoothing stops allocating once warmed up.
+	// The smoothed paths are stored back to back, path I is Points[Offsets[I] .. Offsets[I + 1])
+	class FunnelBuffer final
+	{
+	public:
+		int GetPathCount() const { return Offsets.empty() ? 0 : static_cast<int>(Offsets.size()) - 1; }
+		std::span<FVector2D const> GetPath(int PathIdx) const
+		{
+			return std::span<FVector2D const>{Points}.subspan(Offsets[PathIdx], Offsets[PathIdx + 1] - Offsets[PathIdx]);
+		}
+		std::span<FVector2D const> GetPoints() const { return Points; }
+		std::span<int const> GetOffsets() const { return Offsets; }
+
+		size_t GetAllocatedBytes() const
+		{
+			return Portals.capacity() * sizeof(NavLine) + Points.capacity() * sizeof(FVector2D) + Offsets.capacity() * sizeof(int);
+		}
+
+	private:
+		friend class SSFA;
+
+		std::vector<NavLine> Portals{}; // of the path being smoothed
+		std::vector<FVector2D> Points{};
+		std::vector<int> Offsets{};
+	};
+
 	class SSFA final
 	{
 	public:
@@ -17,51 +45,71 @@ namespace GameAI
 			return (a.X * b.Y) - (a.Y * b.X);
 		}
 
-		static std::vector<NavLine> FindPortals(std::vector<Node*> const & Path, TriPolygon const & NavPoly)
+		static std::vector<NavLine> FindPortals(std::span<Node* const> Path, TriPolygon const & NavPoly)
+		{
+			return FindPortals(Path, [&NavPoly](Node const* pNode) { return GetEdgePortal(pNode, NavPoly); });
+		}
+
+		// GetPortal returns the edge a node of the path sits on, or nullopt to skip the node.
+		// For portal graphs that don't map onto a single polygon (e.g. stitched navmesh tiles)
+		template <typename PortalGetter>
+		static std::vector<NavLine> FindPortals(std::span<Node* const> Path, PortalGetter const& GetPortal)
 		{
 			std::vector<NavLine> Portals = {};
-			if (Path.size() < 2) return Portals;
+			AppendPortals(Path, GetPortal, Portals);
+			return Portals;
+		}
 
-			// Start portal (degenerate)
-			FVector2D startPos = Path[0]->GetPosition();
-			Portals.push_back(NavLine{ startPos, startPos });
+		// Polygon edge of a NavGraph node
+		static std::optional<NavLine> GetEdgePortal(Node const* pNode, TriPolygon const & NavPoly)
+		{
+			int edgeIdx = static_cast<NavGraphNode const*>(pNode)->GetEdgeIdx();
+			if (edgeIdx == -1) return std::nullopt;
 
-			// Intermediate portals
-			for (size_t i = 1; i < Path.size() - 1; ++i)
-			{
-				auto* pNavNode = static_cast<NavGraphNode*>(Path[i]);
-				int edgeIdx = pNavNode->GetEdgeIdx();
-				
-				if (edgeIdx != -1)
-				{
-					auto const& edgeIndices = NavPoly.GetEdges()[edgeIdx].EdgeIndices;
-					FVector2D p1 = FVector2D(NavPoly.GetVertices()[edgeIndices[0]]);
-					FVector2D p2 = FVector2D(NavPoly.GetVertices()[edgeIndices[1]]);
+			auto const& edgeIndices = NavPoly.GetEdges()[edgeIdx].EdgeIndices;
+			return NavLine{ FVector2D(NavPoly.GetVertices()[edgeIndices[0]]), FVector2D(NavPoly.GetVertices()[edgeIndices[1]]) };
+		}
 
-					// Ensure correct left/right orientation
-					FVector2D dir = Path[i + 1]->GetPosition() - Path[i - 1]->GetPosition();
-					FVector2D portalVector = p2 - p1;
+		static std::vector<FVector2D> OptimizePortals(std::vector<NavLine> const & Portals, TriPolygon const &)
+		{
+			return OptimizePortals(Portals);
+		}
 
-					if (Cross2D(dir, portalVector) < 0.0f)
-					{
-						std::swap(p1, p2);
-					}
+		static std::vector<FVector2D> OptimizePortals(std::vector<NavLine> const & Portals)
+		{
+			std::vector<FVector2D> Path{};
+			AppendOptimizedPath(Portals, Path);
+			return Path;
+		}
 
-					Portals.push_back(NavLine{ p1, p2 });
-				}
-			}
+		// Smooths a batch of node paths (each one from its start to its end node, like FindPortals) into Buffer.
+		// Only Buffer is written, so worker threads can each smooth a batch with their own buffer
+		static void SmoothPaths(std::span<std::span<Node* const> const> Paths, TriPolygon const & NavPoly, FunnelBuffer& Buffer)
+		{
+			SmoothPaths(Paths, [&NavPoly](Node const* pNode) { return GetEdgePortal(pNode, NavPoly); }, Buffer);
+		}
 
-			// End portal (degenerate)
-			FVector2D endPos = Path.back()->GetPosition();
-			Portals.push_back(NavLine{ endPos, endPos });
+		template <typename PortalGetter>
+		static void SmoothPaths(std::span<std::span<Node* const> const> Paths, PortalGetter const& GetPortal, FunnelBuffer& Buffer)
+		{
+			Buffer.Points.clear();
+			Buffer.Offsets.clear();
+			Buffer.Offsets.push_back(0);
 
-			return Portals;
+			for (std::span<Node* const> Path : Paths)
+			{
+				Buffer.Portals.clear();
+				AppendPortals(Path, GetPortal, Buffer.Portals);
+				AppendOptimizedPath(Buffer.Portals, Buffer.Points);
+				Buffer.Offsets.push_back(static_cast<int>(Buffer.Points.size()));
+			}
 		}
 
-		static std::vector<FVector2D> OptimizePortals(std::vector<NavLine> const & Portals, TriPolygon const & NavPoly)
+	private:
+		// The path goes on at the end of Path
+		static void AppendOptimizedPath(std::span<NavLine const> Portals, std::vector<FVector2D>& Path)
 		{
-			std::vector<FVector2D> Path{};
-			if (Portals.empty()) return Path;
+			if (Portals.empty()) return;
 
 			// Initialize funnel
 			FVector2D apex = Portals[0].P1;
@@ -71,7 +119,7 @@ namespace GameAI
 			int leftLegIndex = 1;
 			int rightLegIndex = 1;
 
-			if (Portals.size() <= 1) return Path;
+			if (Portals.size() <= 1) return;
 
 			FVector2D rightLeg = Portals[rightLegIndex].P1 - apex;
 			FVector2D leftLeg = Portals[leftLegIndex].P2 - apex;
@@ -142,11 +190,44 @@ namespace GameAI
 
 			// Add final point
 			Path.push_back(Portals.back().P2);
+		}
 
-			return Path;
+		// The portals go on at the end of Portals
+		template <typename PortalGetter>
+		static void AppendPortals(std::span<Node* const> Path, PortalGetter const& GetPortal, std::vector<NavLine>& Portals)
+		{
+			if (Path.size() < 2) return;
+
+			// Start portal (degenerate)
+			FVector2D startPos = Path[0]->GetPosition();
+			Portals.push_back(NavLine{ startPos, startPos });
+
+			// Intermediate portals
+			for (size_t i = 1; i < Path.size() - 1; ++i)
+			{
+				if (std::optional<NavLine> portal = GetPortal(Path[i]))
+				{
+					FVector2D p1 = portal->P1;
+					FVector2D p2 = portal->P2;
+
+					// Ensure correct left/right orientation
+					FVector2D dir = Path[i + 1]->GetPosition() - Path[i - 1]->GetPosition();
+					FVector2D portalVector = p2 - p1;
+
+					if (Cross2D(dir, portalVector) < 0.0f)
+					{
+						std::swap(p1, p2);
+					}
+
+					Portals.push_back(NavLine{ p1, p2 });
+				}
+			}
+
+			// End portal (degenerate)
+			FVector2D endPos = Path.back()->GetPosition();
+			Portals.push_back(NavLine{ endPos, endPos });
 		}
 
-	private:
 		SSFA() {};
 		~SSFA() {};
 	};
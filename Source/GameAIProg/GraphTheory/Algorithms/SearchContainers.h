@@ -0,0 +1,312 @@
+﻿#pragma once
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace GameAI
+{
+	class Connection;
+
+	// Min-priority queue of node ids with decrease-key support.
+	// Every id is stored at most once, Positions maps an id to its slot in the heap.
+	// KeyType only needs < and <=, so lexicographic keys (D* Lite) work too
+	template <int Arity = 4, typename KeyType = float>
+	class IndexedHeap final
+	{
+		static_assert(Arity >= 2, "A heap needs at least two children per node");
+
+	public:
+		// Grows the position table so ids in [0, NrIds) can be pushed without allocating
+		void Reserve(int NrIds)
+		{
+			if (static_cast<int>(Positions.size()) < NrIds)
+			{
+				Positions.resize(NrIds, InvalidPosition);
+			}
+			Heap.reserve(NrIds);
+		}
+
+		// Only touches the ids still in the heap, so this is cheap after a search
+		void Clear()
+		{
+			for (Entry const& Element : Heap)
+			{
+				Positions[Element.Id] = InvalidPosition;
+			}
+			Heap.clear();
+		}
+
+		bool IsEmpty() const { return Heap.empty(); }
+		int Size() const { return static_cast<int>(Heap.size()); }
+
+		bool Contains(int Id) const
+		{
+			return Id >= 0 && Id < static_cast<int>(Positions.size()) && Positions[Id] != InvalidPosition;
+		}
+
+		KeyType const& GetKey(int Id) const { return Heap[Positions[Id]].Key; }
+		int Top() const { return Heap.front().Id; }
+		KeyType const& TopKey() const { return Heap.front().Key; }
+
+		void Push(int Id, KeyType const& Key)
+		{
+			if (Id >= static_cast<int>(Positions.size()))
+			{
+				Positions.resize(Id + 1, InvalidPosition);
+			}
+
+			Heap.push_back(Entry{Key, Id});
+			Positions[Id] = static_cast<int>(Heap.size()) - 1;
+			SiftUp(static_cast<int>(Heap.size()) - 1);
+		}
+
+		void DecreaseKey(int Id, KeyType const& NewKey)
+		{
+			int const Slot = Positions[Id];
+			Heap[Slot].Key = NewKey;
+			SiftUp(Slot);
+		}
+
+		// Key may go either way
+		void Update(int Id, KeyType const& NewKey)
+		{
+			int const Slot = Positions[Id];
+			bool const bDecreased = NewKey < Heap[Slot].Key;
+			Heap[Slot].Key = NewKey;
+			if (bDecreased)
+			{
+				SiftUp(Slot);
+			}
+			else
+			{
+				SiftDown(Slot);
+			}
+		}
+
+		// Push when absent, decrease-key when present
+		void PushOrDecrease(int Id, KeyType const& Key)
+		{
+			if (Contains(Id))
+			{
+				DecreaseKey(Id, Key);
+			}
+			else
+			{
+				Push(Id, Key);
+			}
+		}
+
+		int Pop()
+		{
+			int const TopId = Heap.front().Id;
+			Positions[TopId] = InvalidPosition;
+
+			Entry const Last = Heap.back();
+			Heap.pop_back();
+			if (!Heap.empty())
+			{
+				Heap[0] = Last;
+				Positions[Last.Id] = 0;
+				SiftDown(0);
+			}
+			return TopId;
+		}
+
+		void Remove(int Id)
+		{
+			int const Slot = Positions[Id];
+			Positions[Id] = InvalidPosition;
+
+			// Fill the hole with the last entry, which may have to move either way
+			Entry const Last = Heap.back();
+			Heap.pop_back();
+			if (Slot < static_cast<int>(Heap.size()))
+			{
+				Heap[Slot] = Last;
+				Positions[Last.Id] = Slot;
+				SiftUp(Slot);
+				SiftDown(Positions[Last.Id]);
+			}
+		}
+
+		// Visits every entry as (Id, Key), in heap order
+		template <typename Callback>
+		void ForEach(Callback&& OnEntry) const
+		{
+			for (Entry const& Element : Heap)
+			{
+				OnEntry(Element.Id, Element.Key);
+			}
+		}
+
+		// Gives every entry a new key and restores the heap order bottom up in O(n), e.g. when ARA* lowers its inflation
+		template <typename KeyFunction>
+		void Rekey(KeyFunction&& GetNewKey)
+		{
+			for (Entry& Element : Heap)
+			{
+				Element.Key = GetNewKey(Element.Id);
+			}
+
+			int const Count = static_cast<int>(Heap.size());
+			for (int Slot = Count / Arity; Slot >= 0 && Count > 1; --Slot)
+			{
+				SiftDown(Slot);
+			}
+		}
+
+		// Memory held by the heap, for stats
+		size_t GetAllocatedBytes() const
+		{
+			return Heap.capacity() * sizeof(Entry) + Positions.capacity() * sizeof(int);
+		}
+
+	private:
+		static int constexpr InvalidPosition = -1;
+
+		struct Entry
+		{
+			KeyType Key;
+			int Id;
+		};
+
+		std::vector<Entry> Heap;
+		std::vector<int> Positions;
+
+		void SiftUp(int Slot)
+		{
+			Entry const Moving = Heap[Slot];
+			while (Slot > 0)
+			{
+				int const Parent = (Slot - 1) / Arity;
+				if (Heap[Parent].Key <= Moving.Key) break;
+
+				Heap[Slot] = Heap[Parent];
+				Positions[Heap[Slot].Id] = Slot;
+				Slot = Parent;
+			}
+			Heap[Slot] = Moving;
+			Positions[Moving.Id] = Slot;
+		}
+
+		void SiftDown(int Slot)
+		{
+			int const Count = static_cast<int>(Heap.size());
+			Entry const Moving = Heap[Slot];
+			while (true)
+			{
+				int const FirstChild = Slot * Arity + 1;
+				if (FirstChild >= Count) break;
+
+				// Find the smallest child
+				int BestChild = FirstChild;
+				int const LastChild = FirstChild + Arity < Count ? FirstChild + Arity : Count;
+				for (int Child = FirstChild + 1; Child < LastChild; ++Child)
+				{
+					if (Heap[Child].Key < Heap[BestChild].Key)
+					{
+						BestChild = Child;
+					}
+				}
+
+				if (Moving.Key <= Heap[BestChild].Key) break;
+
+				Heap[Slot] = Heap[BestChild];
+				Positions[Heap[Slot].Id] = Slot;
+				Slot = BestChild;
+			}
+			Heap[Slot] = Moving;
+			Positions[Moving.Id] = Slot;
+		}
+	};
+
+	// Node a query starts or ends at, with the cost of getting there (e.g. from a point inside a triangle to its portals)
+	struct PathSeed final
+	{
+		int NodeId;
+		float Cost;
+	};
+
+	enum class NodeRecordState : uint8_t
+	{
+		Unvisited,
+		Open,
+		Closed
+	};
+
+	// Search bookkeeping for a single node, indexed by node id in a NodeRecordTable
+	struct NodeRecord final
+	{
+		Connection* pConnection = nullptr; // optimal connection leading into this node
+		int ParentId = -1; // for searches whose parents aren't adjacent (jump points, abstract graphs)
+		float CostSoFar = std::numeric_limits<float>::max(); // g-cost
+		float EstimatedTotalCost = std::numeric_limits<float>::max(); // f-cost (= g-cost + h-cost)
+		uint32_t Generation = 0;
+		NodeRecordState State = NodeRecordState::Unvisited;
+		bool bIsGoal = false; // multi goal searches mark their goals before they start
+	};
+
+	// Dense per-node record array that is reused between queries.
+	// Every query bumps the generation, records stamped with an older one count as unvisited,
+	// so nothing has to be cleared between searches
+	class NodeRecordTable final
+	{
+	public:
+		void Reserve(int NrNodes)
+		{
+			if (static_cast<int>(Records.size()) < NrNodes)
+			{
+				Records.resize(NrNodes);
+			}
+		}
+
+		void BeginQuery(int NrNodes)
+		{
+			Reserve(NrNodes);
+
+			++Generation;
+			if (Generation == 0)
+			{
+				// Wrapped around, old stamps could collide with the new ones
+				for (NodeRecord& Record : Records)
+				{
+					Record.Generation = 0;
+				}
+				Generation = 1;
+			}
+		}
+
+		// Returns the record for this query, resetting it first if it is stale
+		NodeRecord& Get(int NodeId)
+		{
+			NodeRecord& Record = Records[NodeId];
+			if (Record.Generation != Generation)
+			{
+				Record = NodeRecord{};
+				Record.Generation = Generation;
+			}
+			return Record;
+		}
+
+		// nullptr when the node was not reached in this query
+		NodeRecord const* Find(int NodeId) const
+		{
+			if (NodeId < 0 || NodeId >= static_cast<int>(Records.size())) return nullptr;
+			NodeRecord const& Record = Records[NodeId];
+			return Record.Generation == Generation ? &Record : nullptr;
+		}
+
+		NodeRecordState GetState(int NodeId) const
+		{
+			NodeRecord const* Record = Find(NodeId);
+			return Record ? Record->State : NodeRecordState::Unvisited;
+		}
+
+		int GetCapacity() const { return static_cast<int>(Records.size()); }
+		size_t GetAllocatedBytes() const { return Records.capacity() * sizeof(NodeRecord); }
+
+	private:
+		std::vector<NodeRecord> Records;
+		uint32_t Generation{0};
+	};
+}
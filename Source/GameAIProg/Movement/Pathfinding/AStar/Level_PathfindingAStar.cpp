@@ -5,7 +5,11 @@
 
 #include "GraphTheory/Algorithms/AStar.h"
 #include "GraphTheory/Algorithms/BFS.h"
+#include "GraphTheory/Algorithms/BidirectionalAStar.h"
+#include "GraphTheory/Algorithms/BidirectionalBFS.h"
+#include "GraphTheory/Algorithms/Dijkstra.h"
 #include "GraphTheory/Algorithms/Heuristics.h"
+#include "GraphTheory/Algorithms/JumpPointSearch.h"
 #include "Shared/GameAISpectator.h"
 
 using namespace GameAI;
@@ -52,6 +56,13 @@ void ALevel_PathfindingAStar::BeginPlay()
 	NodeFactory = new TerrainNodeFactory{};
 	TerrainGraph = new TerrainGridGraph{NodeFactory, 10, 10, 200.0f, 1.0f, 
 		FVector2D{-1000.0f, -1000.0f}, false};
+	SearchContext.Reserve(TerrainGraph->GetNodes().size());
+	JumpTable = new JumpPointTable{TerrainGraph};
+	Hierarchy = new HPAStar{TerrainGraph, 5, HeuristicFunction};
+	IncrementalPlanner = new DStarLite{TerrainGraph, HeuristicFunction};
+	FlowFields = new FlowFieldCache{TerrainGraph, 1 << 20};
+	Landmarks = new LandmarkTable{TerrainGraph, 8};
+	PathRequests = new PathRequestService{TerrainGraph, HeuristicFunction};
 	
 	CalculatePath();
 }
@@ -61,6 +72,13 @@ void ALevel_PathfindingAStar::BeginDestroy()
 	Super::BeginDestroy();
 	
 	delete Renderer;
+	delete JumpTable;
+	delete Hierarchy;
+	delete IncrementalPlanner;
+	delete FlowFields;
+	delete Landmarks;
+	delete PathRequests;
+	delete AnytimePlanner;
 	delete TerrainGraph;
 	delete NodeFactory;
 }
@@ -90,6 +108,9 @@ void ALevel_PathfindingAStar::Tick(float DeltaTime)
 	Super::Tick(DeltaTime);
 	
 	UpdateImGui();
+	RefineCoarsePath();
+	PathRequests->Update();
+	StepAnytimePath();
 	
 	GameAI::GraphRenderOptions RenderOptions{};
 	RenderOptions.bDrawNodes = bDrawNodeNumbers; 
@@ -109,30 +130,260 @@ void ALevel_PathfindingAStar::Tick(float DeltaTime)
 
 void ALevel_PathfindingAStar::CalculatePath()
 {
+	// A time sliced search that is still running is for the old start and end
+	PathRequests->CancelRequest(PathRequest);
+	PathRequest = InvalidPathRequest;
+	delete AnytimePlanner;
+	AnytimePlanner = nullptr;
+
 	// Find a path
 	//Check if valid start and end node exist
 	if (PathStartNodeId != Graphs::InvalidNodeId
 		&& PathEndNodeId != Graphs::InvalidNodeId
 		&& PathStartNodeId != PathEndNodeId)
 	{
-		//Select (uncomment) BFS Pathfinding or A* Pathfinding
-		// BFS pathfinder = BFS(TerrainGraph);
-		AStar pathfinder = AStar(TerrainGraph, HeuristicFunction);
 		TerrainNode* const startNode = TerrainGraph->GetNodeAs<TerrainNode>(PathStartNodeId);
 		TerrainNode* const endNode = TerrainGraph->GetNodeAs<TerrainNode>(PathEndNodeId);
+		CoarsePath = HierarchicalPath{};
 
-		FoundPath = pathfinder.FindPath(startNode, endNode);
-		// std::cout << "New path calculated using " << typeid(pathfinder).name() << std::endl;
-		UE_LOG(LogTemp, Log, TEXT("New path calculated using %hs"), typeid(pathfinder).name());
+		switch (SelectedPathfinder)
+		{
+		case 1:
+			{
+				JumpPointSearch pathfinder = JumpPointSearch(TerrainGraph, bUseJumpPointTable ? JumpTable : nullptr);
+				auto const Path = pathfinder.FindPath(startNode, endNode, SearchContext);
+				FoundPath.assign(Path.begin(), Path.end());
+				UE_LOG(LogTemp, Log, TEXT("New path calculated using %hs, %d nodes expanded"), typeid(pathfinder).name(),
+					SearchContext.GetExpandedNodeCount());
+			}
+			break;
+		case 2:
+			{
+				// Only the first segment is refined here, RefineCoarsePath does the rest while the agent walks
+				Hierarchy->FindPath(startNode, endNode, CoarsePath);
+				Hierarchy->RefineNextSegment(CoarsePath);
+				FoundPath = CoarsePath.Cells;
+				UE_LOG(LogTemp, Log, TEXT("New path calculated using %hs, %d waypoints"), typeid(HPAStar).name(),
+					static_cast<int>(CoarsePath.Waypoints.size()));
+			}
+			break;
+		case 3:
+			{
+				// Keeps its search between calls, repainting only repairs it (see SetNodeTerrain)
+				if (IncrementalPlanner->GetStartId() != PathStartNodeId || IncrementalPlanner->GetGoalId() != PathEndNodeId)
+				{
+					IncrementalPlanner->Initialize(PathStartNodeId, PathEndNodeId);
+				}
+				auto const Path = IncrementalPlanner->Replan();
+				FoundPath.assign(Path.begin(), Path.end());
+				UE_LOG(LogTemp, Log, TEXT("New path calculated using %hs, %d nodes expanded"), typeid(DStarLite).name(),
+					IncrementalPlanner->GetExpandedNodeCount());
+			}
+			break;
+		default:
+			if (bAnytime)
+			{
+				// The first path usually comes within this frame's budget, the callback swaps in the better ones
+				BeginAnytimePath();
+				if (FoundPath.empty())
+				{
+					FoundPath.assign(1, startNode);
+				}
+			}
+			else if (bTimeSliced)
+			{
+				// Only the start for now, OnTimeSlicedPath hands the agent longer paths as the search goes on
+				RequestTimeSlicedPath();
+				FoundPath.assign(1, startNode);
+			}
+			else
+			{
+				//Select (uncomment) BFS Pathfinding or A* Pathfinding
+				// BFS pathfinder = BFS(TerrainGraph);
+				if (PathCache::SharedPath const pCachedPath = bUsePathCache
+					? PathResults.Find(PathStartNodeId, PathEndNodeId, TerrainGraph->GetVersion()) : nullptr)
+				{
+					FoundPath.assign(pCachedPath->begin(), pCachedPath->end());
+					UE_LOG(LogTemp, Log, TEXT("Path taken from the cache, %d nodes"), static_cast<int>(FoundPath.size()));
+					break;
+				}
+				AStar pathfinder = SelectedHeuristic == 5
+					? AStar(TerrainGraph, [this](int FromId, int ToId) { return Landmarks->GetLowerBound(FromId, ToId); })
+					: AStar(TerrainGraph, HeuristicFunction);
+				pathfinder.SetComponents(bRejectUnreachable ? &TerrainGraph->GetComponents() : nullptr);
+				auto const Path = pathfinder.FindPath(startNode, endNode, SearchContext);
+				FoundPath.assign(Path.begin(), Path.end());
+				if (bUsePathCache)
+				{
+					PathResults.Add(PathStartNodeId, PathEndNodeId, TerrainGraph->GetVersion(), Path);
+				}
+				// std::cout << "New path calculated using " << typeid(pathfinder).name() << std::endl;
+				UE_LOG(LogTemp, Log, TEXT("New path calculated using %hs, %d nodes expanded"), typeid(pathfinder).name(),
+					SearchContext.GetExpandedNodeCount());
+			}
+			break;
+		}
 		UpdateAgentPath(FoundPath);
+
+		if (bCompareBidirectional)
+		{
+			CompareBidirectionalSearches();
+		}
 	}
 	else
 	{
 		UE_LOG(LogTemp, Log, TEXT("No valid start & end node... Start: %d, End: %d"), PathStartNodeId, PathEndNodeId);
 		// std::cout << "No valid start and end node..." << std::endl;
 		FoundPath.clear();
+		CoarsePath = HierarchicalPath{};
 	}
 	
+	UpdateHighlightedPath();
+}
+
+void ALevel_PathfindingAStar::RequestTimeSlicedPath()
+{
+	PathRequests->SetComponents(bRejectUnreachable ? &TerrainGraph->GetComponents() : nullptr);
+
+	PathRequest = PathRequests->RequestPath(PathStartNodeId, PathEndNodeId, 0,
+		[this](std::span<Node* const> Path, bool bIsComplete) { OnTimeSlicedPath(Path, bIsComplete); }, true);
+}
+
+void ALevel_PathfindingAStar::SetRequestHeuristic()
+{
+	if (SelectedHeuristic != 5)
+	{
+		PathRequests->SetHeuristic(HeuristicFunction);
+		return;
+	}
+
+	// The searches run on background tasks while painting rebuilds the table, they get a copy of their own
+	std::shared_ptr<LandmarkTable const> const pLandmarks = std::make_shared<LandmarkTable const>(*Landmarks);
+	PathRequests->SetHeuristic([pLandmarks](int FromId, int ToId) { return pLandmarks->GetLowerBound(FromId, ToId); });
+}
+
+void ALevel_PathfindingAStar::OnTimeSlicedPath(std::span<Node* const> Path, bool bIsComplete)
+{
+	ContinueAgentOnPath(Path);
+
+	if (bIsComplete)
+	{
+		PathRequest = InvalidPathRequest;
+		UE_LOG(LogTemp, Log, TEXT("New path calculated using time sliced %hs, %d nodes"), typeid(AStar).name(),
+			static_cast<int>(Path.size()));
+	}
+}
+
+void ALevel_PathfindingAStar::BeginAnytimePath()
+{
+	AnytimePlanner = SelectedHeuristic == 5
+		? new AStar(TerrainGraph, [this](int FromId, int ToId) { return Landmarks->GetLowerBound(FromId, ToId); })
+		: new AStar(TerrainGraph, HeuristicFunction);
+	AnytimePlanner->SetComponents(bRejectUnreachable ? &TerrainGraph->GetComponents() : nullptr);
+	AnytimePlanner->BeginAnytime(TerrainGraph->GetNodeAs<Node>(PathStartNodeId), TerrainGraph->GetNodeAs<Node>(PathEndNodeId),
+		AnytimeContext, AnytimeStartEpsilon, [this](std::span<Node* const> Path, float Epsilon)
+		{
+			ContinueAgentOnPath(Path);
+			if (IsHeuristicAdmissible())
+			{
+				UE_LOG(LogTemp, Log, TEXT("ARA* path within %.2f of optimal, %d nodes expanded"), Epsilon,
+					AnytimeContext.GetExpandedNodeCount());
+			}
+		});
+	AnytimeTimeSpentMs = 0.0;
+	FoundPath.clear();
+	StepAnytimePath();
+}
+
+void ALevel_PathfindingAStar::StepAnytimePath()
+{
+	if (AnytimePlanner == nullptr || AnytimePlanner->IsDone() || AnytimeTimeSpentMs >= AnytimeBudgetMs) return;
+
+	// The agent keeps the best path so far once the budget of the search is used up
+	double const StartTime = FPlatformTime::Seconds();
+	AnytimePlanner->StepAnytime(FMath::Min(TimeSliceBudgetUs / 1000.0, AnytimeBudgetMs - AnytimeTimeSpentMs));
+	AnytimeTimeSpentMs += (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+	// No pass found the destination, walk as close as the search got
+	if (AnytimePlanner->IsDone() && FoundPath.empty())
+	{
+		ContinueAgentOnPath(AnytimePlanner->GetResult());
+	}
+}
+
+void ALevel_PathfindingAStar::ContinueAgentOnPath(std::span<Node* const> Path)
+{
+	FoundPath.assign(Path.begin(), Path.end());
+
+	// Keeps walking instead of starting over, the new path begins where the old one did
+	std::vector<FVector2D> PathPositions{};
+	PathPositions.reserve(Path.size());
+	for (Node* const pNode : Path)
+	{
+		PathPositions.emplace_back(pNode->GetPosition());
+	}
+	PathFollow.UpdatePath(PathPositions);
+	UpdateHighlightedPath();
+}
+
+bool ALevel_PathfindingAStar::IsHeuristicAdmissible() const
+{
+	// Landmark bounds come from real path costs, the distances only hold while a step costs at least its length
+	if (SelectedHeuristic == 5) return true;
+
+	bool const bCostsCoverDistance = TerrainGraph->GetCardinalCost() >= TerrainGraph->GetCellSize();
+	switch (SelectedHeuristic)
+	{
+	case 0:
+		return bCostsCoverDistance && !TerrainGraph->IsDiagonallyConnected(); // counts a diagonal step as two
+	case 2:
+		return false; // squared distances outgrow any path cost
+	default:
+		return bCostsCoverDistance;
+	}
+}
+
+void ALevel_PathfindingAStar::RefineCoarsePath()
+{
+	// Refine the next segment once the agent is about to run out of points
+	int constexpr LookAheadPoints = 2;
+	if (CoarsePath.IsFullyRefined() || PathFollow.GetRemainingPointCount() > LookAheadPoints) return;
+
+	size_t const NrKnownCells = CoarsePath.Cells.size();
+	Hierarchy->RefineNextSegment(CoarsePath);
+
+	std::vector<FVector2D> NewPositions{};
+	for (size_t Idx = NrKnownCells; Idx < CoarsePath.Cells.size(); ++Idx)
+	{
+		NewPositions.emplace_back(CoarsePath.Cells[Idx]->GetPosition());
+	}
+	PathFollow.AppendPath(NewPositions);
+
+	FoundPath = CoarsePath.Cells;
+	UpdateHighlightedPath();
+}
+
+void ALevel_PathfindingAStar::ReplanFromAgent()
+{
+	// The goal stays the same, so D* Lite repairs its search from wherever the agent is now
+	int const AgentNodeId = TerrainGraph->GetNodeIdAtPosition(Agent->GetPosition());
+	if (AgentNodeId != Graphs::InvalidNodeId)
+	{
+		FIntVector2 const AgentCell = TerrainGraph->GetColAndRow(AgentNodeId);
+		if (TerrainGraph->IsWalkable(AgentCell.X, AgentCell.Y))
+		{
+			IncrementalPlanner->SetStart(AgentNodeId);
+		}
+	}
+
+	auto const Path = IncrementalPlanner->Replan();
+	FoundPath.assign(Path.begin(), Path.end());
+	UpdateAgentPath(FoundPath, false);
+	UpdateHighlightedPath();
+}
+
+void ALevel_PathfindingAStar::UpdateHighlightedPath()
+{
 	// Update the highlighted nodes in the renderer
 	std::vector<std::pair<int, FColor>> PathToHighlight{};
 	PathToHighlight.push_back({PathStartNodeId, FColor::Green});
@@ -143,11 +394,17 @@ void ALevel_PathfindingAStar::CalculatePath()
 			PathToHighlight.push_back({FoundPath[Idx]->GetId(), FColor::Yellow});
 		}
 	}
+
+	// HPA* waypoints that aren't refined yet
+	for (int Idx = CoarsePath.NrRefinedSegments + 1; Idx + 1 < static_cast<int>(CoarsePath.Waypoints.size()); ++Idx)
+	{
+		PathToHighlight.push_back({CoarsePath.Waypoints[Idx], FColor::Orange});
+	}
 	PathToHighlight.push_back({PathEndNodeId, FColor::Red});
 	Renderer->SetHighlightedNodes(PathToHighlight);
 }
 
-void ALevel_PathfindingAStar::UpdateAgentPath(std::vector<Node*> const& Path)
+void ALevel_PathfindingAStar::UpdateAgentPath(std::vector<Node*> const& Path, bool bTeleportAgent)
 {
 	std::vector<FVector2D> pathPositions{};
 	pathPositions.reserve(Path.size());
@@ -157,12 +414,103 @@ void ALevel_PathfindingAStar::UpdateAgentPath(std::vector<Node*> const& Path)
 	}
 
 	PathFollow.SetPath(pathPositions);
-	if (pathPositions.size() > 0)
+	if (bTeleportAgent && pathPositions.size() > 0)
 	{
 		Agent->SetPosition(pathPositions[0]);
 	}
 }
 
+void ALevel_PathfindingAStar::CompareBidirectionalSearches()
+{
+	Node* const startNode = TerrainGraph->GetNodeAs<Node>(PathStartNodeId);
+	Node* const endNode = TerrainGraph->GetNodeAs<Node>(PathEndNodeId);
+
+	AStar(TerrainGraph, HeuristicFunction).FindPath(startNode, endNode, CompareForwardContext);
+	NrExpandedAStar = CompareForwardContext.GetExpandedNodeCount();
+
+	BidirectionalAStar(TerrainGraph, HeuristicFunction).FindPath(startNode, endNode, CompareForwardContext, CompareBackwardContext);
+	NrExpandedBidirectionalAStar = CompareForwardContext.GetExpandedNodeCount() + CompareBackwardContext.GetExpandedNodeCount();
+
+	BFS const UnidirectionalBFS{TerrainGraph};
+	UnidirectionalBFS.FindPath(startNode, endNode);
+	NrExpandedBFS = UnidirectionalBFS.GetExpandedNodeCount();
+
+	BidirectionalBFS BothWaysBFS{TerrainGraph};
+	BothWaysBFS.FindPath(startNode, endNode);
+	NrExpandedBidirectionalBFS = BothWaysBFS.GetExpandedNodeCount();
+}
+
+void ALevel_PathfindingAStar::SpawnCrowd()
+{
+	FlowField const* pField = FlowFields->GetField(PathEndNodeId);
+	if (pField == nullptr) return;
+	CrowdSteering.SetFlowField(pField);
+
+	// Random cells that can reach the goal, one field steers all of them
+	int const NrCells = TerrainGraph->GetRows() * TerrainGraph->GetColumns();
+	for (int Attempt = 0; Attempt < CrowdSize * 10 && CrowdAgents.Num() < CrowdSize; ++Attempt)
+	{
+		int const CellId = FMath::RandRange(0, NrCells - 1);
+		if (CellId == PathEndNodeId || !pField->IsReachable(CellId)) continue;
+
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		FVector2D const SpawnPos = TerrainGraph->GetNodePosition(CellId);
+		ASteeringAgent* const CrowdAgent = GetWorld()->SpawnActor<ASteeringAgent>(SteeringAgentClass,
+			FVector{SpawnPos, 90}, FRotator::ZeroRotator, SpawnParams);
+		if (CrowdAgent)
+		{
+			CrowdAgent->SetDebugRenderingEnabled(false);
+			CrowdAgent->SetSteeringBehavior(&CrowdSteering);
+			CrowdAgents.Add(CrowdAgent);
+		}
+	}
+}
+
+void ALevel_PathfindingAStar::ClearCrowd()
+{
+	for (ASteeringAgent* const CrowdAgent : CrowdAgents)
+	{
+		if (CrowdAgent && CrowdAgent->IsValidLowLevel())
+		{
+			CrowdAgent->Destroy();
+		}
+	}
+	CrowdAgents.Empty();
+	CrowdSteering.SetFlowField(nullptr);
+}
+
+void ALevel_PathfindingAStar::UpdateCrowdFlowField()
+{
+	// Only while there is a crowd, moving the goal back and forth hits the cache
+	CrowdSteering.SetFlowField(CrowdAgents.Num() > 0 ? FlowFields->GetField(PathEndNodeId) : nullptr);
+}
+
+void ALevel_PathfindingAStar::GoToNearestCrowdAgent()
+{
+	std::vector<int> GoalIds{};
+	GoalIds.reserve(CrowdAgents.Num());
+	for (ASteeringAgent* const CrowdAgent : CrowdAgents)
+	{
+		int const CellId = TerrainGraph->GetNodeIdAtPosition(CrowdAgent->GetPosition());
+		if (CellId != Graphs::InvalidNodeId && CellId != PathStartNodeId)
+		{
+			GoalIds.push_back(CellId);
+		}
+	}
+
+	double const StartTime = FPlatformTime::Seconds();
+	Dijkstra::NearestGoal const Nearest = Dijkstra{TerrainGraph}.FindNearestGoal(TerrainGraph->GetNodeAs<Node>(PathStartNodeId),
+		GoalIds, NearestGoalContext);
+	NearestGoalTimeMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+	NrExpandedNearestGoal = NearestGoalContext.GetExpandedNodeCount();
+	if (Nearest.GoalId == Graphs::InvalidNodeId) return;
+
+	PathEndNodeId = Nearest.GoalId;
+	CalculatePath();
+	UpdateCrowdFlowField();
+}
+
 void ALevel_PathfindingAStar::UpdateImGui()
 {
 	#pragma region UI
@@ -189,6 +537,56 @@ void ALevel_PathfindingAStar::UpdateImGui()
 		ImGui::Indent();
 		ImGui::Text("%.3f ms/frame", 1000.0f / ImGui::GetIO().Framerate);
 		ImGui::Text("%.1f FPS", ImGui::GetIO().Framerate);
+		ImGui::Text("%d/%d searches allocated", SearchContext.GetAllocationCount(), SearchContext.GetQueryCount());
+		ImGui::Text("%d nodes expanded", SelectedPathfinder == 3
+			? IncrementalPlanner->GetExpandedNodeCount() : SearchContext.GetExpandedNodeCount());
+		ImGui::Text("JPS+ build %.2f ms, %.1f B/cell", JumpTable->GetBuildTimeMs(), JumpTable->GetBytesPerCell());
+		ImGui::Text("JPS+ last update %.3f ms", JumpTable->GetLastUpdateTimeMs());
+		ImGui::Text("HPA* %d entrances in %d clusters", Hierarchy->GetAbstractGraph().GetNodeCount(), Hierarchy->GetClusterCount());
+		ImGui::Text("HPA* last rebuild %.3f ms (%d clusters)", Hierarchy->GetLastRebuildTimeMs(), Hierarchy->GetLastRebuiltClusterCount());
+		ImGui::Text("ALT %d landmarks, %.2f ms, %.0f B/node", static_cast<int>(Landmarks->GetLandmarks().size()),
+			Landmarks->GetBuildTimeMs(), Landmarks->GetBytesPerNode());
+		ImGui::Text("%d components, last repair %.3f ms (%d nodes)", TerrainGraph->GetComponents().GetComponentCount(),
+			TerrainGraph->GetComponents().GetLastUpdateTimeMs(), TerrainGraph->GetComponents().GetLastVisitedCount());
+		float const NrCells = static_cast<float>(TerrainGraph->GetNodes().size());
+		ImGui::Text("Cell layer %.1f B/cell, graph %.0f B/cell%s", TerrainGraph->GetCellLayerBytes() / NrCells,
+			TerrainGraph->GetAllocatedBytes(sizeof(TerrainNode)) / NrCells, TerrainGraph->IsCellLayerInSync() ? "" : " (out of sync)");
+		if (bCompareBidirectional)
+		{
+			ImGui::Text("A* %d vs bidirectional %d expanded", NrExpandedAStar, NrExpandedBidirectionalAStar);
+			ImGui::Text("BFS %d vs bidirectional %d expanded", NrExpandedBFS, NrExpandedBidirectionalBFS);
+		}
+		if (AnytimePlanner != nullptr)
+		{
+			// An inadmissible heuristic proves nothing, only the inflation of the pass is known then
+			bool const bHasBound = IsHeuristicAdmissible();
+			if (bHasBound)
+			{
+				ImGui::Text("ARA* epsilon %.2f (pass %.2f), %d expanded", AnytimePlanner->GetEpsilon(), AnytimePlanner->GetInflation(),
+					AnytimeContext.GetExpandedNodeCount());
+			}
+			else
+			{
+				ImGui::Text("ARA* pass %.2f, %d expanded (no bound, inadmissible heuristic)", AnytimePlanner->GetInflation(),
+					AnytimeContext.GetExpandedNodeCount());
+			}
+			ImGui::Text("ARA* %.1f/%d ms%s", AnytimeTimeSpentMs, AnytimeBudgetMs,
+				!AnytimePlanner->IsDone() ? "" : !AnytimePlanner->HasFoundDestination() ? ", no path" : bHasBound ? ", optimal" : ", done");
+		}
+		if (bTimeSliced)
+		{
+			ImGui::Text("Path requests %.0f us/frame, last search %.0f us on its task", PathRequests->GetLastUpdateTimeUs(),
+				PathRequests->GetLastSearchTimeUs());
+			ImGui::Text("%d running, %d waiting, %d merged, %d stale", PathRequests->GetRunningCount(), PathRequests->GetWaitingCount(),
+				PathRequests->GetMergedCount(), PathRequests->GetStaleCount());
+		}
+		ImGui::Text("Path cache %.0f%% hits (%d/%d), %d paths, %.1f/%.0f KB", PathResults.GetHitRate() * 100.f, PathResults.GetHitCount(),
+			PathResults.GetHitCount() + PathResults.GetMissCount(), PathResults.GetPathCount(),
+			PathResults.GetAllocatedBytes() / 1024.f, PathResults.GetMemoryBudget() / 1024.f);
+		ImGui::Text("%d flow fields, %.1f/%.0f KB", FlowFields->GetFieldCount(),
+			FlowFields->GetAllocatedBytes() / 1024.f, FlowFields->GetMemoryBudget() / 1024.f);
+		ImGui::Text("%d hits, %d misses, %d evicted", FlowFields->GetHitCount(), FlowFields->GetMissCount(),
+			FlowFields->GetEvictionCount());
 		ImGui::Unindent();
 
 		/*Spacing*/ImGui::Spacing(); ImGui::Separator(); ImGui::Spacing(); ImGui::Spacing();
@@ -200,7 +598,48 @@ void ALevel_PathfindingAStar::UpdateImGui()
 		ImGui::Checkbox("NodeNumbers", &bDrawNodeNumbers);
 		ImGui::Checkbox("Connections", &bDrawConnections);
 		ImGui::Checkbox("Connections Costs", &bDrawConnectionsCosts);
-		if (ImGui::Combo("", &SelectedHeuristic, "Manhattan\0Euclidean\0SqEuclidean\0Octile\0Chebyshev", 4))
+		if (ImGui::Combo("Pathfinder", &SelectedPathfinder, "A*\0Jump Point Search\0HPA*\0D* Lite", 4))
+		{
+			CalculatePath();
+		}
+		if (SelectedPathfinder == 1 && !JumpPointSearch{TerrainGraph}.CanUseJumpPoints())
+		{
+			ImGui::TextDisabled("(A* fallback: 4-connected or mud)");
+		}
+		if (SelectedPathfinder == 1 && ImGui::Checkbox("Precomputed jumps (JPS+)", &bUseJumpPointTable))
+		{
+			CalculatePath();
+		}
+		if (SelectedPathfinder == 0 && !bAnytime && ImGui::Checkbox("Background requests", &bTimeSliced))
+		{
+			CalculatePath();
+		}
+		if (SelectedPathfinder == 0 && !bTimeSliced && ImGui::Checkbox("Anytime (ARA*)", &bAnytime))
+		{
+			CalculatePath();
+		}
+		if (SelectedPathfinder == 0 && bAnytime)
+		{
+			ImGui::SliderFloat("Start epsilon", &AnytimeStartEpsilon, 1.f, 5.f);
+			ImGui::SliderInt("ARA* budget (ms)", &AnytimeBudgetMs, 1, 500);
+		}
+		if (SelectedPathfinder == 0 && bAnytime)
+		{
+			ImGui::SliderInt("Budget (us/frame)", &TimeSliceBudgetUs, 50, 5000);
+		}
+		if (SelectedPathfinder == 0 && !bTimeSliced && !bAnytime)
+		{
+			ImGui::Checkbox("Path cache", &bUsePathCache);
+		}
+		if (SelectedPathfinder == 0 && ImGui::Checkbox("Reject unreachable goals", &bRejectUnreachable))
+		{
+			CalculatePath();
+		}
+		if (ImGui::Checkbox("Compare bidirectional", &bCompareBidirectional) && bCompareBidirectional)
+		{
+			CompareBidirectionalSearches();
+		}
+		if (ImGui::Combo("", &SelectedHeuristic, "Manhattan\0Euclidean\0SqEuclidean\0Octile\0Chebyshev\0Landmarks (ALT)", 4))
 		{
 			switch (SelectedHeuristic)
 			{
@@ -214,6 +653,7 @@ void ALevel_PathfindingAStar::UpdateImGui()
 				HeuristicFunction = HeuristicFunctions::SqEuclidean;
 				break;
 			case 3:
+			case 5: // the other pathfinders don't take node heuristics, they use Octile with ALT
 				HeuristicFunction = HeuristicFunctions::Octile;
 				break;
 			default:
@@ -221,6 +661,31 @@ void ALevel_PathfindingAStar::UpdateImGui()
 				HeuristicFunction = HeuristicFunctions::Chebyshev;
 				break;
 			}
+			Hierarchy->SetHeuristic(HeuristicFunction);
+			IncrementalPlanner->SetHeuristic(HeuristicFunction);
+			SetRequestHeuristic();
+			PathResults.Invalidate(); // inadmissible heuristics find other paths
+		}
+		ImGui::Spacing();
+
+		ImGui::Text("Flow field crowd (%d agents)", CrowdAgents.Num());
+		ImGui::SliderInt("Crowd size", &CrowdSize, 1, 500);
+		if (ImGui::Button("Spawn crowd"))
+		{
+			SpawnCrowd();
+		}
+		ImGui::SameLine();
+		if (ImGui::Button("Clear crowd"))
+		{
+			ClearCrowd();
+		}
+		if (CrowdAgents.Num() > 0 && ImGui::Button("Go to nearest agent"))
+		{
+			GoToNearestCrowdAgent();
+		}
+		if (NrExpandedNearestGoal > 0)
+		{
+			ImGui::Text("Nearest of crowd %.3f ms, %d expanded", NearestGoalTimeMs, NrExpandedNearestGoal);
 		}
 		ImGui::Spacing();
 
@@ -247,12 +712,45 @@ void ALevel_PathfindingAStar::SetEndNodeId()
 	{
 		PathEndNodeId = NewEnd;
 		CalculatePath();
+		UpdateCrowdFlowField();
 	}
 }
 
 void ALevel_PathfindingAStar::SetNodeTerrain(TerrainNode::Type TerrainType)
 {
 	TerrainGraph->PaintNodeAtPosition(FVector2D{LatestMouseWorldPos}, TerrainType);
+	int const PaintedNodeId = TerrainGraph->GetNodeIdAtPosition(FVector2D{LatestMouseWorldPos});
+	JumpTable->UpdateNode(PaintedNodeId);
+	Hierarchy->UpdateNode(PaintedNodeId);
+	FlowFields->Invalidate();
+	Landmarks->Rebuild(); // the bounds only hold for the old costs
+	if (SelectedHeuristic == 5)
+	{
+		SetRequestHeuristic(); // the requests search again on their own, the graph version changed
+	}
+	UpdateCrowdFlowField();
+
+	// Painting changes the connections of the node and of its neighbours
+	if (PaintedNodeId != Graphs::InvalidNodeId)
+	{
+		FIntVector2 const PaintedCell = TerrainGraph->GetColAndRow(PaintedNodeId);
+		for (int Row = PaintedCell.Y - 1; Row <= PaintedCell.Y + 1; ++Row)
+		{
+			for (int Col = PaintedCell.X - 1; Col <= PaintedCell.X + 1; ++Col)
+			{
+				if (TerrainGraph->IsWithinBounds(Col, Row))
+				{
+					IncrementalPlanner->UpdateNode(TerrainGraph->GetNodeId(Col, Row));
+				}
+			}
+		}
+	}
+
+	if (SelectedPathfinder == 3 && IncrementalPlanner->IsInitialized())
+	{
+		ReplanFromAgent();
+		return;
+	}
 	CalculatePath(); // since connections may change
 }
 
@@ -3,7 +3,17 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "GraphTheory/Algorithms/AStar.h"
+#include "GraphTheory/Algorithms/DStarLite.h"
+#include "GraphTheory/Algorithms/FlowField.h"
 #include "GraphTheory/Algorithms/Heuristics.h"
+#include "GraphTheory/Algorithms/HPAStar.h"
+#include "GraphTheory/Algorithms/JumpPointTable.h"
+#include "GraphTheory/Algorithms/LandmarkTable.h"
+#include "GraphTheory/Algorithms/PathCache.h"
+#include "GraphTheory/Algorithms/PathRequestService.h"
+#include "GraphTheory/Algorithms/PathSearchContext.h"
+#include "Movement/SteeringBehaviors/FlowFieldFollow/FlowFieldFollowSteeringBehavior.h"
 #include "Movement/SteeringBehaviors/PathFollow/PathFollowSteeringBehavior.h"
 #include "Shared/Level_Base.h"
 #include "Shared/Graph/GraphRenderer.h"
@@ -49,23 +59,84 @@ private:
 	ASteeringAgent* Agent{nullptr}; // ref
 	PathFollow PathFollow{};
 	
+	UPROPERTY()
+	TArray<ASteeringAgent*> CrowdAgents{}; // refs, all share CrowdSteering
+	FlowFieldFollow CrowdSteering{};
+	
 	GameAI::TerrainGridGraph* TerrainGraph{nullptr};
 	GameAI::GraphRenderer* Renderer{nullptr};
 	GameAI::TerrainNodeFactory* NodeFactory{nullptr};
+	GameAI::JumpPointTable* JumpTable{nullptr};
+	GameAI::HPAStar* Hierarchy{nullptr};
+	GameAI::DStarLite* IncrementalPlanner{nullptr};
+	GameAI::FlowFieldCache* FlowFields{nullptr};
+	GameAI::LandmarkTable* Landmarks{nullptr};
+	GameAI::PathRequestService* PathRequests{nullptr};
 	
 	int PathStartNodeId{44};
 	int PathEndNodeId{88};
-	int SelectedHeuristic = 4;
+	int SelectedHeuristic = 4; // 5 is ALT, only A* uses it
 	GameAI::HeuristicFunctions::Heuristic HeuristicFunction = GameAI::HeuristicFunctions::Chebyshev;
+	GameAI::PathSearchContext SearchContext{};
+	GameAI::PathCache PathResults{64 * 1024}; // A* paths per start and end cell
+	bool bUsePathCache = true;
+	bool bRejectUnreachable = true; // goals in another component than the start, see AStar::SetComponents
 	std::vector<GameAI::Node*> FoundPath{};
+	GameAI::HierarchicalPath CoarsePath{}; // HPA*, refined while the agent follows it
+	
+	// A* through the request service, the search runs on a background task and the agent follows the best path so far
+	bool bTimeSliced = false;
+	int TimeSliceBudgetUs = 1000; // per frame, for ARA*
+	GameAI::PathRequestHandle PathRequest{GameAI::InvalidPathRequest};
+	
+	// ARA*, a path within epsilon times the optimal cost right away, improved every frame until optimal or out of time
+	bool bAnytime = false;
+	float AnytimeStartEpsilon = 3.f;
+	int AnytimeBudgetMs = 50; // per search, spread over frames with TimeSliceBudgetUs each
+	GameAI::AStar* AnytimePlanner{nullptr}; // keeps its search between frames
+	GameAI::PathSearchContext AnytimeContext{};
+	double AnytimeTimeSpentMs{0.0};
+	
+	// Uni- vs bidirectional comparison, separate contexts so the stats of the selected pathfinder stay intact
+	bool bCompareBidirectional = false;
+	GameAI::PathSearchContext CompareForwardContext{};
+	GameAI::PathSearchContext CompareBackwardContext{};
+	int NrExpandedAStar{0};
+	int NrExpandedBidirectionalAStar{0};
+	int NrExpandedBFS{0};
+	int NrExpandedBidirectionalBFS{0};
 	
 	bool bDrawGrid = true;
 	bool bDrawNodeNumbers = false;
 	bool bDrawConnections = false;
 	bool bDrawConnectionsCosts = false;
+	int SelectedPathfinder = 0; // A*, Jump Point Search, HPA*, D* Lite
+	bool bUseJumpPointTable = true; // JPS+
+	int CrowdSize = 50;
+	
+	// Nearest crowd agent by path, one multi goal Dijkstra instead of a path per agent
+	GameAI::PathSearchContext NearestGoalContext{};
+	double NearestGoalTimeMs{0.0};
+	int NrExpandedNearestGoal{0};
 
 	void CalculatePath();
-	void UpdateAgentPath(std::vector<GameAI::Node*> const & Path);
+	void RequestTimeSlicedPath();
+	void OnTimeSlicedPath(std::span<GameAI::Node* const> Path, bool bIsComplete);
+	void SetRequestHeuristic();
+	void BeginAnytimePath();
+	void StepAnytimePath();
+	void ContinueAgentOnPath(std::span<GameAI::Node* const> Path);
+	bool IsHeuristicAdmissible() const; // only then the ARA* bounds hold
+	void RefineCoarsePath();
+	void ReplanFromAgent();
+	void UpdateHighlightedPath();
+	void UpdateAgentPath(std::vector<GameAI::Node*> const & Path, bool bTeleportAgent = true);
+	void CompareBidirectionalSearches();
+	
+	void SpawnCrowd();
+	void ClearCrowd();
+	void UpdateCrowdFlowField();
+	void GoToNearestCrowdAgent();
 	
 	void UpdateImGui();
 	
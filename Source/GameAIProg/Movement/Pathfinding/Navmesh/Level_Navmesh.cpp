@@ -7,9 +7,12 @@
 #include "AI/NavigationSystemBase.h"
 #include "GraphTheory/Algorithms/AStar.h"
 #include "GraphTheory/Algorithms/NavGraphPathfinding.h"
+#include "Misc/Crc.h"
+#include "Misc/Paths.h"
 #include "NavMesh/RecastNavMesh.h"
 #include "Runtime/Navmesh/Public/Detour/DetourNavMesh.h"
 #include "Shared/GameAISpectator.h"
+#include "Shared/Graph/NavGraph/NavMeshCache.h"
 
 // Helper
 FORCEINLINE FVector RecastToUnreal(const double* RecastVertex)
@@ -45,13 +48,30 @@ void ALevel_Navmesh::BeginPlay()
 	Agent->SetDebugRenderingEnabled(false);
 	Agent->SetSteeringBehavior(&PathFollow);
 	
-	auto NavPoly{std::make_unique<TriPolygon>()};
-	for (TArray<FVector> const & Tri : ExtractNavMeshTris())
+	// Load the navmesh from the cache when it was made from the same Recast data, rebuild and cache it otherwise
+	double const BuildStartTime = FPlatformTime::Seconds();
+	NavMeshHash = HashNavMeshTiles();
+	FString const CachePath = FPaths::ProjectSavedDir() / TEXT("NavMeshCache") / (GetWorld()->GetMapName() + TEXT(".navcache"));
+	NavigationGraph = GameAI::NavMeshCache::Load(CachePath, NavMeshHash);
+	bNavMeshFromCache = NavigationGraph != nullptr;
+	if (!bNavMeshFromCache)
 	{
-		NavPoly->AddTriangle(Tri);
+		auto NavPoly{std::make_unique<TriPolygon>()};
+		NavPoly->BuildFromTriangles(ExtractNavMeshTris());
+		NavigationGraph = std::make_unique<GameAI::NavGraph>(std::move(NavPoly));
 	}
+	NavMeshBuildTimeMs = (FPlatformTime::Seconds() - BuildStartTime) * 1000.0;
+	UE_LOG(LogTemp, Log, TEXT("Navmesh: %d triangles, %d portal nodes %s in %.2f ms"),
+		static_cast<int>(NavigationGraph->GetNavPolygon()->GetTriangles().size()), NavigationGraph->GetNodeCount(),
+		bNavMeshFromCache ? TEXT("loaded") : TEXT("built"), NavMeshBuildTimeMs);
 	
-	NavigationGraph = std::make_unique<GameAI::NavGraph>(std::move(NavPoly));
+	if (!bNavMeshFromCache)
+	{
+		GameAI::NavMeshCache::Save(CachePath, NavMeshHash, *NavigationGraph);
+	}
+	
+	Hierarchy = std::make_unique<GameAI::ContractionHierarchy>(NavigationGraph.get()); // the navmesh is static from here on
+	PathRequests = std::make_unique<GameAI::PathRequestService>(NavigationGraph.get(), bUseContractionHierarchy ? Hierarchy.get() : nullptr);
 	Renderer = std::make_unique<GameAI::GraphRenderer>(GetWorld());
 	Renderer->SetRenderOptions(GameAI::GraphRenderOptions{
 		true, 
@@ -67,9 +87,30 @@ void ALevel_Navmesh::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
 	
+	PathRequests->Update();
+	
+	if (bUseTiledNavMesh)
+	{
+		FVector2D const AgentPosition{Agent->GetPosition()};
+		TiledGraph->UpdateStreaming(std::span<FVector2D const>{&AgentPosition, 1});
+		
+		// The goal may have come within reach
+		if (bPathIsPartial && TiledGraph->GetVersion() != PathTileVersion)
+		{
+			CalculatePath();
+		}
+	}
+	
 	if (bDrawNavPoly)
 	{
-		NavigationGraph->GetNavPolygon()->DrawDebug(GetWorld(), FColor::Yellow);
+		if (bUseTiledNavMesh)
+		{
+			TiledGraph->DrawDebug(GetWorld(), FColor::Yellow);
+		}
+		else
+		{
+			NavigationGraph->GetNavPolygon()->DrawDebug(GetWorld(), FColor::Yellow);
+		}
 	}
 	
 	if (bDrawNavPolyVertices)
@@ -82,7 +123,14 @@ void ALevel_Navmesh::Tick(float DeltaTime)
 	
 	if (bDrawNavGraph)
 	{
-		Renderer->RenderGraph(*NavigationGraph.get());
+		if (bUseTiledNavMesh)
+		{
+			Renderer->RenderGraph(*TiledGraph);
+		}
+		else
+		{
+			Renderer->RenderGraph(*NavigationGraph.get());
+		}
 	}
 	
 	if (bDrawPath)
@@ -147,6 +195,19 @@ void ALevel_Navmesh::UpdateImGui()
 		ImGui::Indent();
 		ImGui::Text("%.3f ms/frame", 1000.0f / ImGui::GetIO().Framerate);
 		ImGui::Text("%.1f FPS", ImGui::GetIO().Framerate);
+		ImGui::Text("Navmesh %s in %.2f ms", bNavMeshFromCache ? "loaded" : "built", NavMeshBuildTimeMs);
+		if (bUseRequestService && !bUseTiledNavMesh)
+		{
+			ImGui::Text("Last request %.1f us on its task, delivered after %.1f us", PathRequests->GetLastSearchTimeUs(), LastQueryTimeUs);
+		}
+		else
+		{
+			ImGui::Text("Last query %.1f us", LastQueryTimeUs);
+		}
+		ImGui::Text("CH %d shortcuts, built in %.2f ms", Hierarchy->GetShortcutCount(), Hierarchy->GetBuildTimeMs());
+		ImGui::Text("Path cache %.0f%% hits (%d/%d), %d paths, %.1f/%.0f KB", PathResults.GetHitRate() * 100.f, PathResults.GetHitCount(),
+			PathResults.GetHitCount() + PathResults.GetMissCount(), PathResults.GetPathCount(),
+			PathResults.GetAllocatedBytes() / 1024.f, PathResults.GetMemoryBudget() / 1024.f);
 		ImGui::Unindent();
 
 		/*Spacing*/ImGui::Spacing(); ImGui::Separator(); ImGui::Spacing(); ImGui::Spacing();
@@ -159,6 +220,45 @@ void ALevel_Navmesh::UpdateImGui()
 		ImGui::Checkbox("NavGraph", &bDrawNavGraph);
 		ImGui::Checkbox("Path", &bDrawPath);
 		ImGui::Checkbox("Portals", &bDrawPortals);
+		if (ImGui::Checkbox("Contraction Hierarchy", &bUseContractionHierarchy))
+		{
+			PathResults.Invalidate(); // to compare the searches, not the cache
+			PathRequests->SetHierarchy(bUseContractionHierarchy ? Hierarchy.get() : nullptr);
+		}
+		ImGui::Checkbox("Background Requests", &bUseRequestService);
+		if (!bUseRequestService)
+		{
+			ImGui::Checkbox("Path Cache", &bUsePathCache);
+		}
+		if (ImGui::Checkbox("Tiled Streaming", &bUseTiledNavMesh))
+		{
+			if (!TiledGraph)
+			{
+				CreateTiledNavMesh();
+			}
+			else if (!bUseTiledNavMesh)
+			{
+				TiledGraph->UnloadAllTiles();
+			}
+			bPathIsPartial = false;
+		}
+		if (bUseTiledNavMesh)
+		{
+			ImGui::Indent();
+			if (ImGui::SliderInt("Budget (KB)", &TileStreamingBudgetKB, 64, 8192))
+			{
+				TiledGraph->SetMemoryBudget(static_cast<size_t>(TileStreamingBudgetKB) * 1024);
+			}
+			ImGui::Text("%d/%d tiles resident, %.0f KB", TiledGraph->GetResidentTileCount(), BakedTiles.Num(), TiledGraph->GetAllocatedBytes() / 1024.f);
+			ImGui::Text("%d stitched portals", TiledGraph->GetStitchedPortalCount());
+			ImGui::Text("%d loads, %d evictions, last %.2f ms", TiledGraph->GetLoadCount(), TiledGraph->GetEvictionCount(), TiledGraph->GetLastLoadTimeMs());
+			ImGui::Text("Tiles baked in %.2f ms", TileBakeTimeMs);
+			if (bPathIsPartial)
+			{
+				ImGui::Text("Partial path, goal not loaded");
+			}
+			ImGui::Unindent();
+		}
 		
 		//End
 		ImGui::End();
@@ -223,20 +323,140 @@ TArray<TArray<FVector>> ALevel_Navmesh::ExtractNavMeshTris() const
 	return Polys;
 }
 
+uint32 ALevel_Navmesh::HashNavMeshTiles() const
+{
+	uint32 Hash{0};
+	
+	ANavigationData* NavData = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld())->GetDefaultNavDataInstance();
+	if (dtNavMesh const * NavMesh = Cast<ARecastNavMesh>(NavData)->GetRecastMesh())
+	{
+		for (int TileIdx{0}; TileIdx < NavMesh->getMaxTiles(); ++TileIdx)
+		{
+			// Same tiles as ExtractNavMeshTris, the whole tile blob covers the polys and detail meshes
+			dtMeshTile const * Tile{NavMesh->getTile(TileIdx)};
+			if (!Tile || !Tile->header || !Tile->polys) continue;
+			
+			Hash = FCrc::MemCrc32(&TileIdx, sizeof(TileIdx), Hash);
+			Hash = FCrc::MemCrc32(Tile->data, Tile->dataSize, Hash);
+		}
+	}
+	
+	return Hash;
+}
+
+void ALevel_Navmesh::CreateTiledNavMesh()
+{
+	double const StartTime = FPlatformTime::Seconds();
+	TiledGraph = std::make_unique<GameAI::TiledNavGraph>(NavTileSize,
+		[this](FIntPoint const& Tile) -> std::unique_ptr<GameAI::NavGraph>
+		{
+			return BakedTiles.Contains(Tile) ? GameAI::NavMeshCache::Load(GetTileCachePath(Tile), GetTileHash(Tile)) : nullptr;
+		},
+		static_cast<size_t>(TileStreamingBudgetKB) * 1024);
+	
+	// Every triangle goes to the tile its center is in
+	TriPolygon const* NavPoly = NavigationGraph->GetNavPolygon();
+	TMap<FIntPoint, TArray<TArray<FVector>>> TrianglesPerTile{};
+	for (TriPolygon::Triangle const& Triangle : NavPoly->GetTriangles())
+	{
+		std::array<FVector, 3> const Vertices = Triangle.GetVertices(*NavPoly);
+		FVector const Center = (Vertices[0] + Vertices[1] + Vertices[2]) / 3.0;
+		TrianglesPerTile.FindOrAdd(TiledGraph->GetTileCoord(FVector2D{Center})).Add(TArray<FVector>{Vertices[0], Vertices[1], Vertices[2]});
+	}
+	
+	// In a world that doesn't fit in memory this happens offline, here the whole navmesh is loaded anyway
+	BakedTiles.Empty();
+	for (auto const& [Tile, Triangles] : TrianglesPerTile)
+	{
+		auto TilePoly{std::make_unique<TriPolygon>()};
+		TilePoly->BuildFromTriangles(Triangles);
+		GameAI::NavGraph const TileGraph{std::move(TilePoly)};
+		
+		if (GameAI::NavMeshCache::Save(GetTileCachePath(Tile), GetTileHash(Tile), TileGraph))
+		{
+			BakedTiles.Add(Tile);
+		}
+	}
+	
+	TileBakeTimeMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+	UE_LOG(LogTemp, Log, TEXT("Navmesh: %d tiles baked in %.2f ms"), BakedTiles.Num(), TileBakeTimeMs);
+}
+
+FString ALevel_Navmesh::GetTileCachePath(FIntPoint const& Tile) const
+{
+	return FPaths::ProjectSavedDir() / TEXT("NavMeshCache") / GetWorld()->GetMapName()
+		/ FString::Printf(TEXT("Tile_%d_%d.navcache"), Tile.X, Tile.Y);
+}
+
+uint32 ALevel_Navmesh::GetTileHash(FIntPoint const& Tile) const
+{
+	// A tile file is only valid for the same navmesh, tile size and coordinates
+	uint32 Hash = FCrc::MemCrc32(&NavTileSize, sizeof(NavTileSize), NavMeshHash);
+	return FCrc::MemCrc32(&Tile, sizeof(Tile), Hash);
+}
+
 void ALevel_Navmesh::SetTarget()
 {
+	PathTarget = FVector2D{LatestMouseWorldPos};
+	CalculatePath();
+}
+
+void ALevel_Navmesh::CalculatePath()
+{
+	// The path that is still being searched leads to the old target
+	PathRequests->CancelRequest(PathRequest);
+	PathRequest = GameAI::InvalidPathRequest;
+	
+	// The streamed graph changes while tiles load, its queries stay on the game thread
+	if (bUseRequestService && !bUseTiledNavMesh)
+	{
+		RequestPath();
+		return;
+	}
+	
 	GameAI::NavMeshPathfinding Pathfinder{};
 	
 	std::vector<FVector2D> tempNodePositions;
 	std::vector<GameAI::NavLine> tempPortals;
 	
-	std::vector<FVector2D> Path = Pathfinder.FindPath(
-		Agent->GetPosition(), 
-		FVector2D{LatestMouseWorldPos}, 
-		NavigationGraph.get(),
-		tempNodePositions,
-		tempPortals
-	);
+	double const StartTime = FPlatformTime::Seconds();
+	std::vector<FVector2D> Path{};
+	if (bUseTiledNavMesh)
+	{
+		Path = Pathfinder.FindPath(
+			Agent->GetPosition(),
+			PathTarget,
+			TiledGraph.get(),
+			SearchContext,
+			bPathIsPartial,
+			tempNodePositions,
+			tempPortals);
+		PathTileVersion = TiledGraph->GetVersion();
+	}
+	else
+	{
+		Path = bUseContractionHierarchy
+			? Pathfinder.FindPath(
+				Agent->GetPosition(),
+				PathTarget,
+				NavigationGraph.get(),
+				*Hierarchy,
+				SearchContext,
+				BackwardSearchContext,
+				tempNodePositions,
+				tempPortals,
+				bUsePathCache ? &PathResults : nullptr)
+			: Pathfinder.FindPath(
+				Agent->GetPosition(), 
+				PathTarget, 
+				NavigationGraph.get(),
+				SearchContext,
+				tempNodePositions,
+				tempPortals,
+				bUsePathCache ? &PathResults : nullptr
+			);
+	}
+	LastQueryTimeUs = (FPlatformTime::Seconds() - StartTime) * 1000000.0;
 	
 	DebugDrawPath = Path;
 	DebugDrawPortals = tempPortals;
@@ -248,3 +468,23 @@ void ALevel_Navmesh::SetTarget()
 		Agent->SetPosition(Path[0]);
 	}
 }
+
+void ALevel_Navmesh::RequestPath()
+{
+	double const RequestTime = FPlatformTime::Seconds();
+	PathRequest = PathRequests->RequestPath(Agent->GetPosition(), PathTarget, 0, [this, RequestTime](std::span<FVector2D const> Path)
+	{
+		PathRequest = GameAI::InvalidPathRequest;
+		LastQueryTimeUs = (FPlatformTime::Seconds() - RequestTime) * 1000000.0;
+		
+		DebugDrawPath.assign(Path.begin(), Path.end());
+		DebugDrawPortals.clear();
+		DebugDrawNodePositions.clear();
+		
+		PathFollow.SetPath(DebugDrawPath);
+		if (Path.size() > 0)
+		{
+			Agent->SetPosition(Path[0]);
+		}
+	});
+}
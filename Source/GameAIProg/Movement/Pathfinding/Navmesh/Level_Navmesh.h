@@ -4,8 +4,13 @@
 
 #include "CoreMinimal.h"
 #include "GraphTheory/Level_GraphTheory.h"
+#include "GraphTheory/Algorithms/ContractionHierarchy.h"
 #include "GraphTheory/Algorithms/NavGraphPathfinding.h"
+#include "GraphTheory/Algorithms/PathCache.h"
+#include "GraphTheory/Algorithms/PathRequestService.h"
+#include "GraphTheory/Algorithms/PathSearchContext.h"
 #include "Shared/Graph/NavGraph/NavGraph.h"
+#include "Shared/Graph/NavGraph/TiledNavGraph.h"
 #include "Level_Navmesh.generated.h"
 
 UCLASS()
@@ -17,6 +22,13 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="NavmeshLevel|Input")
 	UInputAction* SetTargetAction{};
 	
+	// Tiled streaming: the navmesh is split in tiles of this size that stream in around the agent
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="NavmeshLevel|Streaming")
+	float NavTileSize{1000.f};
+	
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="NavmeshLevel|Streaming")
+	int TileStreamingBudgetKB{1024};
+	
 	// Sets default values for this actor's properties
 	ALevel_Navmesh();
 
@@ -32,6 +44,23 @@ protected:
 private:
 	std::unique_ptr<GameAI::NavGraph> NavigationGraph;
 	std::unique_ptr<GameAI::GraphRenderer> Renderer;
+	GameAI::PathSearchContext SearchContext{};
+	std::unique_ptr<GameAI::ContractionHierarchy> Hierarchy;
+	GameAI::PathSearchContext BackwardSearchContext{}; // second half of the hierarchy's bidirectional search
+	GameAI::PathCache PathResults{64 * 1024}; // portal paths per start and end triangle
+	std::unique_ptr<GameAI::PathRequestService> PathRequests; // searches the static navmesh on background tasks
+	GameAI::PathRequestHandle PathRequest{GameAI::InvalidPathRequest};
+	double LastQueryTimeUs{0.0}; // until the path was delivered for a background request
+	double NavMeshBuildTimeMs{0.0}; // polygon and NavGraph
+	bool bNavMeshFromCache{false};
+	uint32 NavMeshHash{0};
+	
+	std::unique_ptr<GameAI::TiledNavGraph> TiledGraph; // made when tiled streaming is first switched on
+	TSet<FIntPoint> BakedTiles{}; // tiles with navmesh, only these have a cache file
+	double TileBakeTimeMs{0.0};
+	FVector2D PathTarget{};
+	bool bPathIsPartial{false};
+	uint32 PathTileVersion{0}; // of TiledGraph when the path was planned, a partial path is replanned once tiles change
 	
 	std::vector<GameAI::NavLine> DebugDrawPortals{};
 	std::vector<FVector2D> DebugDrawNodePositions{};
@@ -46,10 +75,22 @@ private:
 	bool bDrawNavGraph{true};
 	bool bDrawPath{true};
 	bool bDrawPortals{false};
+	bool bUseContractionHierarchy{true};
+	bool bUsePathCache{true};
+	bool bUseTiledNavMesh{false};
+	bool bUseRequestService{true}; // only the queries on the game thread use the cache and show their portals
 	
+	void CalculatePath();
+	void RequestPath();
 	void UpdateImGui();
 	
 	TArray<TArray<FVector>> ExtractNavMeshTris() const;
+	uint32 HashNavMeshTiles() const; // of the Recast tile data, to tell whether the navmesh cache is stale
+	
+	// Splits the navmesh in tiles and writes each one to its own cache file, the TiledGraph streams them back in
+	void CreateTiledNavMesh();
+	FString GetTileCachePath(FIntPoint const& Tile) const;
+	uint32 GetTileHash(FIntPoint const& Tile) const;
 	
 	// Input functions
 	void SetTarget();
@@ -1,5 +1,6 @@
 ﻿#include "TriPolygon.h"
 
+#include <limits>
 #include "Shared/Utils/GeoUtilities.h"
 
 #pragma region Triangle/Edge
@@ -82,12 +83,12 @@ void TriPolygon::Triangle::DebugDraw(UWorld const * World, TriPolygon const & Po
 // ==== TriPoly ==================================================================================
 int TriPolygon::AddTriangle(TArray<FVector> const& TriangleData)
 {
-	if (auto const Result = FindTriangleIndex(TriangleData); Result.has_value())
+	if (!bHasLookupTables)
 	{
-		return Result.value();
+		RebuildLookupTables();
 	}
 	
-	// Add vertices
+	// Add vertices, a duplicate triangle only finds existing ones
 	std::array<int, 3> TriVertexIndices{};
 	int Index{ 0 };
 	for (auto const & Vertex : TriangleData)
@@ -96,19 +97,69 @@ int TriPolygon::AddTriangle(TArray<FVector> const& TriangleData)
 		++Index;
 	}
 	
+	// Welded into a line or a point
+	bool const bCollapsed = TriVertexIndices[0] == TriVertexIndices[1] || TriVertexIndices[1] == TriVertexIndices[2] || TriVertexIndices[2] == TriVertexIndices[0];
+	if (WeldDistance > 0.0 && bCollapsed)
+	{
+		return -1;
+	}
+	
+	if (auto const [It, bInserted] = TriangleLookup.try_emplace(MakeTriangleKey(TriVertexIndices), static_cast<int>(Triangles.size())); !bInserted)
+	{
+		return It->second;
+	}
+	
 	// Add to list
 	Triangles.emplace_back(Triangle{TriVertexIndices});
 	
-	// Add Edges
-	for (auto const & PossiblyNewEdge : Triangles[Triangles.size() - 1].GetEdges())
+	// Add Edges, and link the triangle to them
+	int const TriangleIndex = Triangles.size() - 1;
+	std::array<int, 3>& TriEdgeIds = TriangleEdges.emplace_back();
+	int EdgeSlot{ 0 };
+	for (auto const & PossiblyNewEdge : Triangles[TriangleIndex].GetEdges())
 	{
-		AddEdge(PossiblyNewEdge);
+		int const EdgeIdx = AddEdge(PossiblyNewEdge);
+		if (EdgeIdx == static_cast<int>(EdgeTriangles.size()))
+		{
+			EdgeTriangles.push_back({TriangleIndex, -1});
+		}
+		else if (EdgeTriangles[EdgeIdx][1] == -1)
+		{
+			EdgeTriangles[EdgeIdx][1] = TriangleIndex;
+		}
+		TriEdgeIds[EdgeSlot] = EdgeIdx;
+		++EdgeSlot;
 	}
 	
-	return Triangles.size() - 1;
+	bHasSpatialIndex = false;
+	return TriangleIndex;
 }
 
 
+void TriPolygon::BuildFromTriangles(TArray<TArray<FVector>> const& TrianglesData)
+{
+	if (!bHasLookupTables)
+	{
+		RebuildLookupTables();
+	}
+	
+	// A navmesh has fewer vertices and about one and a half times as many edges as triangles
+	size_t const NrTriangles = Triangles.size() + TrianglesData.Num();
+	Vertices.reserve(NrTriangles);
+	Edges.reserve(NrTriangles * 2);
+	Triangles.reserve(NrTriangles);
+	TriangleEdges.reserve(NrTriangles);
+	EdgeTriangles.reserve(NrTriangles * 2);
+	VertexLookup.reserve(NrTriangles);
+	EdgeLookup.reserve(NrTriangles * 2);
+	TriangleLookup.reserve(NrTriangles);
+	
+	for (TArray<FVector> const & TriangleData : TrianglesData)
+	{
+		AddTriangle(TriangleData);
+	}
+}
+
 void TriPolygon::DrawDebug(UWorld const* World, FColor const & Color) const
 {
 	for (Triangle const & Triangle : Triangles)
@@ -117,82 +168,188 @@ void TriPolygon::DrawDebug(UWorld const* World, FColor const & Color) const
 	}
 }
 
-std::vector<int> TriPolygon::GetTriangleNeighbors(int InTriangleIndex) const
+size_t TriPolygon::GetAllocatedBytes() const
 {
-	Triangle const & TriangleToCheck = Triangles[InTriangleIndex];
-	std::vector<int> Neighbors{};
+	// Hash tables: a bucket pointer each, plus a node with the entry and a next pointer per element
+	auto const GetMapBytes = [](auto const & Map)
+	{
+		using EntryType = typename std::decay_t<decltype(Map)>::value_type;
+		return Map.bucket_count() * sizeof(void*) + Map.size() * (sizeof(EntryType) + sizeof(void*));
+	};
+	
+	return Vertices.capacity() * sizeof(FVector) + Edges.capacity() * sizeof(Edge) + Triangles.capacity() * sizeof(Triangle)
+		+ TriangleEdges.capacity() * sizeof(std::array<int, 3>) + EdgeTriangles.capacity() * sizeof(std::array<int, 2>)
+		+ GetMapBytes(VertexLookup) + GetMapBytes(EdgeLookup) + GetMapBytes(TriangleLookup)
+		+ (TriangleOffsets.capacity() + TriangleIds.capacity() + EdgeOffsets.capacity() + EdgeIds.capacity()) * sizeof(int);
+}
+
+void TriPolygon::BuildSpatialIndex()
+{
+	bHasSpatialIndex = false;
+	if (Triangles.empty()) return;
 	
-	for (int CurrentIdx = 0; CurrentIdx < Triangles.size(); ++CurrentIdx)
+	// Bounds of the whole polygon
+	FVector2D Min{Vertices[0]};
+	FVector2D Max{Vertices[0]};
+	for (FVector const & Vertex : Vertices)
 	{
-		if (InTriangleIndex == CurrentIdx) continue; // skip ourself
-		Triangle const & OtherTriangle = Triangles[CurrentIdx];
-		
-		// Get number of shared vertexIdxs
-		int SharedIdxs{0};
-		for (int VertexIndex : TriangleToCheck.VertexIndices)
+		Min.X = std::min<double>(Min.X, Vertex.X);
+		Min.Y = std::min<double>(Min.Y, Vertex.Y);
+		Max.X = std::max<double>(Max.X, Vertex.X);
+		Max.Y = std::max<double>(Max.Y, Vertex.Y);
+	}
+	
+	// About one triangle per cell, but never more than MaxCellsPerAxis cells along a side
+	int constexpr MaxCellsPerAxis = 1024;
+	FVector2D const Size = Max - Min;
+	CellSize = std::max({std::sqrt(Size.X * Size.Y / Triangles.size()), std::max(Size.X, Size.Y) / MaxCellsPerAxis, 1.0});
+	GridOrigin = Min;
+	NrColumns = static_cast<int>(Size.X / CellSize) + 1;
+	NrRows = static_cast<int>(Size.Y / CellSize) + 1;
+	
+	// Bounding boxes are padded a bit, so rounding in the PointInTriangle test can't miss a triangle
+	double constexpr Padding = 0.1;
+	auto const FillBuckets = [this](int NrItems, auto const & GetPoints, std::vector<int> & Offsets, std::vector<int> & Ids)
+	{
+		auto const ForEachCell = [this, &GetPoints](int ItemIdx, auto const & Visit)
 		{
-			if (std::ranges::find(OtherTriangle.VertexIndices, VertexIndex) != OtherTriangle.VertexIndices.end())
+			FVector2D ItemMin{DBL_MAX, DBL_MAX};
+			FVector2D ItemMax{-DBL_MAX, -DBL_MAX};
+			for (int VertexIdx : GetPoints(ItemIdx))
+			{
+				ItemMin.X = std::min<double>(ItemMin.X, Vertices[VertexIdx].X);
+				ItemMin.Y = std::min<double>(ItemMin.Y, Vertices[VertexIdx].Y);
+				ItemMax.X = std::max<double>(ItemMax.X, Vertices[VertexIdx].X);
+				ItemMax.Y = std::max<double>(ItemMax.Y, Vertices[VertexIdx].Y);
+			}
+			for (int Row = GetRow(ItemMin.Y - Padding); Row <= GetRow(ItemMax.Y + Padding); ++Row)
 			{
-				++SharedIdxs;
+				for (int Column = GetColumn(ItemMin.X - Padding); Column <= GetColumn(ItemMax.X + Padding); ++Column)
+				{
+					Visit(Row * NrColumns + Column);
+				}
 			}
+		};
+		
+		// Count per cell, then fill in item order so every bucket is sorted
+		Offsets.assign(NrColumns * NrRows + 1, 0);
+		for (int ItemIdx = 0; ItemIdx < NrItems; ++ItemIdx)
+		{
+			ForEachCell(ItemIdx, [&Offsets](int Cell) { ++Offsets[Cell + 1]; });
 		}
+		for (size_t Cell = 1; Cell < Offsets.size(); ++Cell)
+		{
+			Offsets[Cell] += Offsets[Cell - 1];
+		}
+		
+		Ids.resize(Offsets.back());
+		std::vector<int> Cursors{Offsets.begin(), Offsets.end() - 1};
+		for (int ItemIdx = 0; ItemIdx < NrItems; ++ItemIdx)
+		{
+			ForEachCell(ItemIdx, [&Cursors, &Ids, ItemIdx](int Cell) { Ids[Cursors[Cell]++] = ItemIdx; });
+		}
+	};
+	
+	FillBuckets(static_cast<int>(Triangles.size()), [this](int Idx) { return Triangles[Idx].VertexIndices; }, TriangleOffsets, TriangleIds);
+	FillBuckets(static_cast<int>(Edges.size()), [this](int Idx) { return Edges[Idx].EdgeIndices; }, EdgeOffsets, EdgeIds);
+	bHasSpatialIndex = true;
+}
 
-		if (SharedIdxs >= 2)
+std::array<int, 3> TriPolygon::GetTriangleNeighborIds(int TriIdx) const
+{
+	std::array<int, 3> Neighbors{};
+	for (int Slot = 0; Slot < 3; ++Slot)
+	{
+		std::array<int, 2> const & Sides = EdgeTriangles[TriangleEdges[TriIdx][Slot]];
+		Neighbors[Slot] = Sides[0] == TriIdx ? Sides[1] : Sides[0];
+	}
+	return Neighbors;
+}
+
+std::vector<int> TriPolygon::GetTriangleNeighbors(int InTriangleIndex) const
+{
+	std::vector<int> Neighbors{};
+	for (int NeighborIdx : GetTriangleNeighborIds(InTriangleIndex))
+	{
+		if (NeighborIdx != -1)
 		{
-			Neighbors.push_back(CurrentIdx);
+			Neighbors.push_back(NeighborIdx);
 		}
 	}
 	
+	// Sorted like the triangle list
+	std::ranges::sort(Neighbors);
 	return Neighbors;
 }
 
 std::vector<int> TriPolygon::GetTriangleNeighbors(Triangle const& InTriangle) const
 {
-	for (int Idx = 0; Idx < Triangles.size(); ++Idx)
+	// Usually one of ours, otherwise look it up by its vertices
+	if (std::less_equal<>{}(Triangles.data(), &InTriangle) && std::less<>{}(&InTriangle, Triangles.data() + Triangles.size()))
 	{
-		if (Triangles[Idx] == InTriangle)
-		{
-			return GetTriangleNeighbors(Idx);
-		}
+		return GetTriangleNeighbors(GetTriangleIndex(InTriangle));
+	}
+	if (!bHasLookupTables)
+	{
+		auto const It = std::ranges::find(Triangles, InTriangle);
+		return It != Triangles.end() ? GetTriangleNeighbors(static_cast<int>(It - Triangles.begin())) : std::vector<int>{};
+	}
+	
+	auto const It = TriangleLookup.find(MakeTriangleKey(InTriangle.VertexIndices));
+	if (It == TriangleLookup.end())
+	{
+		return std::vector<int>{}; // didn't find this triangle in our list, so can't have neighbors
 	}
-	return std::vector<int>{}; // didn't find this triangle in our list, so can't have neighbors
+	return GetTriangleNeighbors(It->second);
 }
 
 std::optional<int> TriPolygon::FindTriangleIndex(TArray<FVector> const& TriangleData) const
 {
-	// check if in the list
-	for (int TriangleIndex = 0; TriangleIndex < Triangles.size(); ++TriangleIndex)
+	std::array<int, 3> TriVertexIndices{};
+	int Index{ 0 };
+	for (FVector const & Vertex : TriangleData)
 	{
-		if (Triangles[TriangleIndex].Equals(TriangleData, *this))
-		{
-			return TriangleIndex;
-		}
+		// Can't be in the list with a vertex that isn't
+		std::optional<int> const VertexIndex = FindVertexIndex(Vertex);
+		if (!VertexIndex.has_value()) return std::nullopt;
+		
+		TriVertexIndices[Index] = VertexIndex.value();
+		++Index;
+	}
+	
+	if (!bHasLookupTables)
+	{
+		auto const It = std::ranges::find(Triangles, Triangle{TriVertexIndices});
+		return It != Triangles.end() ? std::optional<int>{static_cast<int>(It - Triangles.begin())} : std::nullopt;
 	}
-	return std::nullopt;
+	
+	auto const It = TriangleLookup.find(MakeTriangleKey(TriVertexIndices));
+	return It != TriangleLookup.end() ? std::optional<int>{It->second} : std::nullopt;
 }
 
 std::optional<int> TriPolygon::FindVertexIndex(FVector const& Vertex) const
 {
-	for (int Idx = 0; Idx < Vertices.size(); ++Idx)
+	if (!bHasLookupTables)
 	{
-		if (Vertices[Idx] == Vertex)
-		{
-			return Idx;
-		}
+		VertexKey const Key = MakeVertexKey(Vertex);
+		auto const It = std::ranges::find_if(Vertices, [this, &Key](FVector const& Other) { return MakeVertexKey(Other) == Key; });
+		return It != Vertices.end() ? std::optional<int>{static_cast<int>(It - Vertices.begin())} : std::nullopt;
 	}
-	return std::nullopt;
+	
+	auto const It = VertexLookup.find(MakeVertexKey(Vertex));
+	return It != VertexLookup.end() ? std::optional<int>{It->second} : std::nullopt;
 }
 
 std::optional<int> TriPolygon::FindEdgeIndex(Edge const& Edge) const
 {
-	for (int Idx = 0; Idx < Edges.size(); ++Idx)
+	if (!bHasLookupTables)
 	{
-		if (Edges[Idx] == Edge)
-		{
-			return Idx;
-		}
+		auto const It = std::ranges::find(Edges, Edge);
+		return It != Edges.end() ? std::optional<int>{static_cast<int>(It - Edges.begin())} : std::nullopt;
 	}
-	return std::nullopt;
+	
+	auto const It = EdgeLookup.find(MakeEdgeKey(Edge));
+	return It != EdgeLookup.end() ? std::optional<int>{It->second} : std::nullopt;
 }
 
 TriPolygon::Triangle const* TriPolygon::GetClosestTriangleToPosition(FVector2D const& DesiredPosition, FVector2D& OutPosition) const
@@ -203,66 +360,265 @@ TriPolygon::Triangle const* TriPolygon::GetClosestTriangleToPosition(FVector2D c
 		return TriangleAtPos;
 	}
 
-	//find the closest edge
-	Edge const * ClosestEdge = nullptr;
-	float ClosestEdgeDistSq = -1.f;
-	for (int idx = 0; idx < Edges.size(); ++idx)
+	Edge const * ClosestEdge = FindClosestEdge(DesiredPosition, OutPosition);
+	if (ClosestEdge == nullptr) return nullptr;
+	
+	return &Triangles[EdgeTriangles[ClosestEdge - Edges.data()][0]];
+}
+
+TriPolygon::Triangle const* TriPolygon::GetTriangleAtPosition(FVector2D const& Position,
+                                                              bool OnLineAllowed) const
+{
+	auto const Contains = [this, &Position, OnLineAllowed](Triangle const & Tri)
+	{
+		return GameAI::Utilities::Geo::PointInTriangle(Position, 
+			FVector2D{Tri.GetVertex0(*this)}, 
+			FVector2D{Tri.GetVertex1(*this)}, 
+			FVector2D{Tri.GetVertex2(*this)}, 
+			OnLineAllowed);
+	};
+	
+	// Only the triangles overlapping the position's cell, in index order like the full scan
+	if (bHasSpatialIndex)
+	{
+		int const Cell = GetRow(Position.Y) * NrColumns + GetColumn(Position.X);
+		for (int Idx = TriangleOffsets[Cell]; Idx < TriangleOffsets[Cell + 1]; ++Idx)
+		{
+			if (Contains(Triangles[TriangleIds[Idx]]))
+			{
+				return &Triangles[TriangleIds[Idx]];
+			}
+		}
+		return nullptr;
+	}
+	
+	for (size_t i = 0; i < Triangles.size(); i++)
+	{
+		if (Contains(Triangles[i]))
+		{
+			return &Triangles[i];
+		}
+	}
+	return nullptr;
+}
+
+bool TriPolygon::Raycast(FVector2D const& Start, FVector2D const& End, FVector2D& OutHitPosition) const
+{
+	Triangle const* StartTriangle = GetTriangleAtPosition(Start, true);
+	if (StartTriangle == nullptr)
+	{
+		OutHitPosition = Start;
+		return false;
+	}
+	
+	return Raycast(GetTriangleIndex(*StartTriangle), Start, End, OutHitPosition);
+}
+
+bool TriPolygon::Raycast(int StartTriIdx, FVector2D const& Start, FVector2D const& End, FVector2D& OutHitPosition) const
+{
+	auto const Cross = [](FVector2D const& A, FVector2D const& B) { return A.X * B.Y - A.Y * B.X; };
+	FVector2D const Direction = End - Start;
+	
+	int TriIdx = StartTriIdx;
+	int EntryEdgeIdx = -1;
+	
+	// Every step enters the next triangle along the segment, the bound only guards against degenerate meshes
+	for (size_t Step = 0; Step <= Triangles.size(); ++Step)
 	{
-		Edge const & CurrentEdge = Edges[idx];
+		// The segment leaves the triangle through the edge it crosses furthest along (at T, as a fraction of the segment)
+		int ExitEdgeIdx = -1;
+		double ExitT = -std::numeric_limits<double>::max();
+		for (int EdgeIdx : TriangleEdges[TriIdx])
+		{
+			if (EdgeIdx == EntryEdgeIdx) continue;
+			
+			FVector2D const P1{Edges[EdgeIdx].GetP1(*this)};
+			FVector2D const P2{Edges[EdgeIdx].GetP2(*this)};
+			
+			// Skip edges with both end points on the same side of the line
+			double const Side1 = Cross(Direction, P1 - Start);
+			double const Side2 = Cross(Direction, P2 - Start);
+			if ((Side1 > 0.0 && Side2 > 0.0) || (Side1 < 0.0 && Side2 < 0.0)) continue;
+			
+			FVector2D const EdgeDirection = P2 - P1;
+			double const Denominator = Cross(Direction, EdgeDirection);
+			if (Denominator == 0.0) continue; // parallel, the segment leaves through another edge
+			
+			double const T = Cross(P1 - Start, EdgeDirection) / Denominator;
+			if (T > ExitT)
+			{
+				ExitT = T;
+				ExitEdgeIdx = EdgeIdx;
+			}
+		}
+		
+		// End lies in this triangle
+		if (ExitEdgeIdx == -1 || ExitT >= 1.0)
+		{
+			OutHitPosition = End;
+			return true;
+		}
+		
+		std::array<int, 2> const& EdgeSides = EdgeTriangles[ExitEdgeIdx];
+		int const NextTriIdx = EdgeSides[0] == TriIdx ? EdgeSides[1] : EdgeSides[0];
+		if (NextTriIdx == -1)
+		{
+			OutHitPosition = Start + Direction * std::max(ExitT, 0.0);
+			return false;
+		}
 		
+		TriIdx = NextTriIdx;
+		EntryEdgeIdx = ExitEdgeIdx;
+	}
+	
+	OutHitPosition = Start;
+	return false;
+}
+
+bool TriPolygon::HasLineOfSight(FVector2D const& Start, FVector2D const& End) const
+{
+	FVector2D HitPosition;
+	return Raycast(Start, End, HitPosition);
+}
+
+int TriPolygon::GetColumn(double X) const
+{
+	return std::clamp(static_cast<int>(std::floor((X - GridOrigin.X) / CellSize)), 0, NrColumns - 1);
+}
+
+int TriPolygon::GetRow(double Y) const
+{
+	return std::clamp(static_cast<int>(std::floor((Y - GridOrigin.Y) / CellSize)), 0, NrRows - 1);
+}
+
+TriPolygon::Edge const* TriPolygon::FindClosestEdge(FVector2D const& Position, FVector2D& OutPosition) const
+{
+	int ClosestEdgeIdx = -1;
+	float ClosestEdgeDistSq = -1.f;
+	
+	// Ties go to the lowest index, so the result doesn't depend on the order the cells are visited in
+	auto const TestEdge = [&](int EdgeIdx)
+	{
+		Edge const & CurrentEdge = Edges[EdgeIdx];
 		const FVector2D point = GameAI::Utilities::Geo::ProjectOnLineSegment(
 			FVector2D{Vertices[CurrentEdge.EdgeIndices[0]]}, 
 			FVector2D{Vertices[CurrentEdge.EdgeIndices[1]]}, 
-			DesiredPosition);
-		const float distSq = FVector2D{point - DesiredPosition}.SquaredLength();
-
-		if (ClosestEdgeDistSq < 0 || distSq < ClosestEdgeDistSq)
+			Position);
+		const float distSq = FVector2D{point - Position}.SquaredLength();
+		
+		if (ClosestEdgeDistSq < 0 || distSq < ClosestEdgeDistSq || (distSq == ClosestEdgeDistSq && EdgeIdx < ClosestEdgeIdx))
 		{
-			ClosestEdge = &CurrentEdge;
+			ClosestEdgeIdx = EdgeIdx;
 			OutPosition = point;
 			ClosestEdgeDistSq = distSq;
 		}
+	};
+	
+	if (!bHasSpatialIndex)
+	{
+		for (int idx = 0; idx < Edges.size(); ++idx)
+		{
+			TestEdge(idx);
+		}
 	}
-
-	//find the triangle
-	for (int i = 0; i < Triangles.size(); i++)
+	else
 	{
-		for (auto & Edge : Triangles[i].GetEdges())
+		// Visit rings of cells around the position (clamped into the grid) until the next ring can't hold anything closer
+		int const CenterColumn = GetColumn(Position.X);
+		int const CenterRow = GetRow(Position.Y);
+		int const MaxRing = std::max(NrColumns, NrRows);
+		for (int Ring = 0; Ring <= MaxRing; ++Ring)
 		{
-			int lineIdx = FindEdgeIndex(Edge).value_or(-1);
-			if (lineIdx == FindEdgeIndex(*ClosestEdge))
+			for (int Row = std::max(CenterRow - Ring, 0); Row <= std::min(CenterRow + Ring, NrRows - 1); ++Row)
 			{
-				return &Triangles[i];
+				// Inner rows only have the two cells on the ring's sides
+				int const Step = std::abs(Row - CenterRow) == Ring ? 1 : 2 * Ring;
+				for (int Column = CenterColumn - Ring; Column <= CenterColumn + Ring; Column += Step)
+				{
+					if (Column < 0 || Column >= NrColumns) continue;
+					
+					int const Cell = Row * NrColumns + Column;
+					for (int Idx = EdgeOffsets[Cell]; Idx < EdgeOffsets[Cell + 1]; ++Idx)
+					{
+						TestEdge(EdgeIds[Idx]);
+					}
+				}
 			}
+			
+			// Everything past this ring is at least Ring cells away
+			double const RingDistance = Ring * CellSize;
+			if (ClosestEdgeIdx != -1 && ClosestEdgeDistSq < RingDistance * RingDistance) break;
 		}
 	}
-	return nullptr;
+	
+	return ClosestEdgeIdx != -1 ? &Edges[ClosestEdgeIdx] : nullptr;
 }
 
-TriPolygon::Triangle const* TriPolygon::GetTriangleAtPosition(FVector2D const& Position,
-                                                              bool OnLineAllowed) const
+TriPolygon::VertexKey TriPolygon::MakeVertexKey(FVector const& Vertex) const
 {
-	for (size_t i = 0; i < Triangles.size(); i++)
+	if (WeldDistance > 0.0)
 	{
-		if (GameAI::Utilities::Geo::PointInTriangle(Position, 
-			FVector2D{Triangles[i].GetVertex0(*this)}, 
-			FVector2D{Triangles[i].GetVertex1(*this)}, 
-			FVector2D{Triangles[i].GetVertex2(*this)}, 
-			OnLineAllowed))
-		{
-			return &Triangles[i];
-		}
+		return VertexKey{
+			std::llround(Vertex.X / WeldDistance),
+			std::llround(Vertex.Y / WeldDistance),
+			std::llround(Vertex.Z / WeldDistance)};
 	}
-	return nullptr;
+	
+	// Exact match on the bits, + 0.0 turns -0 into 0 so they hash the same like they compare the same
+	auto const Bits = [](double Value)
+	{
+		Value += 0.0;
+		int64_t Result;
+		std::memcpy(&Result, &Value, sizeof(Result));
+		return Result;
+	};
+	return VertexKey{Bits(Vertex.X), Bits(Vertex.Y), Bits(Vertex.Z)};
+}
+
+uint64_t TriPolygon::MakeEdgeKey(Edge const& Edge)
+{
+	auto const [Low, High] = std::minmax(Edge.EdgeIndices[0], Edge.EdgeIndices[1]);
+	return static_cast<uint64_t>(static_cast<uint32_t>(Low)) << 32 | static_cast<uint32_t>(High);
+}
+
+TriPolygon::TriangleKey TriPolygon::MakeTriangleKey(std::array<int, 3> const& VertexIndices)
+{
+	TriangleKey Key{VertexIndices};
+	std::ranges::sort(Key);
+	return Key;
+}
+
+void TriPolygon::RebuildLookupTables()
+{
+	VertexLookup.clear();
+	EdgeLookup.clear();
+	TriangleLookup.clear();
+	VertexLookup.reserve(Vertices.size());
+	EdgeLookup.reserve(Edges.size());
+	TriangleLookup.reserve(Triangles.size());
+	
+	// First occurrence wins, like when they were added
+	for (int Idx = 0; Idx < static_cast<int>(Vertices.size()); ++Idx)
+	{
+		VertexLookup.try_emplace(MakeVertexKey(Vertices[Idx]), Idx);
+	}
+	for (int Idx = 0; Idx < static_cast<int>(Edges.size()); ++Idx)
+	{
+		EdgeLookup.try_emplace(MakeEdgeKey(Edges[Idx]), Idx);
+	}
+	for (int Idx = 0; Idx < static_cast<int>(Triangles.size()); ++Idx)
+	{
+		TriangleLookup.try_emplace(MakeTriangleKey(Triangles[Idx].VertexIndices), Idx);
+	}
+	bHasLookupTables = true;
 }
 
 int TriPolygon::AddVertex(FVector const& Vertex)
 {
-	// Return index of existing vertex if already present (exact match)
-	for (int i = 0; i < Vertices.size(); ++i)
+	// Return index of existing vertex if already present
+	if (auto const [It, bInserted] = VertexLookup.try_emplace(MakeVertexKey(Vertex), static_cast<int>(Vertices.size())); !bInserted)
 	{
-		if (Vertices[i] == Vertex)
-			return i;
+		return It->second;
 	}
 	Vertices.push_back(Vertex);
 	return Vertices.size() - 1;
@@ -270,10 +626,9 @@ int TriPolygon::AddVertex(FVector const& Vertex)
 
 int TriPolygon::AddEdge(Edge const& Edge)
 {
-	for (int i = 0; i < Edges.size(); ++i)
+	if (auto const [It, bInserted] = EdgeLookup.try_emplace(MakeEdgeKey(Edge), static_cast<int>(Edges.size())); !bInserted)
 	{
-		if (Edges[i] == Edge)
-			return i;
+		return It->second;
 	}
 	Edges.push_back(Edge);
 	return Edges.size() - 1;
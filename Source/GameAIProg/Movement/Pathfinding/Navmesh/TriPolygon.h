@@ -1,9 +1,17 @@
 ﻿#pragma once
+#include <cstdint>
+#include <unordered_map>
 #include <vector>
 
+namespace GameAI
+{
+	class NavMeshCache;
+}
 
 class TriPolygon
 {
+	friend class GameAI::NavMeshCache; // fills the arrays straight from a cache file
+	
 public:
 	
 	struct Edge
@@ -36,8 +44,13 @@ public:
 	};
 	
 	TriPolygon() = default;
+	// Vertices in the same WeldDistance sized cell are merged (a quantised key, so two close points
+	// on either side of a cell border stay apart). Triangles that collapse are skipped and return -1
+	explicit TriPolygon(double WeldDistance) : WeldDistance{WeldDistance} {}
 	
 	int AddTriangle(TArray<FVector> const & TriangleData);
+	// AddTriangle for a whole mesh, with the storage and lookup tables sized up front
+	void BuildFromTriangles(TArray<TArray<FVector>> const & TrianglesData);
 	
 	std::vector<FVector> const& GetVertices() const { return Vertices; }
 	std::vector<Edge> const& GetEdges() const { return Edges; }
@@ -45,6 +58,21 @@ public:
 	Triangle const& GetTriangle(int TriIdx) const { return Triangles[TriIdx]; }
 	
 	void DrawDebug(UWorld const * World, FColor const & Color) const;
+	size_t GetAllocatedBytes() const; // arrays, lookup tables and spatial index, for stats
+	
+	// Buckets the triangles and edges in a uniform grid, so the position queries only test the few in one cell.
+	// Call once the polygon is complete, adding a triangle afterwards drops the index (queries fall back to a full scan)
+	void BuildSpatialIndex();
+	bool HasSpatialIndex() const { return bHasSpatialIndex; }
+	
+	// Adjacency, filled in while adding triangles
+	int GetTriangleIndex(Triangle const& InTriangle) const { return static_cast<int>(&InTriangle - Triangles.data()); } // of a triangle in GetTriangles()
+	std::array<int, 3> const& GetTriangleEdgeIds(int TriIdx) const { return TriangleEdges[TriIdx]; } // in GetEdges() order
+	// The triangles on both sides of an edge, -1 on the open side of a border edge.
+	// Like half-edges, an edge that more than two triangles share only links the first two
+	std::array<int, 2> const& GetEdgeTriangles(int EdgeIdx) const { return EdgeTriangles[EdgeIdx]; }
+	bool IsSharedEdge(int EdgeIdx) const { return EdgeTriangles[EdgeIdx][1] != -1; }
+	std::array<int, 3> GetTriangleNeighborIds(int TriIdx) const; // across each edge, -1 on the border
 	
 	// Queries
 	std::vector<int> GetTriangleNeighbors(int InTriangleIndex) const;
@@ -57,12 +85,61 @@ public:
 	Triangle const* GetClosestTriangleToPosition(FVector2D const& DesiredPosition, FVector2D& OutPosition) const;
 	Triangle const* GetTriangleAtPosition(FVector2D const& Position, bool OnLineAllowed) const;
 	
+	// Walks from triangle to triangle along the segment through the adjacency tables. True when End can be reached
+	// in a straight line without leaving the polygon, otherwise OutHitPosition is where the segment leaves it.
+	// A line of sight test for path shortcuts (any-angle paths) and steering
+	bool Raycast(FVector2D const& Start, FVector2D const& End, FVector2D& OutHitPosition) const;
+	bool Raycast(int StartTriIdx, FVector2D const& Start, FVector2D const& End, FVector2D& OutHitPosition) const; // Start is in StartTriIdx
+	bool HasLineOfSight(FVector2D const& Start, FVector2D const& End) const;
+	
 
 private:
+	// Hashed lookup keys: the coordinates (quantised when welding), the sorted vertex indices of an edge or triangle
+	struct VertexKey
+	{
+		int64_t X, Y, Z;
+		bool operator==(VertexKey const& Other) const = default;
+	};
+	using TriangleKey = std::array<int, 3>;
+	struct KeyHash
+	{
+		size_t operator()(VertexKey const& Key) const { return Mix(Mix(Mix(0, Key.X), Key.Y), Key.Z); }
+		size_t operator()(TriangleKey const& Key) const { return Mix(Mix(Mix(0, Key[0]), Key[1]), Key[2]); }
+		static size_t Mix(size_t Seed, int64_t Value) { return Seed ^ (std::hash<int64_t>{}(Value) + 0x9e3779b97f4a7c15ull + (Seed << 6) + (Seed >> 2)); }
+	};
+	
+	VertexKey MakeVertexKey(FVector const& Vertex) const;
+	void RebuildLookupTables();
+	static uint64_t MakeEdgeKey(Edge const& Edge);
+	static TriangleKey MakeTriangleKey(std::array<int, 3> const& VertexIndices);
+	
 	int AddVertex(FVector const& Vertex);
 	int AddEdge(Edge const & Edge);
 	
 	std::vector<FVector>  Vertices;
 	std::vector<Edge> Edges;
 	std::vector<Triangle> Triangles;
+	std::vector<std::array<int, 3>> TriangleEdges; // edge ids per triangle
+	std::vector<std::array<int, 2>> EdgeTriangles; // triangles per edge
+	
+	double WeldDistance{0.0};
+	std::unordered_map<VertexKey, int, KeyHash> VertexLookup;
+	std::unordered_map<uint64_t, int> EdgeLookup;
+	std::unordered_map<TriangleKey, int, KeyHash> TriangleLookup;
+	bool bHasLookupTables{true}; // false after loading from a cache, the Find functions scan until a triangle is added
+	
+	// Spatial index, both buckets are compressed rows: cell C owns Ids[Offsets[C] .. Offsets[C + 1]), ids ascending
+	bool bHasSpatialIndex{false};
+	FVector2D GridOrigin{};
+	double CellSize{1.0};
+	int NrColumns{0};
+	int NrRows{0};
+	std::vector<int> TriangleOffsets;
+	std::vector<int> TriangleIds;
+	std::vector<int> EdgeOffsets;
+	std::vector<int> EdgeIds;
+	
+	int GetColumn(double X) const;
+	int GetRow(double Y) const;
+	Edge const* FindClosestEdge(FVector2D const& Position, FVector2D& OutPosition) const;
 };
@@ -0,0 +1,158 @@
+﻿#include "TriPolygon.h"
+
+#include <optional>
+#include <vector>
+#include "HAL/IConsoleManager.h"
+#include "Math/RandomStream.h"
+
+// Times the TriPolygon lookup tables against the linear scans they replaced, on the same generated mesh so the
+// numbers can be reproduced anywhere: GameAI.Navmesh.BenchmarkLookups [NrTriangles=50000] [NrQueries=1000] [NrTriangleScans=3] [Seed=1]
+namespace
+{
+	// Two triangles per quad of a square grid, the vertices jittered so the mesh isn't regular
+	TArray<TArray<FVector>> MakeJitteredGridMesh(int NrTriangles, int Seed)
+	{
+		int const NrQuadsPerRow = FMath::Max(1, FMath::CeilToInt(FMath::Sqrt(NrTriangles / 2.0)));
+		int const NrPointsPerRow = NrQuadsPerRow + 1;
+		FRandomStream Random{Seed};
+
+		std::vector<FVector> Points{};
+		Points.reserve(NrPointsPerRow * NrPointsPerRow);
+		for (int Row = 0; Row < NrPointsPerRow; ++Row)
+		{
+			for (int Col = 0; Col < NrPointsPerRow; ++Col)
+			{
+				Points.emplace_back(Col * 100.0 + Random.FRandRange(-30.0, 30.0), Row * 100.0 + Random.FRandRange(-30.0, 30.0), 0.0);
+			}
+		}
+
+		TArray<TArray<FVector>> TrianglesData{};
+		TrianglesData.Reserve(NrTriangles);
+		for (int Quad = 0; TrianglesData.Num() < NrTriangles; ++Quad)
+		{
+			int const Corner = Quad / NrQuadsPerRow * NrPointsPerRow + Quad % NrQuadsPerRow;
+			FVector const& BottomLeft = Points[Corner];
+			FVector const& BottomRight = Points[Corner + 1];
+			FVector const& TopLeft = Points[Corner + NrPointsPerRow];
+			FVector const& TopRight = Points[Corner + NrPointsPerRow + 1];
+			TrianglesData.Add(TArray<FVector>{BottomLeft, BottomRight, TopRight});
+			if (TrianglesData.Num() < NrTriangles)
+			{
+				TrianglesData.Add(TArray<FVector>{BottomLeft, TopRight, TopLeft});
+			}
+		}
+		return TrianglesData;
+	}
+
+	// The lookups as they were before the hash tables, every one a scan from the front
+	std::optional<int> ScanVertexIndex(TriPolygon const& Poly, FVector const& Vertex)
+	{
+		std::vector<FVector> const& Vertices = Poly.GetVertices();
+		for (int Idx = 0; Idx < static_cast<int>(Vertices.size()); ++Idx)
+		{
+			if (Vertices[Idx] == Vertex) return Idx;
+		}
+		return std::nullopt;
+	}
+
+	std::optional<int> ScanEdgeIndex(TriPolygon const& Poly, TriPolygon::Edge const& Edge)
+	{
+		std::vector<TriPolygon::Edge> const& Edges = Poly.GetEdges();
+		for (int Idx = 0; Idx < static_cast<int>(Edges.size()); ++Idx)
+		{
+			if (Edges[Idx] == Edge) return Idx;
+		}
+		return std::nullopt;
+	}
+
+	// Every candidate triangle scanned its three vertices, like the old Triangle::Equals
+	std::optional<int> ScanTriangleIndex(TriPolygon const& Poly, TArray<FVector> const& TriangleData)
+	{
+		std::vector<TriPolygon::Triangle> const& Triangles = Poly.GetTriangles();
+		for (int Idx = 0; Idx < static_cast<int>(Triangles.size()); ++Idx)
+		{
+			std::array<int, 3> DataIndices{};
+			for (int Corner = 0; Corner < 3; ++Corner)
+			{
+				DataIndices[Corner] = ScanVertexIndex(Poly, TriangleData[Corner]).value_or(-1);
+			}
+			if (Triangles[Idx] == TriPolygon::Triangle{DataIndices}) return Idx;
+		}
+		return std::nullopt;
+	}
+
+	// Average microseconds per query, queries spread evenly over the mesh. Counts the queries that found the wrong index
+	template <typename Lookup>
+	double TimeLookupsUs(int NrTriangles, int NrQueries, int& NrWrong, Lookup const& FindTriangleIndex)
+	{
+		double const StartTime = FPlatformTime::Seconds();
+		for (int Query = 0; Query < NrQueries; ++Query)
+		{
+			int const TriIdx = static_cast<int>(static_cast<int64>(Query) * NrTriangles / NrQueries);
+			NrWrong += FindTriangleIndex(TriIdx) ? 0 : 1;
+		}
+		return (FPlatformTime::Seconds() - StartTime) * 1000000.0 / NrQueries;
+	}
+
+	void BenchmarkLookups(TArray<FString> const& Args)
+	{
+		int const NrTriangles = FMath::Max(1, Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 50000);
+		int const NrQueries = FMath::Max(1, Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 1000);
+		int const NrTriangleScans = FMath::Max(1, Args.Num() > 2 ? FCString::Atoi(*Args[2]) : 3); // seconds each on a big mesh
+		int const Seed = Args.Num() > 3 ? FCString::Atoi(*Args[3]) : 1;
+
+		TArray<TArray<FVector>> const TrianglesData = MakeJitteredGridMesh(NrTriangles, Seed);
+		TriPolygon Poly{};
+		double const BuildStartTime = FPlatformTime::Seconds();
+		Poly.BuildFromTriangles(TrianglesData);
+		double const BuildTimeMs = (FPlatformTime::Seconds() - BuildStartTime) * 1000.0;
+
+		// No duplicates in the generated mesh, so triangle i is the i-th one added
+		int NrWrong = 0;
+		auto const FirstEdge = [&Poly](int TriIdx) { return Poly.GetEdges()[Poly.GetTriangleEdgeIds(TriIdx)[0]]; };
+		auto const FirstVertex = [&Poly](int TriIdx) { return Poly.GetTriangle(TriIdx).GetVertex0(Poly); };
+
+		double const HashedVertexUs = TimeLookupsUs(NrTriangles, NrQueries, NrWrong, [&](int TriIdx)
+		{
+			return Poly.FindVertexIndex(FirstVertex(TriIdx)) == Poly.GetTriangle(TriIdx).VertexIndices[0];
+		});
+		double const ScannedVertexUs = TimeLookupsUs(NrTriangles, NrQueries, NrWrong, [&](int TriIdx)
+		{
+			return ScanVertexIndex(Poly, FirstVertex(TriIdx)) == Poly.GetTriangle(TriIdx).VertexIndices[0];
+		});
+		double const HashedEdgeUs = TimeLookupsUs(NrTriangles, NrQueries, NrWrong, [&](int TriIdx)
+		{
+			return Poly.FindEdgeIndex(FirstEdge(TriIdx)) == Poly.GetTriangleEdgeIds(TriIdx)[0];
+		});
+		double const ScannedEdgeUs = TimeLookupsUs(NrTriangles, NrQueries, NrWrong, [&](int TriIdx)
+		{
+			return ScanEdgeIndex(Poly, FirstEdge(TriIdx)) == Poly.GetTriangleEdgeIds(TriIdx)[0];
+		});
+		double const HashedTriangleUs = TimeLookupsUs(NrTriangles, NrQueries, NrWrong, [&](int TriIdx)
+		{
+			return Poly.FindTriangleIndex(TrianglesData[TriIdx]) == TriIdx;
+		});
+		double const ScannedTriangleUs = TimeLookupsUs(NrTriangles, NrTriangleScans, NrWrong, [&](int TriIdx)
+		{
+			return ScanTriangleIndex(Poly, TrianglesData[TriIdx]) == TriIdx;
+		});
+
+		// The old AddTriangle ran a triangle, three vertex and three edge scans over all of the mesh built so far, where the
+		// queries above stop halfway through the whole mesh on average. A vertex or edge scan grows with the built part, about
+		// one query each over the build. A triangle scan grows with its triangles times their vertices, two thirds of a query
+		double const ScannedBuildEstimateMs = NrTriangles * (ScannedTriangleUs * 2.0 / 3.0 + 3.0 * (ScannedVertexUs + ScannedEdgeUs)) / 1000.0;
+
+		UE_LOG(LogTemp, Log, TEXT("TriPolygon lookups on %d triangles (%d vertices, %d edges), seed %d, %d wrong results"), NrTriangles,
+			static_cast<int>(Poly.GetVertices().size()), static_cast<int>(Poly.GetEdges().size()), Seed, NrWrong);
+		UE_LOG(LogTemp, Log, TEXT("  vertex   %10.3f us hashed, %12.3f us scanned (%d queries)"), HashedVertexUs, ScannedVertexUs, NrQueries);
+		UE_LOG(LogTemp, Log, TEXT("  edge     %10.3f us hashed, %12.3f us scanned (%d queries)"), HashedEdgeUs, ScannedEdgeUs, NrQueries);
+		UE_LOG(LogTemp, Log, TEXT("  triangle %10.3f us hashed, %12.3f us scanned (%d/%d queries)"), HashedTriangleUs, ScannedTriangleUs,
+			NrQueries, NrTriangleScans);
+		UE_LOG(LogTemp, Log, TEXT("  build %.2f ms hashed, about %.0f ms with the scans"), BuildTimeMs, ScannedBuildEstimateMs);
+	}
+
+	FAutoConsoleCommand BenchmarkLookupsCommand(
+		TEXT("GameAI.Navmesh.BenchmarkLookups"),
+		TEXT("Times the TriPolygon lookup tables against linear scans on a generated mesh. Args: [NrTriangles] [NrQueries] [NrTriangleScans] [Seed]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&BenchmarkLookups));
+}
@@ -0,0 +1,38 @@
+#include "FlowFieldFollowSteeringBehavior.h"
+#include "../SteeringAgent.h"
+#include "DrawDebugHelpers.h"
+#include "GraphTheory/Algorithms/FlowField.h"
+#include "Shared/Graph/GridGraph/GridGraph.h"
+
+SteeringOutput FlowFieldFollow::CalculateSteering(float DeltaT, ASteeringAgent& Agent)
+{
+	SteeringOutput steering{};
+	if (pFlowField == nullptr) return steering;
+
+	GameAI::GridGraph const* pGrid = pFlowField->GetGrid();
+	FVector2D const agentPosition = Agent.GetPosition();
+	int const cellId = pGrid->GetNodeIdAtPosition(agentPosition);
+	if (!pFlowField->IsReachable(cellId)) return steering; // off the grid or cut off from the goal
+
+	int const nextId = pFlowField->GetNextNodeId(cellId);
+	if (nextId != GameAI::Graphs::InvalidNodeId)
+	{
+		// Head for the centre of the next cell rather than along the raw direction,
+		// that keeps agents from drifting off the field's path into blocked cells
+		steering.LinearVelocity = pGrid->GetNodePosition(nextId) - agentPosition;
+	}
+	else
+	{
+		// In the goal cell, arrive at its centre. Scaling the input instead of the max speed keeps this stateless
+		FVector2D const toGoal = pGrid->GetNodePosition(cellId) - agentPosition;
+		float const distance = toGoal.Size();
+		float const speedFactor = FMath::Clamp((distance - TargetRadius) / (SlowRadius - TargetRadius), 0.f, 1.f);
+		steering.LinearVelocity = toGoal.GetSafeNormal() * speedFactor;
+	}
+
+	// Debug rendering
+	if (Agent.GetDebugRenderingEnabled())
+		DrawDebugLine(Agent.GetWorld(), FVector(agentPosition, 0), FVector(agentPosition + pFlowField->GetDirection(cellId) * 100.f, 0), FColor::Cyan, false, -1, 0, 2.f);
+
+	return steering;
+}
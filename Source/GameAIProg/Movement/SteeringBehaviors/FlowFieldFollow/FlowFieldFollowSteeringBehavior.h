@@ -0,0 +1,28 @@
+#pragma once
+
+#include "../Steering/SteeringBehaviors.h"
+
+namespace GameAI
+{
+	class FlowField;
+}
+
+// Follows a flow field towards its goal cell. Keeps no per-agent state,
+// so a whole crowd heading for the same goal can share one instance
+class FlowFieldFollow : public ISteeringBehavior
+{
+public:
+	FlowFieldFollow() = default;
+	virtual ~FlowFieldFollow() override = default;
+
+	void SetFlowField(GameAI::FlowField const* pField) { pFlowField = pField; }
+	GameAI::FlowField const* GetFlowField() const { return pFlowField; }
+
+	virtual SteeringOutput CalculateSteering(float DeltaT, ASteeringAgent& Agent) override;
+
+	float SlowRadius = 100.f; // within the goal cell
+	float TargetRadius = 10.f;
+
+private:
+	GameAI::FlowField const* pFlowField = nullptr;
+};
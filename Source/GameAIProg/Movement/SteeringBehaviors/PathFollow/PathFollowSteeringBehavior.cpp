@@ -22,6 +22,51 @@ void PathFollow::SetPath(std::vector<FVector2D>& path)
 	GotoNextPathPoint();
 }
 
+void PathFollow::AppendPath(std::vector<FVector2D> const& path)
+{
+	if (path.empty()) return;
+
+	// Heading for the last point (or done), retarget so it gets seeked instead of arrived at
+	bool const bWasOnLastPoint = currentPathIndex >= static_cast<int>(pathVec.size()) - 1;
+	pathVec.insert(pathVec.end(), path.begin(), path.end());
+	if (bWasOnLastPoint)
+	{
+		currentPathIndex = std::max(currentPathIndex, 0) - 1;
+		GotoNextPathPoint();
+	}
+}
+
+void PathFollow::UpdatePath(std::vector<FVector2D> const& path)
+{
+	if (pathVec.empty() || path.empty())
+	{
+		pathVec = path;
+		currentPathIndex = -1;
+		GotoNextPathPoint();
+		return;
+	}
+
+	// The new path mostly overlaps the old one, pick it up again where the agent is headed now
+	FVector2D const currentPoint = pathVec[std::min(currentPathIndex, static_cast<int>(pathVec.size()) - 1)];
+	int closestIndex = 0;
+	for (int i = 1; i < static_cast<int>(path.size()); ++i)
+	{
+		if (FVector2D::DistSquared(path[i], currentPoint) < FVector2D::DistSquared(path[closestIndex], currentPoint))
+		{
+			closestIndex = i;
+		}
+	}
+
+	pathVec = path;
+	currentPathIndex = closestIndex - 1;
+	GotoNextPathPoint();
+}
+
+int PathFollow::GetRemainingPointCount() const
+{
+	return std::max(static_cast<int>(pathVec.size()) - currentPathIndex, 0);
+}
+
 SteeringOutput PathFollow::CalculateSteering(float DeltaTime, ASteeringAgent& Agent)
 {
 	if (currentPathIndex < static_cast<int>(pathVec.size()))
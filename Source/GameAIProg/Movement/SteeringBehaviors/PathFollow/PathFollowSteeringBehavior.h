@@ -10,6 +10,9 @@ public:
 	PathFollow();
 	virtual ~PathFollow() override;
 	void SetPath(std::vector<FVector2D>& path);
+	void AppendPath(std::vector<FVector2D> const& path); // keeps following, for paths that are refined on the go
+	void UpdatePath(std::vector<FVector2D> const& path); // continues at the point closest to the current one, for best-so-far paths of searches still running
+	int GetRemainingPointCount() const;
 	virtual SteeringOutput CalculateSteering(float DeltaTime, ASteeringAgent & Agent) override;
 
 private:
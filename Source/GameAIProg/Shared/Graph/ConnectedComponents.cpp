@@ -0,0 +1,304 @@
+﻿#include "ConnectedComponents.h"
+#include "Graph.h"
+#include <algorithm>
+
+using namespace GameAI;
+
+template<typename Callback>
+void ConnectedComponents::ForEachNeighbour(Graph const& Graph, int NodeId, Callback&& OnNeighbour)
+{
+	for (Connection const* pConnection : Graph.GetConnectionsFrom(NodeId))
+	{
+		OnNeighbour(pConnection->GetToId());
+	}
+
+	// Undirected graphs hold both directions already
+	if (!Graph.GetIsDirectional()) return;
+
+	for (Connection const* pConnection : Graph.GetConnectionsTo(NodeId))
+	{
+		OnNeighbour(pConnection->GetFromId());
+	}
+}
+
+void ConnectedComponents::Rebuild(Graph const& Graph)
+{
+	double const StartTime = FPlatformTime::Seconds();
+
+	auto const& Nodes = Graph.GetNodes();
+	int const NrNodes = static_cast<int>(Nodes.size());
+
+	// Union-find over the connections, union by size and path halving
+	std::vector<int> Parents(NrNodes);
+	std::vector<int> Sizes(NrNodes, 1);
+	for (int NodeId = 0; NodeId < NrNodes; ++NodeId)
+	{
+		Parents[NodeId] = NodeId;
+	}
+	auto const FindRoot = [&Parents](int NodeId)
+	{
+		while (Parents[NodeId] != NodeId)
+		{
+			Parents[NodeId] = Parents[Parents[NodeId]];
+			NodeId = Parents[NodeId];
+		}
+		return NodeId;
+	};
+
+	for (std::unique_ptr<Connection> const& pConnection : Graph.GetConnections())
+	{
+		int FromRoot = FindRoot(pConnection->GetFromId());
+		int ToRoot = FindRoot(pConnection->GetToId());
+		if (FromRoot == ToRoot) continue;
+
+		if (Sizes[FromRoot] < Sizes[ToRoot]) std::swap(FromRoot, ToRoot);
+		Parents[ToRoot] = FromRoot;
+		Sizes[FromRoot] += Sizes[ToRoot];
+	}
+
+	// Roots become dense ids, removed nodes get none
+	ComponentIds.assign(NrNodes, InvalidComponent);
+	ComponentSizes.clear();
+	FreeIds.clear();
+	std::vector<int> IdOfRoot(NrNodes, InvalidComponent);
+	for (int NodeId = 0; NodeId < NrNodes; ++NodeId)
+	{
+		if (Nodes[NodeId]->GetId() == Graphs::InvalidNodeId) continue;
+
+		int& RootId = IdOfRoot[FindRoot(NodeId)];
+		if (RootId == InvalidComponent)
+		{
+			RootId = static_cast<int>(ComponentSizes.size());
+			ComponentSizes.push_back(0);
+		}
+		ComponentIds[NodeId] = RootId;
+		++ComponentSizes[RootId];
+	}
+
+	SearchOfNode.assign(NrNodes, InvalidComponent);
+	Version = Graph.GetVersion();
+
+	BuildTimeMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+}
+
+void ConnectedComponents::OnConnectionsAdded(Graph const& Graph, int NodeId)
+{
+	double const StartTime = FPlatformTime::Seconds();
+	LastNrVisited = 0;
+
+	// The biggest of the components that got connected keeps its id, the others are relabelled
+	int KeptId = ComponentIds[NodeId];
+	ForEachNeighbour(Graph, NodeId, [this, &KeptId](int NeighbourId)
+	{
+		if (ComponentSizes[ComponentIds[NeighbourId]] > ComponentSizes[KeptId])
+		{
+			KeptId = ComponentIds[NeighbourId];
+		}
+	});
+
+	if (ComponentIds[NodeId] != KeptId)
+	{
+		LastNrVisited += Relabel(Graph, NodeId, KeptId);
+	}
+	ForEachNeighbour(Graph, NodeId, [this, &Graph, KeptId](int NeighbourId)
+	{
+		if (ComponentIds[NeighbourId] != KeptId)
+		{
+			LastNrVisited += Relabel(Graph, NeighbourId, KeptId);
+		}
+	});
+
+	Version = Graph.GetVersion();
+	LastUpdateTimeMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+}
+
+void ConnectedComponents::OnConnectionsRemoved(Graph const& Graph, int NodeId, std::span<int const> FormerNeighbours)
+{
+	double const StartTime = FPlatformTime::Seconds();
+	LastNrVisited = 0;
+
+	// Every piece the component may have split into holds the node or one of its former neighbours
+	int const OldId = ComponentIds[NodeId];
+	Searches.clear();
+	auto const AddSearch = [this, OldId](int SeedId)
+	{
+		if (ComponentIds[SeedId] != OldId || SearchOfNode[SeedId] != InvalidComponent) return;
+
+		int const SearchIdx = static_cast<int>(Searches.size());
+		Searches.push_back(PieceSearch{{SeedId}, 0, SearchIdx});
+		SearchOfNode[SeedId] = SearchIdx;
+	};
+	AddSearch(NodeId);
+	for (int const NeighbourId : FormerNeighbours)
+	{
+		AddSearch(NeighbourId);
+	}
+
+	// One node per search and round so the pieces grow at the same pace. Searches that meet are the same piece,
+	// a piece whose searches all ran dry is cut off and gets a new id. Once one piece is left it keeps the old id
+	int const NrSearches = static_cast<int>(Searches.size());
+	while (NrSearches > 1)
+	{
+		for (int SearchIdx = 0; SearchIdx < NrSearches; ++SearchIdx)
+		{
+			PieceSearch& Search = Searches[SearchIdx];
+			if (Search.NrExpanded == static_cast<int>(Search.Visited.size())) continue;
+
+			int const CurrentId = Search.Visited[Search.NrExpanded++];
+			ForEachNeighbour(Graph, CurrentId, [this, SearchIdx](int NeighbourId)
+			{
+				if (int const OtherIdx = SearchOfNode[NeighbourId]; OtherIdx != InvalidComponent)
+				{
+					if (int const Group = FindGroup(SearchIdx), OtherGroup = FindGroup(OtherIdx); Group != OtherGroup)
+					{
+						Searches[OtherGroup].Group = Group;
+					}
+					return;
+				}
+				SearchOfNode[NeighbourId] = SearchIdx;
+				Searches[SearchIdx].Visited.push_back(NeighbourId);
+			});
+		}
+
+		// 1: all searches of the group ran dry, 2: one is still going
+		GroupStates.assign(NrSearches, 0);
+		for (int SearchIdx = 0; SearchIdx < NrSearches; ++SearchIdx)
+		{
+			int const Group = FindGroup(SearchIdx);
+			if (Searches[Group].bIsDone) continue;
+
+			bool const bIsRunning = Searches[SearchIdx].NrExpanded < static_cast<int>(Searches[SearchIdx].Visited.size());
+			GroupStates[Group] = std::max<uint8_t>(GroupStates[Group], bIsRunning ? 2 : 1);
+		}
+		int const NrRunning = static_cast<int>(std::ranges::count(GroupStates, 2));
+		int const NrCutOff = static_cast<int>(std::ranges::count(GroupStates, 1));
+		if (NrRunning + NrCutOff <= 1) break;
+
+		// When the last pieces ran dry in the same round, the biggest one keeps the old id
+		int KeptGroup = InvalidComponent;
+		if (NrRunning == 0)
+		{
+			int KeptSize = 0;
+			for (int Group = 0; Group < NrSearches; ++Group)
+			{
+				if (GroupStates[Group] != 1) continue;
+
+				int Size = 0;
+				for (int SearchIdx = 0; SearchIdx < NrSearches; ++SearchIdx)
+				{
+					Size += FindGroup(SearchIdx) == Group ? static_cast<int>(Searches[SearchIdx].Visited.size()) : 0;
+				}
+				if (Size > KeptSize)
+				{
+					KeptSize = Size;
+					KeptGroup = Group;
+				}
+			}
+		}
+
+		for (int Group = 0; Group < NrSearches; ++Group)
+		{
+			if (GroupStates[Group] != 1 || Group == KeptGroup) continue;
+
+			int const PieceId = NewComponentId();
+			for (int SearchIdx = 0; SearchIdx < NrSearches; ++SearchIdx)
+			{
+				if (FindGroup(SearchIdx) != Group) continue;
+
+				for (int const PieceNodeId : Searches[SearchIdx].Visited)
+				{
+					ComponentIds[PieceNodeId] = PieceId;
+				}
+				ComponentSizes[PieceId] += static_cast<int>(Searches[SearchIdx].Visited.size());
+			}
+			ComponentSizes[OldId] -= ComponentSizes[PieceId];
+			Searches[Group].bIsDone = true;
+		}
+
+		if (NrRunning <= 1) break;
+	}
+
+	for (PieceSearch const& Search : Searches)
+	{
+		for (int const VisitedId : Search.Visited)
+		{
+			SearchOfNode[VisitedId] = InvalidComponent;
+		}
+		LastNrVisited += static_cast<int>(Search.Visited.size());
+	}
+
+	Version = Graph.GetVersion();
+	LastUpdateTimeMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+}
+
+void ConnectedComponents::OnCostsChanged(Graph const& Graph)
+{
+	Version = Graph.GetVersion();
+}
+
+bool ConnectedComponents::IsUpToDate(Graph const& Graph) const
+{
+	return Version == Graph.GetVersion() && ComponentIds.size() == Graph.GetNodes().size();
+}
+
+size_t ConnectedComponents::GetAllocatedBytes() const
+{
+	size_t Bytes = (ComponentIds.capacity() + ComponentSizes.capacity() + FreeIds.capacity() + SearchOfNode.capacity()
+		+ RelabelQueue.capacity()) * sizeof(int) + GroupStates.capacity() * sizeof(uint8_t)
+		+ Searches.capacity() * sizeof(PieceSearch);
+	for (PieceSearch const& Search : Searches)
+	{
+		Bytes += Search.Visited.capacity() * sizeof(int);
+	}
+	return Bytes;
+}
+
+int ConnectedComponents::NewComponentId()
+{
+	if (FreeIds.empty())
+	{
+		ComponentSizes.push_back(0);
+		return static_cast<int>(ComponentSizes.size()) - 1;
+	}
+
+	int const FreeId = FreeIds.back();
+	FreeIds.pop_back();
+	return FreeId;
+}
+
+int ConnectedComponents::Relabel(Graph const& Graph, int FromNodeId, int NewComponentId)
+{
+	// The old component is connected on its own, so a flood over its id reaches all of it
+	int const OldId = ComponentIds[FromNodeId];
+	ComponentIds[FromNodeId] = NewComponentId;
+	RelabelQueue.assign(1, FromNodeId);
+	for (size_t QueueIdx = 0; QueueIdx < RelabelQueue.size(); ++QueueIdx)
+	{
+		ForEachNeighbour(Graph, RelabelQueue[QueueIdx], [this, OldId, NewComponentId](int NeighbourId)
+		{
+			if (ComponentIds[NeighbourId] != OldId) return;
+
+			ComponentIds[NeighbourId] = NewComponentId;
+			RelabelQueue.push_back(NeighbourId);
+		});
+	}
+
+	int const NrRelabelled = static_cast<int>(RelabelQueue.size());
+	ComponentSizes[NewComponentId] += NrRelabelled;
+	ComponentSizes[OldId] -= NrRelabelled;
+	if (ComponentSizes[OldId] == 0)
+	{
+		FreeIds.push_back(OldId);
+	}
+	return NrRelabelled;
+}
+
+int ConnectedComponents::FindGroup(int SearchIdx)
+{
+	while (Searches[SearchIdx].Group != SearchIdx)
+	{
+		Searches[SearchIdx].Group = Searches[Searches[SearchIdx].Group].Group;
+		SearchIdx = Searches[SearchIdx].Group;
+	}
+	return SearchIdx;
+}
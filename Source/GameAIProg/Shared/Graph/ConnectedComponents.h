@@ -0,0 +1,80 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace GameAI
+{
+	class Graph;
+
+	// Connected component id per node, so a search can tell in O(1) that its goal can't be reached.
+	// Built with union-find over the connections. After that it's repaired locally: new connections merge the
+	// smaller components into the biggest one, and lost connections start a breadth first search from every former
+	// neighbour. These run in lock step, and as soon as only one of them is still going the pieces that are done get
+	// new ids, so only the split off parts are visited. Directed graphs get their weakly connected components:
+	// different ids still mean unreachable, the same id doesn't promise a path
+	class ConnectedComponents final
+	{
+	public:
+		static int constexpr InvalidComponent = -1;
+
+		void Rebuild(Graph const& Graph);
+
+		// Call after connections of NodeId were added, e.g. a cell that became walkable
+		void OnConnectionsAdded(Graph const& Graph, int NodeId);
+		// Call after connections of NodeId were removed, FormerNeighbours are the nodes it lost a connection with
+		void OnConnectionsRemoved(Graph const& Graph, int NodeId, std::span<int const> FormerNeighbours);
+		// Call after changes that keep the connections, e.g. new costs, so the ids stay up to date
+		void OnCostsChanged(Graph const& Graph);
+
+		// False after a change the ids weren't repaired for, call Rebuild then
+		bool IsUpToDate(Graph const& Graph) const;
+
+		int GetComponentId(int NodeId) const { return ComponentIds[NodeId]; }
+		bool AreConnected(int FromId, int ToId) const
+		{
+			return ComponentIds[FromId] != InvalidComponent && ComponentIds[FromId] == ComponentIds[ToId];
+		}
+		int GetComponentSize(int ComponentId) const { return ComponentSizes[ComponentId]; }
+
+		// Stats
+		int GetComponentCount() const { return static_cast<int>(ComponentSizes.size() - FreeIds.size()); }
+		double GetBuildTimeMs() const { return BuildTimeMs; }
+		double GetLastUpdateTimeMs() const { return LastUpdateTimeMs; }
+		int GetLastVisitedCount() const { return LastNrVisited; } // nodes relabelled or searched by the last repair
+		size_t GetAllocatedBytes() const;
+
+	private:
+		// One breadth first search of a split repair
+		struct PieceSearch
+		{
+			std::vector<int> Visited{}; // in visiting order, the ones from NrExpanded on are the queue
+			int NrExpanded{0};
+			int Group; // searches that met form one piece, union-find over the searches
+			bool bIsDone{false}; // piece got its id, only set on the group's root
+		};
+
+		std::vector<int> ComponentIds{};
+		std::vector<int> ComponentSizes{}; // by component id, 0 for a free id
+		std::vector<int> FreeIds{};
+		uint32 Version{0}; // of the graph the ids are for
+
+		// Scratch
+		std::vector<int> SearchOfNode{}; // InvalidComponent unless visited by the running repair
+		std::vector<PieceSearch> Searches{};
+		std::vector<int> RelabelQueue{};
+		std::vector<uint8_t> GroupStates{};
+
+		double BuildTimeMs{0.0};
+		double LastUpdateTimeMs{0.0};
+		int LastNrVisited{0};
+
+		int NewComponentId();
+		int Relabel(Graph const& Graph, int FromNodeId, int NewComponentId); // returns the number of relabelled nodes
+		int FindGroup(int SearchIdx);
+
+		template<typename Callback>
+		static void ForEachNeighbour(Graph const& Graph, int NodeId, Callback&& OnNeighbour);
+	};
+}
@@ -99,7 +99,13 @@ namespace GameAI
     }
 
     Graph::Graph(Graph const & Other)
+        : Graph(Other, true)
+    {
+    }
+
+    Graph::Graph(Graph const & Other, bool bCopyConnections)
         : bIsDirectional{Other.bIsDirectional}
+        , Version{Other.Version}
     {
         Nodes.reserve(Other.Nodes.size());
         for (std::unique_ptr<Node> const & OtherNode : Other.Nodes)
@@ -107,6 +113,8 @@ namespace GameAI
             Nodes.push_back(std::make_unique<Node>(*OtherNode.get()));
         }
         
+        if (!bCopyConnections) return;
+
         Connections.reserve(Other.Connections.size());
         for (std::unique_ptr<Connection> const & OtherConnection : Other.Connections)
         {
@@ -180,6 +188,7 @@ namespace GameAI
 
         NewNode->SetId(static_cast<int>(Nodes.size()));
         Nodes.push_back(std::move(NewNode));
+        MarkAdjacencyDirty(); // offset table needs a slot for the new node
         return Nodes.back()->GetId();
     }
 
@@ -199,6 +208,7 @@ namespace GameAI
             {
                 return Connection->GetFromId() == NodeToRemoveId || Connection->GetToId() == NodeToRemoveId;
             });
+        MarkAdjacencyDirty();
 
         // Mark node as invalid (keep it in the vector to preserve indices)
         Nodes[NodeToRemoveId]->SetId(Graphs::InvalidNodeId);
@@ -213,39 +223,51 @@ namespace GameAI
 
     std::vector<std::unique_ptr<Connection>>& Graph::GetConnections()
     {
+        // Callers may add or remove connections through this reference
+        MarkAdjacencyDirty();
         return Connections;
     }
 
     Connection* Graph::FindConnection(int FromId, int ToId)
     {
-        auto it = std::find_if(Connections.begin(), Connections.end(),
-            [=](auto const& Element)
-            {
-                return Element->GetFromId() == FromId && Element->GetToId() == ToId;
-            });
-        return it != Connections.end() ? it->get() : nullptr;
+        auto const Outgoing = GetConnectionsFrom(FromId);
+        auto it = std::ranges::find_if(Outgoing,
+            [=](Connection const* Element) { return Element->GetToId() == ToId; });
+        return it != Outgoing.end() ? *it : nullptr;
     }
 
     std::vector<Connection*> Graph::FindConnectionsFrom(int NodeId) const
     {
-        std::vector<Connection*> Result{};
-        for (auto& Connection : Connections)
+        auto const Outgoing = GetConnectionsFrom(NodeId);
+        return std::vector<Connection*>{Outgoing.begin(), Outgoing.end()};
+    }
+
+    std::vector<Connection*> Graph::FindConnectionsTo(int NodeId) const
+    {
+        auto const Incoming = GetConnectionsTo(NodeId);
+        return std::vector<Connection*>{Incoming.begin(), Incoming.end()};
+    }
+
+    std::span<Connection* const> Graph::GetConnectionsFrom(int NodeId) const
+    {
+        if (bAdjacencyDirty) RebuildAdjacency();
+        
+        if (NodeId < 0 || NodeId + 1 >= static_cast<int>(OutOffsets.size()))
         {
-            if (Connection->GetFromId() == NodeId)
-                Result.push_back(Connection.get());
+            return {};
         }
-        return Result;
+        return std::span<Connection* const>{OutEdges.data() + OutOffsets[NodeId], OutEdges.data() + OutOffsets[NodeId + 1]};
     }
 
-    std::vector<Connection*> Graph::FindConnectionsTo(int NodeId) const
+    std::span<Connection* const> Graph::GetConnectionsTo(int NodeId) const
     {
-        std::vector<Connection*> Result{};
-        for (auto& Connection : Connections)
+        if (bAdjacencyDirty) RebuildAdjacency();
+        
+        if (NodeId < 0 || NodeId + 1 >= static_cast<int>(InOffsets.size()))
         {
-            if (Connection->GetToId() == NodeId)
-                Result.push_back(Connection.get());
+            return {};
         }
-        return Result;
+        return std::span<Connection* const>{InEdges.data() + InOffsets[NodeId], InEdges.data() + InOffsets[NodeId + 1]};
     }
 
     std::vector<Connection*> Graph::FindConnectionsWith(int NodeId) const
@@ -264,14 +286,24 @@ namespace GameAI
         auto InverseNew = NewConnection->GetInverseCopy();
         
         // Check if the connection already exists
-        auto Found = std::find_if(Connections.begin(), Connections.end(),
-            [&](auto const& Existing)
-            {
-                return Existing->GetFromId() == NewConnection->GetFromId() &&
-                       Existing->GetToId() == NewConnection->GetToId();
-            });
+        // (the index is only used while clean, a batch of adds would otherwise rebuild it every call)
+        bool bAlreadyExists{false};
+        if (!bAdjacencyDirty)
+        {
+            bAlreadyExists = std::ranges::any_of(GetConnectionsFrom(NewConnection->GetFromId()),
+                [&](Connection const* Existing) { return Existing->GetToId() == NewConnection->GetToId(); });
+        }
+        else
+        {
+            bAlreadyExists = std::ranges::any_of(Connections,
+                [&](auto const& Existing)
+                {
+                    return Existing->GetFromId() == NewConnection->GetFromId() &&
+                           Existing->GetToId() == NewConnection->GetToId();
+                });
+        }
 
-        if (Found != Connections.end())
+        if (bAlreadyExists)
         {
             UE_LOG(LogTemp, Warning, TEXT("Attempted to add a connection already in the graph!"));
             return;
@@ -285,6 +317,8 @@ namespace GameAI
             // Also add the inverse connection
             Connections.push_back(std::make_unique<Connection>(InverseNew));
         }
+        
+        MarkAdjacencyDirty();
     }
 
     void Graph::AddConnection(int FromNodeId, int ToNodeId)
@@ -294,12 +328,13 @@ namespace GameAI
 
     bool Graph::RemoveConnection(Connection const* ConnectionToRemove)
     {
-        // Stored for later use
+        // Stored for later use (ConnectionToRemove may point into Connections and die during the erase)
+        Connection const ToRemove = *ConnectionToRemove;
         auto InverseConnection = ConnectionToRemove->GetInverseCopy();
 			
         int AmountRemoved{0};
         AmountRemoved += std::erase_if(Connections,
-            [&](std::unique_ptr<Connection> const & Element){return *Element.get() == *ConnectionToRemove;});
+            [&](std::unique_ptr<Connection> const & Element){return *Element.get() == ToRemove;});
         if (!bIsDirectional)
         {
             // Remove the inverse
@@ -307,6 +342,10 @@ namespace GameAI
                 [&](std::unique_ptr<Connection> const & Element){return *Element.get() == InverseConnection;});
         }
 			
+        if (AmountRemoved > 0)
+        {
+            MarkAdjacencyDirty();
+        }
         return AmountRemoved > 0;
     }
 
@@ -324,12 +363,14 @@ namespace GameAI
 
     bool Graph::RemoveConnectionsFrom(int FromId)
     {
+        MarkAdjacencyDirty();
         return 0 < std::erase_if(Connections,
             [=](auto const & Connection){return Connection->GetFromId() == FromId;});
     }
 
     bool Graph::RemoveConnectionsTo(int ToId)
     {
+        MarkAdjacencyDirty();
         return 0 < std::erase_if(Connections,
     [=](auto const & Connection){return Connection->GetToId() == ToId;});
     }
@@ -351,6 +392,61 @@ namespace GameAI
             FVector2D BetweenNodes{GetNode(Connection->GetFromId())->GetPosition() - GetNode(Connection->GetToId())->GetPosition()};
             Connection->SetWeight(BetweenNodes.Length());
         }
+        BumpVersion();
+    }
+
+    void Graph::RebuildAdjacency() const
+    {
+        int const NrSlots = static_cast<int>(Nodes.size());
+        BuildCompressedRows(Connections, NrSlots, true, OutOffsets, OutEdges);
+        BuildCompressedRows(Connections, NrSlots, false, InOffsets, InEdges);
+        bAdjacencyDirty = false;
+    }
+
+    size_t Graph::GetAllocatedBytes(size_t NodeSize) const
+    {
+        return Nodes.capacity() * sizeof(std::unique_ptr<Node>) + Nodes.size() * NodeSize
+            + Connections.capacity() * sizeof(std::unique_ptr<Connection>) + Connections.size() * sizeof(Connection)
+            + (OutOffsets.capacity() + InOffsets.capacity()) * sizeof(int)
+            + (OutEdges.capacity() + InEdges.capacity()) * sizeof(Connection*);
+    }
+
+    void Graph::BuildCompressedRows(std::vector<std::unique_ptr<Connection>> const& Connections, int NrSlots,
+        bool bByFromId, std::vector<int>& Offsets, std::vector<Connection*>& Edges)
+    {
+        auto const KeyOf = [bByFromId](Connection const& Connection)
+        {
+            return bByFromId ? Connection.GetFromId() : Connection.GetToId();
+        };
+        
+        // Count the edges per node, shifted by one so the prefix sum yields start offsets
+        Offsets.assign(NrSlots + 1, 0);
+        for (auto const& Connection : Connections)
+        {
+            // The ids index the offsets directly, a dangling connection would write out of bounds
+            int const Key = KeyOf(*Connection);
+            checkf(Key >= 0 && Key < NrSlots, TEXT("Connection %d -> %d points outside the %d node slots"),
+                Connection->GetFromId(), Connection->GetToId(), NrSlots);
+            ++Offsets[Key + 1];
+        }
+        for (int Slot{0}; Slot < NrSlots; ++Slot)
+        {
+            Offsets[Slot + 1] += Offsets[Slot];
+        }
+
+        // Scatter, using Offsets[Node] as write cursor (keeps insertion order per node)
+        Edges.resize(Connections.size());
+        for (auto const& Connection : Connections)
+        {
+            Edges[Offsets[KeyOf(*Connection)]++] = Connection.get();
+        }
+
+        // Every cursor now sits on the start of the next node, shift them back
+        for (int Slot{NrSlots}; Slot > 0; --Slot)
+        {
+            Offsets[Slot] = Offsets[Slot - 1];
+        }
+        Offsets[0] = 0;
     }
 
     std::optional<int> Graph::GetFirstInvalidNodeIdx() const
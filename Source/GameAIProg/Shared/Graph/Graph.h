@@ -4,6 +4,7 @@
 #include <vector>
 #include <algorithm>
 #include <ranges>
+#include <span>
 
 namespace GameAI
 {
@@ -83,7 +84,8 @@ namespace GameAI
     {
     public:
         explicit Graph(bool isDirectional = false);
-        explicit Graph(Graph const & Other);
+        explicit Graph(Graph const & Other); // keeps the version, version checks can't tell a copy from its source
+        virtual ~Graph() = default; // polymorphic, searches check whether they got a grid
 
         // --- Nodes --------------------------------------------------------
         std::vector<std::unique_ptr<Node>> const& GetNodes() const;
@@ -119,6 +121,10 @@ namespace GameAI
         std::vector<Connection*> FindConnectionsTo(int NodeId) const;
         std::vector<Connection*> FindConnectionsWith(int NodeId) const;
 
+        // Non-allocating views into the adjacency index, invalidated by any graph mutation
+        std::span<Connection* const> GetConnectionsFrom(int NodeId) const;
+        std::span<Connection* const> GetConnectionsTo(int NodeId) const;
+
         void AddConnection(std::unique_ptr<Connection> NewConnection);
         void AddConnection(int FromNodeId, int ToNodeId);
 
@@ -134,11 +140,42 @@ namespace GameAI
         // Helper
         void SetConnectionCostsToDistances();
 
+        // --- Adjacency index ----------------------------------------------
+        // Rebuilt lazily on the first query after a mutation. Call this up front
+        // when the graph is about to be read from several threads.
+        void RebuildAdjacency() const;
+        bool IsAdjacencyDirty() const { return bAdjacencyDirty; }
+
+        // Bumped by every change to the nodes, connections or their costs.
+        // Caches of search results (e.g. PathCache) key on it to tell when they went stale
+        uint32 GetVersion() const { return Version; }
+
+        // Memory held by the nodes, connections and adjacency index, for stats.
+        // NodeSize is the size of the node type the graph stores
+        size_t GetAllocatedBytes(size_t NodeSize = sizeof(Node)) const;
+
     protected:
+        Graph(Graph const & Other, bool bCopyConnections); // without them for copies that never follow a connection
+
         std::optional<int> GetFirstInvalidNodeIdx() const;
+        void MarkAdjacencyDirty() { bAdjacencyDirty = true; BumpVersion(); }
+        void BumpVersion() { ++Version; } // for changes that keep the connections, like new costs
         
         bool const bIsDirectional;
         std::vector<std::unique_ptr<Node>> Nodes;
         std::vector<std::unique_ptr<Connection>> Connections;
+
+    private:
+        // Compressed sparse row layout: the connections leaving node N are
+        // OutEdges[OutOffsets[N] .. OutOffsets[N + 1]), same for incoming ones
+        mutable std::vector<int> OutOffsets;
+        mutable std::vector<Connection*> OutEdges;
+        mutable std::vector<int> InOffsets;
+        mutable std::vector<Connection*> InEdges;
+        mutable bool bAdjacencyDirty{true};
+        uint32 Version{0};
+
+        static void BuildCompressedRows(std::vector<std::unique_ptr<Connection>> const& Connections, int NrSlots,
+            bool bByFromId, std::vector<int>& Offsets, std::vector<Connection*>& Edges);
     };
 }
@@ -14,6 +14,11 @@ std::unordered_map<GridGraph::Direction, FIntVector2> GridGraph::DirectionDeltas
 	{Direction::NorthWest, {1, -1}},
 };
 
+FIntVector2 const GridGraph::NeighbourDeltas[NrDirections]
+{
+	{1, 0}, {1, 1}, {0, 1}, {-1, 1}, {-1, 0}, {-1, -1}, {0, -1}, {1, -1}
+};
+
 GridGraph::GridGraph(IGraphNodeFactory* Factory, int Rows, int Cols, float CellSize, float Cost, FVector2D const& OriginPosition,
 	bool IsDiagonallyConnected, bool IsDirectional)
 	: Graph(IsDirectional)
@@ -41,13 +46,59 @@ GridGraph::GridGraph(IGraphNodeFactory* Factory, int Rows, int Cols, float CellS
 	}
 
 	// Create connections in each valid direction on each node
+	// Every node emits its own outgoing connections, which already covers both directions of an undirected grid.
+	// They're appended directly, going through AddConnection would scan for duplicates on every call
+	int const DirectionIncrement = !bIsDiagonallyConnected ? 2 : 1;
+	Connections.reserve(static_cast<size_t>(Rows) * Cols * (8 / DirectionIncrement));
 	for (int Row = 0; Row < NrRows; ++Row)
 	{
 		for (int Col = 0; Col < NrColumns; ++Col)
 		{
-			AddConnectionsToAdjacentCells(GetNodeId(Col, Row));
+			for (int DirectionAsInt{static_cast<int>(Direction::North)}; 
+				DirectionAsInt < static_cast<int>(Direction::LAST); DirectionAsInt += DirectionIncrement)
+			{
+				FIntVector2 const PosAtDelta = FIntVector2{Col, Row} + DirectionDeltas[static_cast<Direction>(DirectionAsInt)];
+				if (!IsWithinBounds(PosAtDelta.X, PosAtDelta.Y)) continue;
+
+				auto NewConnection{std::make_unique<Connection>(GetNodeId(Col, Row), GetNodeId(PosAtDelta.X, PosAtDelta.Y))};
+				NewConnection->SetWeight(IsCardinal(static_cast<Direction>(DirectionAsInt)) ? GetCardinalCost() : GetDiagonalCost());
+				Connections.push_back(std::move(NewConnection));
+			}
 		}
 	}
+	MarkAdjacencyDirty();
+
+	// Every cell walkable at the lowest cost class, the bits past the last cell stay 0
+	int const NrCells = Rows * Cols;
+	WalkableBits.assign((NrCells + 63) / 64, ~0ull);
+	if (NrCells % 64 != 0)
+	{
+		WalkableBits.back() = (1ull << (NrCells % 64)) - 1;
+	}
+	CostClasses.assign(NrCells, 0);
+	CostClassMultipliers.fill(1.f);
+	SyncCellLayer();
+}
+
+GridGraph::GridGraph(GridGraph const& Other, bool bCopyConnections)
+	: Graph(Other, bCopyConnections)
+	, GridOrigin{Other.GridOrigin}
+	, NrRows{Other.NrRows}
+	, NrColumns{Other.NrColumns}
+	, CellSize{Other.CellSize}
+	, CostStraight{Other.CostStraight}
+	, CostDiagonal{Other.CostDiagonal}
+	, bIsDiagonallyConnected{Other.bIsDiagonallyConnected}
+	, WalkableBits{Other.WalkableBits}
+	, CostClasses{Other.CostClasses}
+	, CostClassMultipliers{Other.CostClassMultipliers}
+	, CellLayerVersion{Other.CellLayerVersion}
+{
+}
+
+std::unique_ptr<GridGraph> GridGraph::CopyCellLayer() const
+{
+	return std::unique_ptr<GridGraph>(new GridGraph{*this, false});
 }
 
 int GridGraph::GetNodeIdAtPosition(FVector2D const& Position) const
@@ -82,7 +133,7 @@ FVector2D GridGraph::GetNodePosition(int Index) const
 
 FIntVector2 GridGraph::GetColAndRow(int Index) const
 {
-	return { Index % NrColumns, Index / NrRows }; // Col, Row
+	return { Index % NrColumns, Index / NrColumns }; // Col, Row
 }
 
 std::unique_ptr<Node> const& GridGraph::GetNode(int Row, int Col) const
@@ -118,17 +169,10 @@ void GridGraph::AddConnectionsToAdjacentCells(int NodeId)
 		FIntVector2 const PosDelta = DirectionDeltas[static_cast<Direction>(DirectionAsInt)];
 		FIntVector2 const PosAtDelta = NodeColRow + PosDelta;
 
-		if (IsWithinBounds(PosAtDelta.X, PosAtDelta.Y))
+		if (IsWalkable(PosAtDelta.X, PosAtDelta.Y))
 		{
 			auto NewConnection{std::make_unique<Connection>(NodeId, GetNodeId(PosAtDelta.X, PosAtDelta.Y))};
-			if (IsCardinal(static_cast<Direction>(DirectionAsInt)))
-			{
-				NewConnection->SetWeight(GetCardinalCost());
-			}
-			else
-			{
-				NewConnection->SetWeight(GetDiagonalCost());
-			}
+			NewConnection->SetWeight(GetStepCost(NodeId, NewConnection->GetToId()));
 			
 			// This will cause warnings with already existing connections, that is fine :)
 			AddConnection(std::move(NewConnection));
@@ -150,6 +194,25 @@ void GridGraph::DebugDrawCells(UWorld const * const World) const
 	}
 }
 
+float GridGraph::GetStepCost(int FromId, int ToId) const
+{
+	FIntVector2 const FromCell = GetColAndRow(FromId);
+	FIntVector2 const ToCell = GetColAndRow(ToId);
+	float const StepCost = FromCell.X == ToCell.X || FromCell.Y == ToCell.Y ? CostStraight : CostDiagonal;
+	return StepCost * std::max(CostClassMultipliers[CostClasses[FromId]], CostClassMultipliers[CostClasses[ToId]]);
+}
+
+size_t GridGraph::GetCellLayerBytes() const
+{
+	return WalkableBits.capacity() * sizeof(uint64_t) + CostClasses.capacity() * sizeof(uint8_t);
+}
+
+void GridGraph::SetCellWalkable(int NodeId, bool bIsWalkable)
+{
+	uint64_t const Bit = 1ull << (NodeId & 63);
+	WalkableBits[NodeId >> 6] = bIsWalkable ? WalkableBits[NodeId >> 6] | Bit : WalkableBits[NodeId >> 6] & ~Bit;
+}
+
 bool GridGraph::IsCardinal(Direction Direction)
 {
 	// works due to ordering of the enum
@@ -1,5 +1,7 @@
 ﻿#pragma once
 #include "Shared/Graph/Graph.h"
+#include <array>
+#include <cstdint>
 #include <memory>
 #include <unordered_map>
 
@@ -31,6 +33,7 @@ namespace GameAI
 		int GetRows() const { return NrRows; }
 		int GetColumns() const { return NrColumns; }
 		float GetCellSize() const { return CellSize; }
+		bool IsDiagonallyConnected() const { return bIsDiagonallyConnected; }
 		
 		int GetNodeId(int Col, int Row) const { return Row * NrColumns + Col; }
 		int GetNodeIdAtPosition(FVector2D const& Position) const;
@@ -50,12 +53,60 @@ namespace GameAI
 		
 		float GetCardinalCost() const { return CostStraight; }
 		float GetDiagonalCost() const { return CostDiagonal; }
+		
+		// Grid layout queries for searches that work on cells instead of connections
+		bool IsWalkable(int Col, int Row) const { return IsWithinBounds(Col, Row) && IsWalkable(GetNodeId(Col, Row)); }
+		bool IsWalkable(int NodeId) const { return (WalkableBits[NodeId >> 6] >> (NodeId & 63)) & 1; }
+		virtual bool HasUniformCosts() const { return true; }
+
+		// Dense cell layer next to the nodes and connections: a walkable bit and a cost class byte per cell, by node id.
+		// A step costs the cardinal or diagonal cost times the multiplier of the costlier of its two cells.
+		// Grid searches read neighbours from it by index arithmetic while it matches the connections, i.e. as long as
+		// the graph was only edited by the grid itself (painting), see IsCellLayerInSync
+		uint8_t GetCostClass(int NodeId) const { return CostClasses[NodeId]; }
+		float GetStepCost(int FromId, int ToId) const;
+		bool IsCellLayerInSync() const { return CellLayerVersion == GetVersion(); }
+		size_t GetCellLayerBytes() const; // of the per cell arrays
+
+		// Nodes and cell layer without the connections, e.g. a snapshot for searches on other threads.
+		// Much cheaper than a full copy, grid searches read it the same while this grid's cell layer is in sync
+		std::unique_ptr<GridGraph> CopyCellLayer() const;
+
+		// Calls OnNeighbour(NeighbourId, StepCost) for the walkable cells around a walkable cell,
+		// in the same order the grid creates its connections
+		template<typename Callback>
+		void ForEachWalkableNeighbour(int NodeId, Callback&& OnNeighbour) const
+		{
+			if (!IsWalkable(NodeId)) return;
+
+			int const Col = NodeId % NrColumns;
+			int const Row = NodeId / NrColumns;
+			float const Multiplier = CostClassMultipliers[CostClasses[NodeId]];
+			int const DirectionIncrement = !bIsDiagonallyConnected ? 2 : 1;
+			for (int DirectionIdx = 0; DirectionIdx < NrDirections; DirectionIdx += DirectionIncrement)
+			{
+				FIntVector2 const Delta = NeighbourDeltas[DirectionIdx];
+				if (!IsWithinBounds(Col + Delta.X, Row + Delta.Y)) continue;
+
+				int const NeighbourId = NodeId + Delta.Y * NrColumns + Delta.X;
+				if (!IsWalkable(NeighbourId)) continue;
+
+				float const StepCost = DirectionIdx % 2 == 0 ? CostStraight : CostDiagonal;
+				OnNeighbour(NeighbourId, StepCost * std::max(Multiplier, CostClassMultipliers[CostClasses[NeighbourId]]));
+			}
+		}
 
 		static bool IsCardinal(Direction Direction);
 		bool IsCardinalConnection(int FromId, int ToId);
 		
 	protected:
 		static std::unordered_map<Direction, FIntVector2> DirectionDeltas;
+
+		// Cell layer edits, SyncCellLayer after an edit that kept it in line with the connections
+		void SetCellWalkable(int NodeId, bool bIsWalkable);
+		void SetCellCostClass(int NodeId, uint8_t CostClass) { CostClasses[NodeId] = CostClass; }
+		void SetCostClassMultiplier(uint8_t CostClass, float Multiplier) { CostClassMultipliers[CostClass] = Multiplier; }
+		void SyncCellLayer() { CellLayerVersion = GetVersion(); }
 		FVector2D GridOrigin; // bottom left
 		
 		int NrRows;
@@ -66,5 +117,16 @@ namespace GameAI
 		float CostDiagonal;
 		
 		bool bIsDiagonallyConnected;
+
+	private:
+		GridGraph(GridGraph const& Other, bool bCopyConnections);
+
+		static int constexpr NrDirections = static_cast<int>(Direction::LAST);
+		static FIntVector2 const NeighbourDeltas[NrDirections]; // DirectionDeltas as an array, cardinals at even indices
+
+		std::vector<uint64_t> WalkableBits{};
+		std::vector<uint8_t> CostClasses{};
+		std::array<float, 256> CostClassMultipliers{};
+		uint32 CellLayerVersion{0};
 	};
 }
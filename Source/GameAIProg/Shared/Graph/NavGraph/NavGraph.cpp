@@ -1,7 +1,5 @@
 ﻿#include "NavGraph.h"
 #include "NavGraphNode.h"
-#include <map>
-#include <set>
 
 using namespace GameAI;
 
@@ -9,11 +7,19 @@ NavGraph::NavGraph(std::unique_ptr<TriPolygon> && NavPoly)
     : Graph{false}
     , pNavPoly{std::move(NavPoly)}
 {
+    // The polygon is complete once it's handed over, every path query looks up positions in it
+    pNavPoly->BuildSpatialIndex();
     CreateNavigationGraph();
 }
 
+NavGraph::NavGraph()
+    : Graph{false}
+{
+}
+
 NavGraph::NavGraph(const NavGraph& Other)
     : Graph(false)
+    , NodeIdOfEdge{Other.NodeIdOfEdge}
 {
     // Copy nodes
     Nodes.reserve(Other.Nodes.size());
@@ -37,20 +43,20 @@ std::unique_ptr<NavGraph> NavGraph::Clone() const
 
 int NavGraph::GetNodeIdFromEdgeIndex(int EdgeIdx) const
 {
-    if (EdgeIdx >= 0)
+    if (EdgeIdx >= 0 && EdgeIdx < static_cast<int>(NodeIdOfEdge.size()))
     {
-       for (auto const & pNode : Nodes)
-       {
-          if (reinterpret_cast<NavGraphNode*>(pNode.get())->GetEdgeIdx() == EdgeIdx)
-          {
-             return pNode->GetId();
-          }
-       }
+        return NodeIdOfEdge[EdgeIdx];
     }
     
     return Graphs::InvalidNodeId;
 }
 
+size_t NavGraph::GetAllocatedBytes() const
+{
+    return Graph::GetAllocatedBytes(sizeof(NavGraphNode)) + NodeIdOfEdge.capacity() * sizeof(int)
+        + (pNavPoly ? pNavPoly->GetAllocatedBytes() : 0);
+}
+
 int NavGraph::GetNodeIdAtPosition(FVector2D const& Position) const
 {
     // Find triangle at position
@@ -58,9 +64,8 @@ int NavGraph::GetNodeIdAtPosition(FVector2D const& Position) const
     if (pTriangle != nullptr)
     {
         // Return first valid portal node
-        for (auto const& edge : pTriangle->GetEdges())
+        for (int edgeIdx : pNavPoly->GetTriangleEdgeIds(pNavPoly->GetTriangleIndex(*pTriangle)))
         {
-            int edgeIdx = pNavPoly->FindEdgeIndex(edge).value_or(-1);
             int nodeId = GetNodeIdFromEdgeIndex(edgeIdx);
             if (nodeId != Graphs::InvalidNodeId)
             {
@@ -75,78 +80,67 @@ int NavGraph::GetNodeIdAtPosition(FVector2D const& Position) const
 void NavGraph::CreateNavigationGraph()
 {
     auto const& triangles = pNavPoly->GetTriangles();
-    std::map<int, int> edgeUsage;
-
-    // Count how many triangles share each edge
-    for (auto const& triangle : triangles)
-    {
-        for (auto const& edge : triangle.GetEdges())
-        {
-            int edgeIdx = pNavPoly->FindEdgeIndex(edge).value_or(-1);
-            if (edgeIdx != -1)
-            {
-                edgeUsage[edgeIdx]++;
-            }
-        }
-    }
+    NodeIdOfEdge.assign(pNavPoly->GetEdges().size(), Graphs::InvalidNodeId);
+    Nodes.reserve(pNavPoly->GetEdges().size());
+    Connections.reserve(triangles.size() * 6);
 
-    std::set<int> createdEdges;
-
-    // Create nodes and connections
-    for (auto const& triangle : triangles)
+    // Create nodes and connections, everything is a table lookup so this is linear in the triangle count
+    for (int triIdx = 0; triIdx < static_cast<int>(triangles.size()); ++triIdx)
     {
-        auto vertices = triangle.GetVertices(*pNavPoly);
-        auto edges = triangle.GetEdges();
+        auto vertices = triangles[triIdx].GetVertices(*pNavPoly);
+        auto const& edgeIds = pNavPoly->GetTriangleEdgeIds(triIdx);
 
         std::vector<int> validNodeIds;
 
         // Check triangle edges
-        for (size_t i = 0; i < edges.size(); ++i)
+        for (size_t i = 0; i < edgeIds.size(); ++i)
         {
-            int edgeIdx = pNavPoly->FindEdgeIndex(edges[i]).value_or(-1);
+            int edgeIdx = edgeIds[i];
 
             // Shared edge = portal
-            if (edgeIdx != -1 && edgeUsage[edgeIdx] > 1)
+            if (pNavPoly->IsSharedEdge(edgeIdx))
             {
                 // Create node once per edge
-                if (createdEdges.find(edgeIdx) == createdEdges.end())
+                if (NodeIdOfEdge[edgeIdx] == Graphs::InvalidNodeId)
                 {
                     FVector v0 = vertices[i];
                     FVector v1 = vertices[(i + 1) % 3];
                     FVector2D centerPos = FVector2D((v0.X + v1.X) / 2.0f, (v0.Y + v1.Y) / 2.0f);
 
                     auto pNode = std::make_unique<NavGraphNode>(centerPos, edgeIdx);
-                    AddNode(std::move(pNode));
-                    createdEdges.insert(edgeIdx);
+                    pNode->SetId(static_cast<int>(Nodes.size()));
+                    NodeIdOfEdge[edgeIdx] = pNode->GetId();
+                    Nodes.push_back(std::move(pNode));
                 }
 
-                int nodeId = GetNodeIdFromEdgeIndex(edgeIdx);
-                if (nodeId != Graphs::InvalidNodeId)
-                {
-                    validNodeIds.push_back(nodeId);
-                }
+                validNodeIds.push_back(NodeIdOfEdge[edgeIdx]);
             }
         }
 
         // Connect portals inside triangle
         if (validNodeIds.size() == 2)
         {
-            AddConnection(std::make_unique<Connection>(validNodeIds[0], validNodeIds[1]));
-            AddConnection(std::make_unique<Connection>(validNodeIds[1], validNodeIds[0]));
+            AddPortalConnection(validNodeIds[0], validNodeIds[1]);
         }
         else if (validNodeIds.size() == 3)
         {
-            AddConnection(std::make_unique<Connection>(validNodeIds[0], validNodeIds[1]));
-            AddConnection(std::make_unique<Connection>(validNodeIds[1], validNodeIds[0]));
-            
-            AddConnection(std::make_unique<Connection>(validNodeIds[1], validNodeIds[2]));
-            AddConnection(std::make_unique<Connection>(validNodeIds[2], validNodeIds[1]));
-            
-            AddConnection(std::make_unique<Connection>(validNodeIds[2], validNodeIds[0]));
-            AddConnection(std::make_unique<Connection>(validNodeIds[0], validNodeIds[2]));
+            AddPortalConnection(validNodeIds[0], validNodeIds[1]);
+            AddPortalConnection(validNodeIds[1], validNodeIds[2]);
+            AddPortalConnection(validNodeIds[2], validNodeIds[0]);
         }
     }
+    MarkAdjacencyDirty();
     
     // Set connection costs
     SetConnectionCostsToDistances();
-}
\ No newline at end of file
+
+    // Queries only read the graph from here on, possibly from several threads
+    RebuildAdjacency();
+}
+
+void NavGraph::AddPortalConnection(int FromId, int ToId)
+{
+    // Two triangles never share two edges, so every portal pair is only seen once
+    Connections.push_back(std::make_unique<Connection>(FromId, ToId));
+    Connections.push_back(std::make_unique<Connection>(ToId, FromId));
+}
@@ -6,6 +6,8 @@ namespace GameAI
 {
 	class NavGraph : public Graph
 	{
+		friend class NavMeshCache; // restores a graph without rebuilding it
+		
 	public:
 		explicit NavGraph(std::unique_ptr<TriPolygon> && NavPoly);
 		NavGraph(const NavGraph& Other);
@@ -16,9 +18,15 @@ namespace GameAI
 		int GetNodeIdFromEdgeIndex(int EdgeIdx) const;
 		int GetNodeIdAtPosition(FVector2D const& Position) const;
 		
+		size_t GetAllocatedBytes() const; // graph and polygon, for stats
+		
 	private:
+		NavGraph(); // empty, for NavMeshCache
+		
 		std::unique_ptr<TriPolygon> pNavPoly;
+		std::vector<int> NodeIdOfEdge{}; // portal node per polygon edge, InvalidNodeId for border edges
 
 		void CreateNavigationGraph();
+		void AddPortalConnection(int FromId, int ToId); // both directions, skips Graph::AddConnection's duplicate scan
 	};
 }
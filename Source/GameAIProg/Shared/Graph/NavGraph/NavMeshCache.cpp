@@ -0,0 +1,278 @@
+﻿#include "NavMeshCache.h"
+
+#include <cstring>
+#include <type_traits>
+#include <vector>
+#include "NavGraph.h"
+#include "NavGraphNode.h"
+#include "Async/MappedFileHandle.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/Crc.h"
+#include "Misc/FileHelper.h"
+
+using namespace GameAI;
+
+namespace
+{
+    uint32 constexpr Magic = 0x48534D4E; // "NMSH"
+
+    enum Section : int32
+    {
+        SectionVertices,
+        SectionEdges,
+        SectionTriangles,
+        SectionTriangleEdges,
+        SectionEdgeTriangles,
+        SectionTriangleCellOffsets,
+        SectionTriangleCellIds,
+        SectionEdgeCellOffsets,
+        SectionEdgeCellIds,
+        SectionPortalNodes,
+        SectionPortalConnections,
+        SectionNodeIdOfEdge,
+        NrSections
+    };
+
+    struct SectionEntry
+    {
+        uint64 Offset;
+        uint64 Count;
+    };
+
+    struct PortalNode
+    {
+        double X, Y;
+        int32 EdgeIdx;
+        int32 Padding;
+    };
+
+    struct PortalConnection
+    {
+        int32 FromId;
+        int32 ToId;
+        float Weight;
+    };
+
+    struct FileHeader
+    {
+        uint32 Magic;
+        uint32 Version;
+        uint32 SourceHash;
+        uint32 PayloadCrc; // of everything after the header
+        uint64 FileSize;
+        double WeldDistance;
+        double GridOriginX;
+        double GridOriginY;
+        double CellSize;
+        int32 NrColumns;
+        int32 NrRows;
+        int32 bHasSpatialIndex;
+        int32 Padding;
+        SectionEntry Sections[NrSections];
+    };
+
+    // The arrays are copied as they are in memory, these layouts are what the file format assumes
+    static_assert(sizeof(FVector) == 3 * sizeof(double), "Vertices are stored as three doubles");
+    static_assert(sizeof(TriPolygon::Edge) == 2 * sizeof(int32) && sizeof(TriPolygon::Triangle) == 3 * sizeof(int32));
+    static_assert(std::is_trivially_copyable_v<TriPolygon::Edge> && std::is_trivially_copyable_v<TriPolygon::Triangle>);
+
+    int64 constexpr ElementSizes[NrSections]{
+        sizeof(FVector),
+        sizeof(TriPolygon::Edge),
+        sizeof(TriPolygon::Triangle),
+        sizeof(std::array<int, 3>),
+        sizeof(std::array<int, 2>),
+        sizeof(int), sizeof(int), sizeof(int), sizeof(int),
+        sizeof(PortalNode),
+        sizeof(PortalConnection),
+        sizeof(int)
+    };
+
+    template <typename T>
+    void CopySection(uint8 const* Data, SectionEntry const& Entry, std::vector<T>& Target)
+    {
+        Target.resize(Entry.Count);
+        std::memcpy(Target.data(), Data + Entry.Offset, Entry.Count * sizeof(T));
+    }
+
+    std::unique_ptr<NavGraph> Reject(FString const& FilePath, TCHAR const* Reason)
+    {
+        UE_LOG(LogTemp, Log, TEXT("NavMeshCache: not using %s, %s"), *FilePath, Reason);
+        return nullptr;
+    }
+}
+
+std::unique_ptr<NavGraph> NavMeshCache::Load(FString const& FilePath, uint32 SourceHash)
+{
+    IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+    if (!PlatformFile.FileExists(*FilePath))
+    {
+        return nullptr;
+    }
+
+    FOpenMappedResult MappedFile = PlatformFile.OpenMappedEx(*FilePath);
+    if (MappedFile.HasError())
+    {
+        return Reject(FilePath, TEXT("it can't be mapped"));
+    }
+    TUniquePtr<IMappedFileHandle> FileHandle = MappedFile.StealValue();
+    TUniquePtr<IMappedFileRegion> Region{FileHandle->MapRegion()};
+    if (!Region)
+    {
+        return Reject(FilePath, TEXT("it can't be mapped"));
+    }
+
+    uint8 const* Data = Region->GetMappedPtr();
+    int64 const Size = Region->GetMappedSize();
+
+    // Validate everything before touching the payload
+    FileHeader Header;
+    if (Size < static_cast<int64>(sizeof(FileHeader)))
+    {
+        return Reject(FilePath, TEXT("it is truncated"));
+    }
+    std::memcpy(&Header, Data, sizeof(FileHeader));
+
+    if (Header.Magic != Magic || Header.Version != Version)
+    {
+        return Reject(FilePath, TEXT("it was written by another version"));
+    }
+    if (Header.SourceHash != SourceHash)
+    {
+        return Reject(FilePath, TEXT("the navmesh changed since it was written"));
+    }
+    if (Header.FileSize != static_cast<uint64>(Size) ||
+        FCrc::MemCrc32(Data + sizeof(FileHeader), Size - sizeof(FileHeader)) != Header.PayloadCrc)
+    {
+        return Reject(FilePath, TEXT("it is corrupt"));
+    }
+    for (int32 Id = 0; Id < NrSections; ++Id)
+    {
+        SectionEntry const& Entry = Header.Sections[Id];
+        if (Entry.Offset < sizeof(FileHeader) || Entry.Offset > static_cast<uint64>(Size) ||
+            Entry.Count > (static_cast<uint64>(Size) - Entry.Offset) / ElementSizes[Id])
+        {
+            return Reject(FilePath, TEXT("a section is out of bounds"));
+        }
+    }
+
+    // Navigation polygon, one copy per array
+    auto pNavPoly = std::make_unique<TriPolygon>(Header.WeldDistance);
+    CopySection(Data, Header.Sections[SectionVertices], pNavPoly->Vertices);
+    CopySection(Data, Header.Sections[SectionEdges], pNavPoly->Edges);
+    CopySection(Data, Header.Sections[SectionTriangles], pNavPoly->Triangles);
+    CopySection(Data, Header.Sections[SectionTriangleEdges], pNavPoly->TriangleEdges);
+    CopySection(Data, Header.Sections[SectionEdgeTriangles], pNavPoly->EdgeTriangles);
+    CopySection(Data, Header.Sections[SectionTriangleCellOffsets], pNavPoly->TriangleOffsets);
+    CopySection(Data, Header.Sections[SectionTriangleCellIds], pNavPoly->TriangleIds);
+    CopySection(Data, Header.Sections[SectionEdgeCellOffsets], pNavPoly->EdgeOffsets);
+    CopySection(Data, Header.Sections[SectionEdgeCellIds], pNavPoly->EdgeIds);
+    pNavPoly->GridOrigin = FVector2D{Header.GridOriginX, Header.GridOriginY};
+    pNavPoly->CellSize = Header.CellSize;
+    pNavPoly->NrColumns = Header.NrColumns;
+    pNavPoly->NrRows = Header.NrRows;
+    pNavPoly->bHasSpatialIndex = Header.bHasSpatialIndex != 0 &&
+        pNavPoly->TriangleOffsets.size() == static_cast<size_t>(Header.NrColumns) * Header.NrRows + 1;
+    pNavPoly->bHasLookupTables = false;
+
+    // Portal graph, Graph owns its nodes and connections one by one so these still need an allocation each
+    std::unique_ptr<NavGraph> pGraph{new NavGraph()};
+    SectionEntry const& NodesEntry = Header.Sections[SectionPortalNodes];
+    PortalNode const* PortalNodes = reinterpret_cast<PortalNode const*>(Data + NodesEntry.Offset);
+    pGraph->Nodes.reserve(NodesEntry.Count);
+    for (uint64 Idx = 0; Idx < NodesEntry.Count; ++Idx)
+    {
+        auto pNode = std::make_unique<NavGraphNode>(FVector2D{PortalNodes[Idx].X, PortalNodes[Idx].Y}, PortalNodes[Idx].EdgeIdx);
+        pNode->SetId(static_cast<int>(Idx));
+        pGraph->Nodes.push_back(std::move(pNode));
+    }
+
+    SectionEntry const& ConnectionsEntry = Header.Sections[SectionPortalConnections];
+    PortalConnection const* PortalConnections = reinterpret_cast<PortalConnection const*>(Data + ConnectionsEntry.Offset);
+    pGraph->Connections.reserve(ConnectionsEntry.Count);
+    for (uint64 Idx = 0; Idx < ConnectionsEntry.Count; ++Idx)
+    {
+        PortalConnection const& Portal = PortalConnections[Idx];
+        if (Portal.FromId < 0 || Portal.FromId >= static_cast<int32>(NodesEntry.Count) ||
+            Portal.ToId < 0 || Portal.ToId >= static_cast<int32>(NodesEntry.Count))
+        {
+            return Reject(FilePath, TEXT("a connection points outside the graph"));
+        }
+
+        auto pConnection = std::make_unique<Connection>(Portal.FromId, Portal.ToId);
+        pConnection->SetWeight(Portal.Weight);
+        pGraph->Connections.push_back(std::move(pConnection));
+    }
+
+    CopySection(Data, Header.Sections[SectionNodeIdOfEdge], pGraph->NodeIdOfEdge);
+    pGraph->pNavPoly = std::move(pNavPoly);
+    pGraph->MarkAdjacencyDirty();
+    pGraph->RebuildAdjacency();
+    return pGraph;
+}
+
+bool NavMeshCache::Save(FString const& FilePath, uint32 SourceHash, NavGraph const& Graph)
+{
+    TriPolygon const& NavPoly = *Graph.pNavPoly;
+
+    FileHeader Header{};
+    Header.Magic = Magic;
+    Header.Version = Version;
+    Header.SourceHash = SourceHash;
+    Header.WeldDistance = NavPoly.WeldDistance;
+    Header.GridOriginX = NavPoly.GridOrigin.X;
+    Header.GridOriginY = NavPoly.GridOrigin.Y;
+    Header.CellSize = NavPoly.CellSize;
+    Header.NrColumns = NavPoly.NrColumns;
+    Header.NrRows = NavPoly.NrRows;
+    Header.bHasSpatialIndex = NavPoly.bHasSpatialIndex ? 1 : 0;
+
+    // The header is written last, once the section table and checksum are known
+    TArray<uint8> Bytes{};
+    Bytes.SetNumZeroed(sizeof(FileHeader));
+    auto const AppendSection = [&Bytes, &Header](Section Id, void const* SectionData, size_t Count)
+    {
+        // Every section starts 8 byte aligned
+        Bytes.SetNumZeroed(Align(Bytes.Num(), 8));
+        Header.Sections[Id] = SectionEntry{static_cast<uint64>(Bytes.Num()), Count};
+        Bytes.Append(static_cast<uint8 const*>(SectionData), static_cast<int32>(Count * ElementSizes[Id]));
+    };
+
+    AppendSection(SectionVertices, NavPoly.Vertices.data(), NavPoly.Vertices.size());
+    AppendSection(SectionEdges, NavPoly.Edges.data(), NavPoly.Edges.size());
+    AppendSection(SectionTriangles, NavPoly.Triangles.data(), NavPoly.Triangles.size());
+    AppendSection(SectionTriangleEdges, NavPoly.TriangleEdges.data(), NavPoly.TriangleEdges.size());
+    AppendSection(SectionEdgeTriangles, NavPoly.EdgeTriangles.data(), NavPoly.EdgeTriangles.size());
+    AppendSection(SectionTriangleCellOffsets, NavPoly.TriangleOffsets.data(), NavPoly.TriangleOffsets.size());
+    AppendSection(SectionTriangleCellIds, NavPoly.TriangleIds.data(), NavPoly.TriangleIds.size());
+    AppendSection(SectionEdgeCellOffsets, NavPoly.EdgeOffsets.data(), NavPoly.EdgeOffsets.size());
+    AppendSection(SectionEdgeCellIds, NavPoly.EdgeIds.data(), NavPoly.EdgeIds.size());
+
+    std::vector<PortalNode> PortalNodes{};
+    PortalNodes.reserve(Graph.Nodes.size());
+    for (std::unique_ptr<Node> const& pNode : Graph.Nodes)
+    {
+        PortalNodes.push_back(PortalNode{pNode->GetPosition().X, pNode->GetPosition().Y, static_cast<NavGraphNode const*>(pNode.get())->GetEdgeIdx(), 0});
+    }
+    AppendSection(SectionPortalNodes, PortalNodes.data(), PortalNodes.size());
+
+    std::vector<PortalConnection> PortalConnections{};
+    PortalConnections.reserve(Graph.Connections.size());
+    for (std::unique_ptr<Connection> const& pConnection : Graph.Connections)
+    {
+        PortalConnections.push_back(PortalConnection{pConnection->GetFromId(), pConnection->GetToId(), pConnection->GetWeight()});
+    }
+    AppendSection(SectionPortalConnections, PortalConnections.data(), PortalConnections.size());
+    AppendSection(SectionNodeIdOfEdge, Graph.NodeIdOfEdge.data(), Graph.NodeIdOfEdge.size());
+
+    Header.FileSize = Bytes.Num();
+    Header.PayloadCrc = FCrc::MemCrc32(Bytes.GetData() + sizeof(FileHeader), Bytes.Num() - sizeof(FileHeader));
+    std::memcpy(Bytes.GetData(), &Header, sizeof(FileHeader));
+
+    if (!FFileHelper::SaveArrayToFile(Bytes, *FilePath))
+    {
+        UE_LOG(LogTemp, Warning, TEXT("NavMeshCache: could not write %s"), *FilePath);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,25 @@
+﻿#pragma once
+#include <memory>
+
+namespace GameAI
+{
+	class NavGraph;
+
+	// Binary snapshot of a NavGraph and the TriPolygon it was built from, so a level doesn't rebuild them on every start.
+	// All arrays (geometry, adjacency, spatial index, portal graph) are stored flat behind a header holding an
+	// (offset, count) pair per section, offsets count from the start of the file so nothing needs fixing up.
+	// Loading maps the file and copies every section in one go, the hash tables of the TriPolygon are only rebuilt
+	// once a triangle is added. Load returns nullptr when the version, the payload checksum or the hash of the
+	// source navmesh doesn't match, the caller then rebuilds and saves a fresh cache
+	class NavMeshCache final
+	{
+	public:
+		static uint32 constexpr Version = 1;
+
+		static std::unique_ptr<NavGraph> Load(FString const& FilePath, uint32 SourceHash);
+		static bool Save(FString const& FilePath, uint32 SourceHash, NavGraph const& Graph);
+
+	private:
+		NavMeshCache() = default;
+	};
+}
@@ -0,0 +1,413 @@
+﻿#include "TiledNavGraph.h"
+
+#include <algorithm>
+#include "NavGraphNode.h"
+
+using namespace GameAI;
+
+TiledNavGraph::TiledNavGraph(double TileSize, TileLoader Loader, size_t MemoryBudgetBytes)
+    : Graph{false}
+    , TileSize{TileSize}
+    , Loader{std::move(Loader)}
+    , MemoryBudgetBytes{MemoryBudgetBytes}
+{
+}
+
+size_t TiledNavGraph::BorderKeyHash::operator()(BorderKey const& Key) const
+{
+    size_t Seed{0};
+    for (int64 Coord : Key.Coords)
+    {
+        Seed ^= std::hash<int64>{}(Coord) + 0x9e3779b97f4a7c15ull + (Seed << 6) + (Seed >> 2);
+    }
+    return Seed;
+}
+
+void TiledNavGraph::UpdateStreaming(std::span<FVector2D const> Positions)
+{
+    ++UpdateCounter;
+
+    // Tiles around the positions, nearest first
+    std::vector<std::pair<double, FIntPoint>> neededTiles{};
+    std::unordered_map<uint64, size_t> neededIdxOfTile{};
+    for (FVector2D const& position : Positions)
+    {
+        FIntPoint const center = GetTileCoord(position);
+        for (int dy = -StreamingRadius; dy <= StreamingRadius; ++dy)
+        {
+            for (int dx = -StreamingRadius; dx <= StreamingRadius; ++dx)
+            {
+                FIntPoint const coord{center.X + dx, center.Y + dy};
+                FVector2D const tileCenter{(coord.X + 0.5) * TileSize, (coord.Y + 0.5) * TileSize};
+                double const distance = FVector2D::DistSquared(position, tileCenter);
+
+                auto const [it, bInserted] = neededIdxOfTile.try_emplace(MakeTileKey(coord), neededTiles.size());
+                if (bInserted)
+                    neededTiles.emplace_back(distance, coord);
+                else
+                    neededTiles[it->second].first = std::min(neededTiles[it->second].first, distance);
+            }
+        }
+    }
+    std::ranges::sort(neededTiles, {}, [](auto const& neededTile) { return neededTile.first; });
+
+    for (auto& [tileKey, tile] : Tiles)
+    {
+        tile.NeedRank = Unneeded;
+    }
+    for (size_t rank = 0; rank < neededTiles.size(); ++rank)
+    {
+        if (auto const it = Tiles.find(MakeTileKey(neededTiles[rank].second)); it != Tiles.end())
+        {
+            it->second.NeedRank = rank;
+            it->second.LastNeeded = UpdateCounter;
+        }
+    }
+
+    int nrLoaded{0};
+    for (size_t rank = 0; rank < neededTiles.size() && nrLoaded < MaxLoadsPerUpdate; ++rank)
+    {
+        FIntPoint const& coord = neededTiles[rank].second;
+        uint64 const tileKey = MakeTileKey(coord);
+        if (Tiles.contains(tileKey)) continue;
+
+        // The nearest tile is always loaded, the others only when they fit next to the nearer ones.
+        // Room is made up front when the size is known from an earlier load
+        auto const knownBytes = KnownTileBytes.find(tileKey);
+        if (knownBytes != KnownTileBytes.end())
+        {
+            EvictForRoom(knownBytes->second, rank);
+            if (rank > 0 && UsedBytes + knownBytes->second > MemoryBudgetBytes) break;
+        }
+
+        LoadTile(coord);
+        ++nrLoaded;
+        Tile& newTile = Tiles.at(tileKey);
+        newTile.NeedRank = rank;
+        newTile.LastNeeded = UpdateCounter;
+
+        EvictForRoom(0, rank);
+        if (rank > 0 && UsedBytes > MemoryBudgetBytes)
+        {
+            UnloadTile(coord);
+            break;
+        }
+    }
+
+    EvictForRoom(0, 0);
+}
+
+bool TiledNavGraph::LoadTile(FIntPoint const& Coord)
+{
+    uint64 const tileKey = MakeTileKey(Coord);
+    if (auto const it = Tiles.find(tileKey); it != Tiles.end())
+        return it->second.pGraph != nullptr;
+
+    double const startTime = FPlatformTime::Seconds();
+
+    Tile& newTile = Tiles[tileKey]; // references into the map survive later inserts
+    newTile.Coord = Coord;
+    newTile.pGraph = Loader(Coord);
+
+    if (newTile.pGraph)
+    {
+        NavGraph const& tileGraph = *newTile.pGraph;
+        TriPolygon const& navPoly = *tileGraph.GetNavPolygon();
+        newTile.NodeIdOfEdge.assign(navPoly.GetEdges().size(), Graphs::InvalidNodeId);
+
+        // Copy the tile's portal graph, its nodes move into free slots of this graph
+        std::vector<int> nodeIdOfTileNode(tileGraph.GetNodes().size(), Graphs::InvalidNodeId);
+        for (std::unique_ptr<Node> const& pNode : tileGraph.GetNodes())
+        {
+            if (pNode->GetId() == Graphs::InvalidNodeId) continue;
+
+            int const edgeIdx = static_cast<NavGraphNode const*>(pNode.get())->GetEdgeIdx();
+            TriPolygon::Edge const& edge = navPoly.GetEdges()[edgeIdx];
+            int const nodeId = AddPortalNode(pNode->GetPosition(), edgeIdx,
+                NavLine{FVector2D{edge.GetP1(navPoly)}, FVector2D{edge.GetP2(navPoly)}});
+
+            nodeIdOfTileNode[pNode->GetId()] = nodeId;
+            newTile.NodeIdOfEdge[edgeIdx] = nodeId;
+        }
+
+        Connections.reserve(Connections.size() + tileGraph.GetConnections().size());
+        for (std::unique_ptr<Connection> const& pConnection : tileGraph.GetConnections())
+        {
+            auto pCopy = std::make_unique<Connection>(nodeIdOfTileNode[pConnection->GetFromId()], nodeIdOfTileNode[pConnection->GetToId()]);
+            pCopy->SetWeight(pConnection->GetWeight());
+            Connections.push_back(std::move(pCopy));
+        }
+
+        // Border edges: stitch the ones a resident neighbour is waiting for, wait for the neighbour otherwise
+        for (int edgeIdx = 0; edgeIdx < static_cast<int>(navPoly.GetEdges().size()); ++edgeIdx)
+        {
+            if (navPoly.IsSharedEdge(edgeIdx)) continue;
+
+            TriPolygon::Edge const& edge = navPoly.GetEdges()[edgeIdx];
+            BorderKey const borderKey = MakeBorderKey(edge.GetP1(navPoly), edge.GetP2(navPoly));
+            newTile.BorderEdges.emplace_back(borderKey, edgeIdx);
+
+            auto const waiting = OpenBorderEdges.find(borderKey);
+            if (waiting == OpenBorderEdges.end())
+            {
+                OpenBorderEdges.emplace(borderKey, BorderEdge{tileKey, edgeIdx});
+            }
+            else if (waiting->second.TileKey != tileKey)
+            {
+                StitchEdge(Tiles.at(waiting->second.TileKey), waiting->second.EdgeIdx, newTile, edgeIdx);
+                OpenBorderEdges.erase(waiting);
+            }
+        }
+
+        // Queries only read the graph until the next streaming update
+        MarkAdjacencyDirty();
+        RebuildAdjacency();
+    }
+
+    newTile.Bytes = EstimateTileBytes(newTile);
+    UsedBytes += newTile.Bytes;
+    KnownTileBytes[tileKey] = newTile.Bytes;
+
+    BumpVersion();
+    ++NrLoads;
+    LastLoadTimeMs = (FPlatformTime::Seconds() - startTime) * 1000.0;
+    return newTile.pGraph != nullptr;
+}
+
+void TiledNavGraph::UnloadTile(FIntPoint const& Coord)
+{
+    uint64 const tileKey = MakeTileKey(Coord);
+    auto const tileIt = Tiles.find(tileKey);
+    if (tileIt == Tiles.end()) return;
+
+    Tile& oldTile = tileIt->second;
+    if (oldTile.pGraph)
+    {
+        TriPolygon const& navPoly = *oldTile.pGraph->GetNavPolygon();
+
+        // Unstitched border edges stop waiting
+        for (auto const& [borderKey, edgeIdx] : oldTile.BorderEdges)
+        {
+            if (auto const waiting = OpenBorderEdges.find(borderKey); waiting != OpenBorderEdges.end() && waiting->second.TileKey == tileKey)
+                OpenBorderEdges.erase(waiting);
+        }
+
+        for (int edgeIdx = 0; edgeIdx < static_cast<int>(oldTile.NodeIdOfEdge.size()); ++edgeIdx)
+        {
+            int const nodeId = oldTile.NodeIdOfEdge[edgeIdx];
+            if (nodeId == Graphs::InvalidNodeId) continue;
+
+            // The neighbour's side of a stitched edge waits for this tile again
+            if (auto const stitch = StitchOfNode.find(nodeId); stitch != StitchOfNode.end())
+            {
+                auto const& sides = stitch->second.Sides;
+                BorderEdge const other = sides[0].TileKey == tileKey ? sides[1] : sides[0];
+                Tiles.at(other.TileKey).NodeIdOfEdge[other.EdgeIdx] = Graphs::InvalidNodeId;
+
+                TriPolygon::Edge const& edge = navPoly.GetEdges()[edgeIdx];
+                OpenBorderEdges.insert_or_assign(MakeBorderKey(edge.GetP1(navPoly), edge.GetP2(navPoly)), other);
+                StitchOfNode.erase(stitch);
+            }
+
+            Nodes[nodeId]->SetId(Graphs::InvalidNodeId);
+            FreeNodeIds.push_back(nodeId);
+        }
+
+        std::erase_if(Connections, [this](std::unique_ptr<Connection> const& pConnection)
+        {
+            return Nodes[pConnection->GetFromId()]->GetId() == Graphs::InvalidNodeId
+                || Nodes[pConnection->GetToId()]->GetId() == Graphs::InvalidNodeId;
+        });
+
+        MarkAdjacencyDirty();
+        RebuildAdjacency();
+    }
+
+    UsedBytes -= oldTile.Bytes;
+    Tiles.erase(tileIt);
+    BumpVersion();
+}
+
+void TiledNavGraph::UnloadAllTiles()
+{
+    Tiles.clear();
+    OpenBorderEdges.clear();
+    StitchOfNode.clear();
+    PortalOfNode.clear();
+    FreeNodeIds.clear();
+    Nodes.clear();
+    Connections.clear();
+    UsedBytes = 0;
+
+    MarkAdjacencyDirty();
+    RebuildAdjacency();
+    BumpVersion();
+}
+
+void TiledNavGraph::SetMemoryBudget(size_t NewBudgetBytes)
+{
+    MemoryBudgetBytes = NewBudgetBytes;
+    EvictForRoom(0, 0);
+}
+
+FIntPoint TiledNavGraph::GetTileCoord(FVector2D const& Position) const
+{
+    return FIntPoint{FMath::FloorToInt(Position.X / TileSize), FMath::FloorToInt(Position.Y / TileSize)};
+}
+
+bool TiledNavGraph::IsTileResident(FIntPoint const& Tile) const
+{
+    return Tiles.contains(MakeTileKey(Tile));
+}
+
+std::vector<FIntPoint> TiledNavGraph::GetResidentTiles() const
+{
+    std::vector<FIntPoint> residentTiles{};
+    residentTiles.reserve(Tiles.size());
+    for (auto const& [tileKey, tile] : Tiles)
+    {
+        residentTiles.push_back(tile.Coord);
+    }
+    return residentTiles;
+}
+
+std::optional<TiledNavGraph::TileTriangle> TiledNavGraph::FindTriangleAt(FVector2D const& Position) const
+{
+    // The tile of the position owns the triangle most of the time, a triangle can stick out into the neighbours
+    static int constexpr Offsets[][2]{{0, 0}, {-1, 0}, {1, 0}, {0, -1}, {0, 1}, {-1, -1}, {1, -1}, {-1, 1}, {1, 1}};
+
+    FIntPoint const center = GetTileCoord(Position);
+    for (auto const& offset : Offsets)
+    {
+        auto const it = Tiles.find(MakeTileKey(FIntPoint{center.X + offset[0], center.Y + offset[1]}));
+        if (it == Tiles.end() || !it->second.pGraph) continue;
+
+        TriPolygon const* pNavPoly = it->second.pGraph->GetNavPolygon();
+        TriPolygon::Triangle const* pTriangle = pNavPoly->GetTriangleAtPosition(Position, true);
+        if (pTriangle == nullptr) continue;
+
+        TileTriangle result{pNavPoly, pNavPoly->GetTriangleIndex(*pTriangle)};
+        auto const& edgeIds = pNavPoly->GetTriangleEdgeIds(result.TriIdx);
+        for (int i = 0; i < 3; ++i)
+        {
+            result.PortalNodeIds[i] = it->second.NodeIdOfEdge[edgeIds[i]];
+        }
+        return result;
+    }
+
+    return std::nullopt;
+}
+
+void TiledNavGraph::DrawDebug(UWorld const* World, FColor const& Color) const
+{
+    for (auto const& [tileKey, tile] : Tiles)
+    {
+        if (tile.pGraph)
+            tile.pGraph->GetNavPolygon()->DrawDebug(World, Color);
+    }
+}
+
+uint64 TiledNavGraph::MakeTileKey(FIntPoint const& Coord)
+{
+    return (static_cast<uint64>(static_cast<uint32>(Coord.X)) << 32) | static_cast<uint32>(Coord.Y);
+}
+
+TiledNavGraph::BorderKey TiledNavGraph::MakeBorderKey(FVector const& P1, FVector const& P2)
+{
+    std::array<int64, 2> first{std::llround(P1.X * StitchPrecision), std::llround(P1.Y * StitchPrecision)};
+    std::array<int64, 2> second{std::llround(P2.X * StitchPrecision), std::llround(P2.Y * StitchPrecision)};
+    if (second < first)
+        std::swap(first, second);
+
+    return BorderKey{{first[0], first[1], second[0], second[1]}};
+}
+
+int TiledNavGraph::AddPortalNode(FVector2D const& Position, int EdgeIdx, NavLine const& Portal)
+{
+    auto pNode = std::make_unique<NavGraphNode>(Position, EdgeIdx);
+
+    // Reuse the slots of unloaded tiles, the ids of resident nodes never change
+    if (!FreeNodeIds.empty())
+    {
+        int const nodeId = FreeNodeIds.back();
+        FreeNodeIds.pop_back();
+        pNode->SetId(nodeId);
+        Nodes[nodeId] = std::move(pNode);
+        PortalOfNode[nodeId] = Portal;
+        return nodeId;
+    }
+
+    int const nodeId = static_cast<int>(Nodes.size());
+    pNode->SetId(nodeId);
+    Nodes.push_back(std::move(pNode));
+    PortalOfNode.push_back(Portal);
+    return nodeId;
+}
+
+void TiledNavGraph::AddLink(int FromId, int ToId)
+{
+    float const distance = static_cast<float>(FVector2D::Distance(Nodes[FromId]->GetPosition(), Nodes[ToId]->GetPosition()));
+
+    auto pForward = std::make_unique<Connection>(FromId, ToId);
+    pForward->SetWeight(distance);
+    Connections.push_back(std::move(pForward));
+
+    auto pBackward = std::make_unique<Connection>(ToId, FromId);
+    pBackward->SetWeight(distance);
+    Connections.push_back(std::move(pBackward));
+}
+
+void TiledNavGraph::StitchEdge(Tile& First, int FirstEdgeIdx, Tile& Second, int SecondEdgeIdx)
+{
+    TriPolygon const& navPoly = *First.pGraph->GetNavPolygon();
+    TriPolygon::Edge const& edge = navPoly.GetEdges()[FirstEdgeIdx];
+    FVector2D const p1{edge.GetP1(navPoly)};
+    FVector2D const p2{edge.GetP2(navPoly)};
+
+    int const stitchId = AddPortalNode((p1 + p2) / 2.0, FirstEdgeIdx, NavLine{p1, p2});
+    StitchOfNode.emplace(stitchId, Stitch{{BorderEdge{MakeTileKey(First.Coord), FirstEdgeIdx}, BorderEdge{MakeTileKey(Second.Coord), SecondEdgeIdx}}});
+
+    // Linked to the other portals of the triangle on either side, like the portals inside a tile
+    std::pair<Tile*, int> const sides[]{{&First, FirstEdgeIdx}, {&Second, SecondEdgeIdx}};
+    for (auto const& [pTile, edgeIdx] : sides)
+    {
+        TriPolygon const& sidePoly = *pTile->pGraph->GetNavPolygon();
+        for (int triEdgeIdx : sidePoly.GetTriangleEdgeIds(sidePoly.GetEdgeTriangles(edgeIdx)[0]))
+        {
+            if (int const nodeId = pTile->NodeIdOfEdge[triEdgeIdx]; nodeId != Graphs::InvalidNodeId)
+                AddLink(stitchId, nodeId);
+        }
+        pTile->NodeIdOfEdge[edgeIdx] = stitchId;
+    }
+}
+
+void TiledNavGraph::EvictForRoom(size_t BytesToFit, size_t KeepRank)
+{
+    while (UsedBytes + BytesToFit > MemoryBudgetBytes)
+    {
+        // Tiles nobody needs go first, least recently needed first, then the farthest needed ones
+        Tile const* pVictim = nullptr;
+        for (auto const& [tileKey, tile] : Tiles)
+        {
+            if (tile.NeedRank <= KeepRank) continue;
+            if (!pVictim || tile.NeedRank > pVictim->NeedRank || (tile.NeedRank == pVictim->NeedRank && tile.LastNeeded < pVictim->LastNeeded))
+                pVictim = &tile;
+        }
+        if (!pVictim) break;
+
+        UnloadTile(pVictim->Coord);
+        ++NrEvictions;
+    }
+}
+
+size_t TiledNavGraph::EstimateTileBytes(Tile const& InTile) const
+{
+    if (!InTile.pGraph) return sizeof(Tile);
+
+    // The tile's own graph and polygon, plus its copy in this graph (node, portal, connections and their adjacency entries)
+    size_t const nodeBytes = sizeof(std::unique_ptr<Node>) + sizeof(NavGraphNode) + sizeof(NavLine);
+    size_t const connectionBytes = sizeof(std::unique_ptr<Connection>) + sizeof(Connection) + 2 * sizeof(Connection*);
+    return sizeof(Tile) + InTile.pGraph->GetAllocatedBytes()
+        + InTile.pGraph->GetNodeCount() * nodeBytes + InTile.pGraph->GetConnections().size() * connectionBytes
+        + InTile.NodeIdOfEdge.capacity() * sizeof(int) + InTile.BorderEdges.capacity() * sizeof(std::pair<BorderKey, int>);
+}
@@ -0,0 +1,133 @@
+﻿#pragma once
+#include <functional>
+#include <limits>
+#include <optional>
+#include <unordered_map>
+
+#include "NavGraph.h"
+#include "GraphTheory/Algorithms/NavGraphPathfinding.h"
+
+namespace GameAI
+{
+	// Navmesh split in square tiles that stream in and out around the agents, for worlds too big to keep loaded.
+	// Every tile owns a NavGraph of its own triangles (a triangle belongs to the tile its center is in).
+	// The resident tiles are stitched into this graph: their portal nodes are copied in, and every border edge that
+	// two resident tiles share becomes a portal node linking them. Searches only see the resident tiles.
+	// Every load and unload bumps the graph version, a partial path is worth retrying once it changes.
+	// Streaming rebuilds the adjacency index, so don't query from other threads while UpdateStreaming runs
+	class TiledNavGraph final : public Graph
+	{
+	public:
+		// Builds or loads the NavGraph of a tile, nullptr when the tile has no navmesh
+		using TileLoader = std::function<std::unique_ptr<NavGraph>(FIntPoint const& Tile)>;
+
+		// A triangle of a resident tile
+		struct TileTriangle
+		{
+			TriPolygon const* pNavPoly{nullptr};
+			int TriIdx{-1};
+			std::array<int, 3> PortalNodeIds{}; // node in this graph per triangle edge, InvalidNodeId when closed
+
+			bool operator==(TileTriangle const& Other) const { return pNavPoly == Other.pNavPoly && TriIdx == Other.TriIdx; }
+		};
+
+		TiledNavGraph(double TileSize, TileLoader Loader, size_t MemoryBudgetBytes);
+
+		// Loads the tiles within the streaming radius of the positions, nearest first and at most MaxLoadsPerUpdate per call.
+		// Once over the budget the tiles nobody needs are unloaded (least recently needed first), then the farthest needed ones.
+		// The nearest tile is always loaded, even when it alone is over budget
+		void UpdateStreaming(std::span<FVector2D const> Positions);
+		bool LoadTile(FIntPoint const& Tile); // false when the tile has no navmesh
+		void UnloadTile(FIntPoint const& Tile);
+		void UnloadAllTiles();
+
+		void SetStreamingRadius(int NrTiles) { StreamingRadius = NrTiles; } // around the tile of each position
+		void SetMaxLoadsPerUpdate(int NrTiles) { MaxLoadsPerUpdate = NrTiles; }
+		void SetMemoryBudget(size_t NewBudgetBytes);
+		size_t GetMemoryBudget() const { return MemoryBudgetBytes; }
+
+		double GetTileSize() const { return TileSize; }
+		FIntPoint GetTileCoord(FVector2D const& Position) const;
+		bool IsTileResident(FIntPoint const& Tile) const;
+		std::vector<FIntPoint> GetResidentTiles() const;
+
+		// Checks the tile of the position and its neighbours, triangles can stick out of their tile
+		std::optional<TileTriangle> FindTriangleAt(FVector2D const& Position) const;
+		// Edge of the polygon a portal node sits on
+		NavLine const& GetPortal(int NodeId) const { return PortalOfNode[NodeId]; }
+
+		void DrawDebug(UWorld const* World, FColor const& Color) const; // polygons of the resident tiles
+
+		// Stats
+		int GetResidentTileCount() const { return static_cast<int>(Tiles.size()); }
+		size_t GetAllocatedBytes() const { return UsedBytes; } // tiles and their share of this graph
+		int GetStitchedPortalCount() const { return static_cast<int>(StitchOfNode.size()); }
+		int GetLoadCount() const { return NrLoads; }
+		int GetEvictionCount() const { return NrEvictions; }
+		double GetLastLoadTimeMs() const { return LastLoadTimeMs; }
+
+	private:
+		// Quantised end points of a border edge, in either order, to find the same edge in the neighbouring tile
+		struct BorderKey
+		{
+			std::array<int64, 4> Coords;
+			bool operator==(BorderKey const& Other) const = default;
+		};
+		struct BorderKeyHash
+		{
+			size_t operator()(BorderKey const& Key) const;
+		};
+		struct BorderEdge
+		{
+			uint64 TileKey;
+			int EdgeIdx;
+		};
+
+		struct Tile
+		{
+			FIntPoint Coord{};
+			std::unique_ptr<NavGraph> pGraph{}; // nullptr for a tile without navmesh
+			std::vector<int> NodeIdOfEdge{}; // node in this graph per polygon edge, own portals and stitched ones
+			std::vector<std::pair<BorderKey, int>> BorderEdges{}; // open edges of the polygon, candidates for stitching
+			size_t Bytes{0};
+			uint64 LastNeeded{0}; // streaming update that last asked for the tile
+			size_t NeedRank{Unneeded}; // distance order in the last streaming update
+		};
+
+		struct Stitch
+		{
+			std::array<BorderEdge, 2> Sides;
+		};
+
+		static double constexpr StitchPrecision = 100.0; // end points are compared in 1/100 units
+		static size_t constexpr Unneeded = std::numeric_limits<size_t>::max();
+
+		double TileSize;
+		TileLoader Loader;
+		size_t MemoryBudgetBytes;
+		size_t UsedBytes{0};
+		int StreamingRadius{1};
+		int MaxLoadsPerUpdate{2};
+
+		std::unordered_map<uint64, Tile> Tiles{};
+		std::unordered_map<uint64, size_t> KnownTileBytes{}; // of tiles that were loaded before, to skip the ones that won't fit
+		std::unordered_map<BorderKey, BorderEdge, BorderKeyHash> OpenBorderEdges{}; // waiting for their neighbour tile
+		std::unordered_map<int, Stitch> StitchOfNode{};
+		std::vector<NavLine> PortalOfNode{};
+		std::vector<int> FreeNodeIds{};
+		uint64 UpdateCounter{0};
+
+		int NrLoads{0};
+		int NrEvictions{0};
+		double LastLoadTimeMs{0.0};
+
+		static uint64 MakeTileKey(FIntPoint const& Coord);
+		static BorderKey MakeBorderKey(FVector const& P1, FVector const& P2);
+
+		int AddPortalNode(FVector2D const& Position, int EdgeIdx, NavLine const& Portal);
+		void AddLink(int FromId, int ToId); // both directions, distance as cost
+		void StitchEdge(Tile& First, int FirstEdgeIdx, Tile& Second, int SecondEdgeIdx);
+		void EvictForRoom(size_t BytesToFit, size_t KeepRank); // keeps the tiles up to KeepRank
+		size_t EstimateTileBytes(Tile const& InTile) const;
+	};
+}
@@ -18,6 +18,11 @@ TerrainGridGraph::TerrainGridGraph(TerrainNodeFactory* Factory, int Rows, int Co
 	FVector2D const& OriginPosition, bool IsDiagonallyConnected, bool IsDirectional)
 		: GridGraph(Factory, Rows, Cols, CellSize, Cost, OriginPosition, IsDiagonallyConnected, IsDirectional)
 {
+	for (auto const& [TerrainType, CostMultiplier] : TerrainCostMultipliers)
+	{
+		SetCostClassMultiplier(static_cast<uint8_t>(TerrainType), CostMultiplier);
+	}
+	Components.Rebuild(*this);
 }
 
 void TerrainGridGraph::PaintNodeAtPosition(FVector2D const& Position, TerrainNode::Type TypeToPaint)
@@ -30,37 +35,73 @@ void TerrainGridGraph::PaintNodeAtPosition(FVector2D const& Position, TerrainNod
 	// Stop if we're just repainting the same type
 	if (OldType == TypeToPaint) return;
 
-	// Paint
+	// Repairing the component ids and the cell layer only works when they were right before
+	bool const bRepairComponents = Components.IsUpToDate(*this);
+	bool const bSyncCellLayer = IsCellLayerInSync();
+
+	// Paint, the costs change even when the connections stay
 	AsTerrainNode->SetType(TypeToPaint);
+	SetCellWalkable(NodeId, TypeToPaint != TerrainNode::Type::Water);
+	SetCellCostClass(NodeId, static_cast<uint8_t>(TypeToPaint));
+	BumpVersion();
+	NrMudCells += (TypeToPaint == TerrainNode::Type::Mud) - (OldType == TerrainNode::Type::Mud);
 	
 	if (OldType == TerrainNode::Type::Water)
 	{
 		// reconnect
 		AddConnectionsToAdjacentCells(NodeId);
+		if (bRepairComponents)
+		{
+			Components.OnConnectionsAdded(*this, NodeId);
+		}
 	}
 	
 	if (TypeToPaint == TerrainNode::Type::Water)
 	{
+		// The component may split, the repair starts from the cells the node was connected to
+		std::vector<int> FormerNeighbours{};
+		for (Connection const* ConnectionWith : FindConnectionsWith(NodeId))
+		{
+			FormerNeighbours.push_back(ConnectionWith->GetFromId() == NodeId ? ConnectionWith->GetToId() : ConnectionWith->GetFromId());
+		}
+
 		// remove connection to node
 		RemoveConnectionsTo(NodeId);
 		RemoveConnectionsFrom(NodeId);
+		if (bRepairComponents)
+		{
+			Components.OnConnectionsRemoved(*this, NodeId, FormerNeighbours);
+		}
+		if (bSyncCellLayer)
+		{
+			SyncCellLayer();
+		}
 		return;
 	}
 		
-	// Apply the new terrain cost multiplier
-	float TerrainCostMultiplier = *GetTerrainCostMultiplier(TypeToPaint);
+	// Apply the new terrain cost multiplier, a step between two terrains costs as much as the costlier one
 	auto ConnectionsToNode = FindConnectionsWith(NodeId);
 	for (Connection* ConnectionTo : ConnectionsToNode)
 	{
-		if (IsCardinalConnection(ConnectionTo->GetFromId(), ConnectionTo->GetToId()))
-		{
-			ConnectionTo->SetWeight(GetCardinalCost() * TerrainCostMultiplier);
-		}
-		else
-		{
-			ConnectionTo->SetWeight(GetDiagonalCost() * TerrainCostMultiplier);
-		}
+		ConnectionTo->SetWeight(GetStepCost(ConnectionTo->GetFromId(), ConnectionTo->GetToId()));
+	}
+	if (bRepairComponents)
+	{
+		Components.OnCostsChanged(*this);
+	}
+	if (bSyncCellLayer)
+	{
+		SyncCellLayer();
+	}
+}
+
+ConnectedComponents const& TerrainGridGraph::GetComponents() const
+{
+	if (!Components.IsUpToDate(*this))
+	{
+		Components.Rebuild(*this);
 	}
+	return Components;
 }
 
 void TerrainGridGraph::DrawTerrain(UWorld* World) const
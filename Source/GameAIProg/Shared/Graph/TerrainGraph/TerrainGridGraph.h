@@ -1,4 +1,5 @@
 ﻿#pragma once
+#include "../ConnectedComponents.h"
 #include "../GridGraph/GridGraph.h"
 
 namespace GameAI
@@ -12,11 +13,20 @@ namespace GameAI
 		
 		void PaintNodeAtPosition(FVector2D const & Position, TerrainNode::Type TypeToPaint);
 		void DrawTerrain(UWorld* World) const;
+		
+		virtual bool HasUniformCosts() const override { return NrMudCells == 0; }
+
+		// Repaired by every paint, only rebuilt after other changes to the connections. Not thread safe when stale
+		ConnectedComponents const& GetComponents() const;
 
 		static std::optional<FColor> GetTerrainColor(TerrainNode::Type TerrainType);
 		static std::optional<float> GetTerrainCostMultiplier(TerrainNode::Type TerrainType);
 		
 		static std::unordered_map<TerrainNode::Type, FColor> const TerrainColors;
 		static std::unordered_map<TerrainNode::Type, float> const TerrainCostMultipliers;
+		
+	private:
+		int NrMudCells{0};
+		mutable ConnectedComponents Components{};
 	};
 }